@@ -68,6 +68,9 @@ DolphinViewContainer::DolphinViewContainer(const KUrl& url, QWidget* parent) :
     m_statusBar(0),
     m_statusBarTimer(0),
     m_statusBarTimestamp(),
+    m_nameFilterTimer(0),
+    m_pendingNameFilter(),
+    m_nameFilterDuration(0),
     m_autoGrabFocus(true),
     m_dropDestination(),
     m_dropEvent(0)
@@ -160,6 +163,11 @@ DolphinViewContainer::DolphinViewContainer(const KUrl& url, QWidget* parent) :
     m_filterBar->setVisible(settings->filterBar());
     connect(m_filterBar, SIGNAL(filterChanged(QString)),
             this, SLOT(setNameFilter(QString)));
+
+    m_nameFilterTimer = new QTimer(this);
+    m_nameFilterTimer->setSingleShot(true);
+    m_nameFilterTimer->setInterval(200);
+    connect(m_nameFilterTimer, SIGNAL(timeout()), this, SLOT(applyNameFilter()));
     connect(m_filterBar, SIGNAL(closeRequest()),
             this, SLOT(closeFilterBar()));
     connect(m_filterBar, SIGNAL(focusViewRequest()),
@@ -525,7 +533,25 @@ void DolphinViewContainer::closeFilterBar()
 
 void DolphinViewContainer::setNameFilter(const QString& nameFilter)
 {
-    m_view->setNameFilter(nameFilter);
+    m_pendingNameFilter = nameFilter;
+    if (m_nameFilterDuration < 50) {
+        m_nameFilterTimer->stop();
+        applyNameFilter();
+    } else {
+        // Filtering the items took a noticeable time, which would block
+        // the filter bar while typing. Apply the filter with a small delay,
+        // so that intermediate filters are skipped if the user types fast.
+        m_nameFilterTimer->start();
+    }
+}
+
+void DolphinViewContainer::applyNameFilter()
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_view->setNameFilter(m_pendingNameFilter);
+    m_nameFilterDuration = timer.elapsed();
+
     delayedStatusBarUpdate();
 }
 
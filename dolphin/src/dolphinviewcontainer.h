@@ -234,6 +234,11 @@ private slots:
      */
     void setNameFilter(const QString& nameFilter);
 
+    /**
+     * Applies the name filter that has been set by setNameFilter() to the view.
+     */
+    void applyNameFilter();
+
     /**
      * Marks the view container as active
      * (see DolphinViewContainer::setActive()).
@@ -340,6 +345,10 @@ private:
     DolphinStatusBar* m_statusBar;
     QTimer* m_statusBarTimer;            // Triggers a delayed update
     QElapsedTimer m_statusBarTimestamp;  // Time in ms since last update
+
+    QTimer* m_nameFilterTimer;           // Triggers a delayed applyNameFilter()
+    QString m_pendingNameFilter;         // Name filter that has not been applied yet
+    qint64 m_nameFilterDuration;         // Time in ms that applying the last name filter took
     bool m_autoGrabFocus;
 
     KUrl m_dropDestination;
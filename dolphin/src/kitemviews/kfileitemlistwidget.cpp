@@ -71,6 +71,15 @@ QString KFileItemListWidgetInformant::roleText(const QByteArray& role,
             const KIO::filesize_t size = roleValue.value<KIO::filesize_t>();
             text = KGlobal::locale()->formatByteSize(size);
         }
+    } else if (role == "recursiveSize") {
+        // The value is not available before the first files of a directory tree have been found
+        if (!roleValue.isNull()) {
+            const KIO::filesize_t size = roleValue.value<KIO::filesize_t>();
+            text = KGlobal::locale()->formatByteSize(size);
+            if (values.value("recursiveSizePending").toBool()) {
+                text = i18nc("@item:intable Total size of a folder that is still being calculated", "%1...", text);
+            }
+        }
     } else if (role == "date") {
         const QDateTime dateTime = roleValue.toDateTime();
         text = KGlobal::locale()->formatDateTime(dateTime);
@@ -97,7 +106,7 @@ KItemListWidgetInformant* KFileItemListWidget::createInformant()
 
 bool KFileItemListWidget::isRoleRightAligned(const QByteArray& role) const
 {
-    return role == "size";
+    return role == "size" || role == "recursiveSize";
 }
 
 bool KFileItemListWidget::isHidden() const
@@ -29,6 +29,7 @@
 
 #include "private/kfileitemmodelsortalgorithm.h"
 #include "private/kfileitemmodeldirlister.h"
+#include "private/kmimetypedetector.h"
 
 #include <QApplication>
 #include <QMimeData>
@@ -36,6 +37,7 @@
 #include <QWidget>
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 // #define KFILEITEMMODEL_DEBUG
@@ -59,7 +61,11 @@ KFileItemModel::KFileItemModel(QObject* parent) :
     m_pendingItemsToInsert(),
     m_groups(),
     m_expandedDirs(),
-    m_urlsToExpand()
+    m_urlsToExpand(),
+    m_snapshotUrls(),
+    m_snapshotDirectory(),
+    m_snapshotItemCount(0),
+    m_snapshotChanged(false)
 {
     m_dirLister = new KFileItemModelDirLister(this);
     m_dirLister->setDelayedMimeTypes(true);
@@ -120,6 +126,7 @@ KFileItemModel::~KFileItemModel()
 void KFileItemModel::loadDirectory(const KUrl& url)
 {
     m_dirLister->openUrl(url);
+    insertSnapshotItems(url);
 }
 
 void KFileItemModel::refreshDirectory(const KUrl& url)
@@ -168,6 +175,44 @@ bool KFileItemModel::setData(int index, const QHash<QByteArray, QVariant>& value
         return false;
     }
 
+    const QSet<QByteArray> changedRoles = applyData(index, values);
+    if (changedRoles.isEmpty()) {
+        return false;
+    }
+
+    emitItemsChangedAndTriggerResorting(KItemRangeList() << KItemRange(index, 1), changedRoles);
+
+    return true;
+}
+
+void KFileItemModel::setItemsData(const QMap<int, QHash<QByteArray, QVariant> >& itemsValues)
+{
+    QList<int> changedIndexes;
+    QSet<QByteArray> changedRoles;
+
+    // QMap iterates the indexes in ascending order
+    QMapIterator<int, QHash<QByteArray, QVariant> > it(itemsValues);
+    while (it.hasNext()) {
+        it.next();
+        const int index = it.key();
+        if (index < 0 || index >= count()) {
+            continue;
+        }
+
+        const QSet<QByteArray> roles = applyData(index, it.value());
+        if (!roles.isEmpty()) {
+            changedIndexes.append(index);
+            changedRoles += roles;
+        }
+    }
+
+    if (!changedIndexes.isEmpty()) {
+        emitItemsChangedAndTriggerResorting(KItemRangeList::fromSortedContainer(changedIndexes), changedRoles);
+    }
+}
+
+QSet<QByteArray> KFileItemModel::applyData(int index, const QHash<QByteArray, QVariant>& values)
+{
     QHash<QByteArray, QVariant> currentValues = data(index);
 
     // Determine which roles have been changed
@@ -185,7 +230,7 @@ bool KFileItemModel::setData(int index, const QHash<QByteArray, QVariant>& value
     }
 
     if (changedRoles.isEmpty()) {
-        return false;
+        return changedRoles;
     }
 
     m_itemData[index]->values = currentValues;
@@ -193,11 +238,12 @@ bool KFileItemModel::setData(int index, const QHash<QByteArray, QVariant>& value
         KUrl url = m_itemData[index]->item.url();
         url.setFileName(currentValues["text"].toString());
         m_itemData[index]->item.setUrl(url);
+        m_itemData[index]->lowerCaseText.clear();
+        updateTextSortKey(m_itemData[index]);
     }
+    updateSortValues(m_itemData[index]);
 
-    emitItemsChangedAndTriggerResorting(KItemRangeList() << KItemRange(index, 1), changedRoles);
-
-    return true;
+    return changedRoles;
 }
 
 void KFileItemModel::setSortDirectoriesFirst(bool dirsFirst)
@@ -237,7 +283,7 @@ bool KFileItemModel::showDirectoriesOnly() const
     return m_dirLister->dirOnlyMode();
 }
 
-QMimeData* KFileItemModel::createMimeData(const QSet<int>& indexes) const
+QMimeData* KFileItemModel::createMimeData(const KItemSet& indexes) const
 {
     QMimeData* data = new QMimeData();
 
@@ -248,9 +294,7 @@ QMimeData* KFileItemModel::createMimeData(const QSet<int>& indexes) const
     KUrl::List mostLocalUrls;
     bool canUseMostLocalUrls = true;
 
-    QSetIterator<int> it(indexes);
-    while (it.hasNext()) {
-        const int index = it.next();
+    foreach (int index, indexes) {
         const KFileItem item = fileItem(index);
         if (!item.isNull()) {
             urls << item.targetUrl();
@@ -321,6 +365,7 @@ QList<QPair<int, QVariant> > KFileItemModel::groups() const
         switch (typeForRole(sortRole())) {
         case NameRole:        m_groups = nameRoleGroups(); break;
         case SizeRole:        m_groups = sizeRoleGroups(); break;
+        case RecursiveSizeRole: m_groups = recursiveSizeRoleGroups(); break;
         case DateRole:        m_groups = dateRoleGroups(); break;
         case PermissionsRole: m_groups = permissionRoleGroups(); break;
         case RatingRole:      m_groups = ratingRoleGroups(); break;
@@ -410,6 +455,7 @@ void KFileItemModel::setRoles(const QSet<QByteArray>& roles)
         const int maxIndex = count() - 1;
         for (int i = 0; i <= maxIndex; ++i) {
             m_itemData[i]->values = retrieveData(m_itemData.at(i)->item, m_itemData.at(i)->parent);
+            updateSortValues(m_itemData[i]);
         }
 
         kWarning() << "TODO: Emitting itemsChanged() with no information what has changed!";
@@ -529,8 +575,13 @@ void KFileItemModel::setNameFilter(const QString& nameFilter)
 {
     if (m_filter.pattern() != nameFilter) {
         dispatchPendingItemsToInsert();
+
+        // When typing in the filter bar, usually the pattern only gets
+        // longer. Items that got hidden by the shorter pattern cannot
+        // match the longer one, so only the shown items must be checked.
+        const FilterScope scope = m_filter.isNarrowedBy(nameFilter) ? VisibleItems : AllItems;
         m_filter.setPattern(nameFilter);
-        applyFilters();
+        applyFilters(scope);
     }
 }
 
@@ -554,47 +605,102 @@ QStringList KFileItemModel::mimeTypeFilters() const
 }
 
 
-void KFileItemModel::applyFilters()
+void KFileItemModel::applyFilters(FilterScope scope)
 {
     // Check which shown items from m_itemData must get
     // hidden and hence moved to m_filteredItems.
     QVector<int> newFilteredIndexes;
 
+    const QVector<bool> matches = filterMatches(m_itemData);
     const int itemCount = m_itemData.count();
     for (int index = 0; index < itemCount; ++index) {
         ItemData* itemData = m_itemData.at(index);
 
         // Only filter non-expanded items as child items may never
         // exist without a parent item
-        if (!itemData->values.value("isExpanded").toBool()) {
-            const KFileItem item = itemData->item;
-            if (!m_filter.matches(item)) {
-                newFilteredIndexes.append(index);
-                m_filteredItems.insert(item, itemData);
-            }
+        if (!matches.at(index) && !itemData->values.value("isExpanded").toBool()) {
+            newFilteredIndexes.append(index);
+            m_filteredItems.insert(itemData->item, itemData);
         }
     }
 
     const KItemRangeList removedRanges = KItemRangeList::fromSortedContainer(newFilteredIndexes);
     removeItems(removedRanges, KeepItemData);
 
+    if (scope == VisibleItems) {
+        return;
+    }
+
     // Check which hidden items from m_filteredItems should
     // get visible again and hence removed from m_filteredItems.
     QList<ItemData*> newVisibleItems;
 
-    QHash<KFileItem, ItemData*>::iterator it = m_filteredItems.begin();
-    while (it != m_filteredItems.end()) {
-        if (m_filter.matches(it.key())) {
-            newVisibleItems.append(it.value());
-            it = m_filteredItems.erase(it);
-        } else {
-            ++it;
+    const QList<ItemData*> filteredItems = m_filteredItems.values();
+    const QVector<bool> filteredMatches = filterMatches(filteredItems);
+    for (int i = 0; i < filteredItems.count(); ++i) {
+        if (filteredMatches.at(i)) {
+            ItemData* itemData = filteredItems.at(i);
+            newVisibleItems.append(itemData);
+            m_filteredItems.remove(itemData->item);
         }
     }
 
     insertItems(newVisibleItems);
 }
 
+QVector<bool> KFileItemModel::filterMatches(const QList<ItemData*>& items) const
+{
+    // Each thread checks at least this number of items, as
+    // checking a few items is faster than starting a thread.
+    static const int minimumItemsPerThread = 5000;
+    static const int numberOfThreads = QThread::idealThreadCount();
+
+    const int itemCount = items.count();
+    QVector<bool> matches(itemCount);
+
+    // Checking the MIME type might determine it, which may not be done
+    // concurrently for KFileItems. So only the name filter is checked
+    // by several threads.
+    const int chunkCount = m_filter.mimeTypes().isEmpty()
+                           ? qMin(numberOfThreads, itemCount / minimumItemsPerThread) : 1;
+    if (chunkCount < 2) {
+        matchItems(m_filter, items, 0, itemCount, matches.data());
+        return matches;
+    }
+
+    // Each thread gets its own copy of the filter, as QRegExp is not
+    // thread-safe. The calling thread checks the first chunk itself.
+    QList<QFuture<void> > futures;
+    for (int i = 1; i < chunkCount; ++i) {
+        const int begin = int(qint64(itemCount) * i / chunkCount);
+        const int end = int(qint64(itemCount) * (i + 1) / chunkCount);
+        futures.append(QtConcurrent::run(matchItems, KFileItemModelFilter(m_filter), items, begin, end, matches.data()));
+    }
+    matchItems(m_filter, items, 0, itemCount / chunkCount, matches.data());
+    foreach (QFuture<void> future, futures) {
+        future.waitForFinished();
+    }
+
+    return matches;
+}
+
+void KFileItemModel::matchItems(const KFileItemModelFilter& filter, const QList<ItemData*>& items,
+                                int begin, int end, bool* matches)
+{
+    for (int i = begin; i < end; ++i) {
+        ItemData* itemData = items.at(i);
+        matches[i] = filter.matches(itemData->item, filterText(itemData));
+    }
+}
+
+const QString& KFileItemModel::filterText(ItemData* data)
+{
+    if (data->lowerCaseText.isNull()) {
+        data->lowerCaseText = data->item.text().toLower();
+    }
+    return data->lowerCaseText;
+}
+
 void KFileItemModel::removeFilteredChildren(const KItemRangeList& itemRanges)
 {
     if (m_filteredItems.isEmpty() || !m_requestRole[ExpandedParentsCountRole]) {
@@ -759,6 +865,10 @@ void KFileItemModel::slotCompleted()
 {
     dispatchPendingItemsToInsert();
 
+    if (!m_snapshotDirectory.isEmpty() && m_dirLister->isFinished()) {
+        finishSnapshot();
+    }
+
     if (!m_urlsToExpand.isEmpty()) {
         // Try to find a URL that can be expanded.
         // Note that the parent folder must be expanded before any of its subfolders become visible.
@@ -789,12 +899,24 @@ void KFileItemModel::slotCanceled()
     m_maximumUpdateIntervalTimer->stop();
     dispatchPendingItemsToInsert();
 
+    // Keep the items from the snapshot, but don't store an incomplete snapshot.
+    m_snapshotUrls.clear();
+    m_snapshotDirectory.clear();
+
     emit directoryLoadingCanceled();
 }
 
-void KFileItemModel::slotItemsAdded(const KUrl& directoryUrl, const KFileItemList& items)
+void KFileItemModel::slotItemsAdded(const KUrl& directoryUrl, const KFileItemList& newItems)
 {
-    Q_ASSERT(!items.isEmpty());
+    Q_ASSERT(!newItems.isEmpty());
+
+    KFileItemList items = newItems;
+    if (!m_snapshotUrls.isEmpty()) {
+        items = replaceSnapshotItems(newItems);
+        if (items.isEmpty()) {
+            return;
+        }
+    }
 
     KUrl parentUrl;
     if (m_expandedDirs.contains(directoryUrl)) {
@@ -843,7 +965,7 @@ void KFileItemModel::slotItemsAdded(const KUrl& directoryUrl, const KFileItemLis
         // before inserting them into the model and remember
         // the filtered items in m_filteredItems.
         foreach (ItemData* itemData, itemDataList) {
-            if (m_filter.matches(itemData->item)) {
+            if (m_filter.matches(itemData->item, filterText(itemData))) {
                 m_pendingItemsToInsert.append(itemData);
             } else {
                 m_filteredItems.insert(itemData->item, itemData);
@@ -928,6 +1050,7 @@ void KFileItemModel::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >&
         const int index = m_items.value(oldItem.url(), -1);
         if (index >= 0) {
             m_itemData[index]->item = newItem;
+            m_itemData[index]->lowerCaseText.clear();
 
             // Keep old values as long as possible if they could not retrieved synchronously yet.
             // The update of the values will be done asynchronously by KFileItemModelRolesUpdater.
@@ -941,6 +1064,10 @@ void KFileItemModel::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >&
                     changedRoles.insert(role);
                 }
             }
+            updateSortValues(m_itemData[index]);
+            if (oldItem.text() != newItem.text()) {
+                updateTextSortKey(m_itemData[index]);
+            }
 
             m_items.remove(oldItem.url());
             m_items.insert(newItem.url(), index);
@@ -976,6 +1103,9 @@ void KFileItemModel::slotClear()
     qDeleteAll(m_pendingItemsToInsert);
     m_pendingItemsToInsert.clear();
 
+    m_snapshotUrls.clear();
+    m_snapshotDirectory.clear();
+
     const int removedCount = m_itemData.count();
     if (removedCount > 0) {
         qDeleteAll(m_itemData);
@@ -995,6 +1125,7 @@ void KFileItemModel::slotClear(const KUrl& url)
 void KFileItemModel::slotNaturalSortingChanged()
 {
     m_naturalSorting = KGlobalSettings::naturalSorting();
+    updateAllSortValues();
     resortAllItems();
 }
 
@@ -1006,6 +1137,26 @@ void KFileItemModel::dispatchPendingItemsToInsert()
     }
 }
 
+/**
+ * Helper class for KFileItemModel::sort() and KFileItemModel::insertItems().
+ */
+class KFileItemModelLessThan
+{
+public:
+    KFileItemModelLessThan(const KFileItemModel* model) :
+        m_model(model)
+    {
+    }
+
+    bool operator()(const KFileItemModel::ItemData* a, const KFileItemModel::ItemData* b) const
+    {
+        return m_model->lessThan(a, b);
+    }
+
+private:
+    const KFileItemModel* m_model;
+};
+
 void KFileItemModel::insertItems(QList<ItemData*>& newItems)
 {
     if (newItems.isEmpty()) {
@@ -1038,6 +1189,30 @@ void KFileItemModel::insertItems(QList<ItemData*>& newItems)
         m_itemData = newItems;
         itemRanges << KItemRange(0, newItemCount);
     } else {
+        // If only a few items are inserted into a large model, e.g., because files
+        // are created one after another in a directory that is being watched,
+        // finding the position of each new item by a binary search needs far less
+        // comparisons than comparing the new items with all existing items behind
+        // the first inserted item.
+        int binarySearchComparisons = 0;
+        for (int i = existingItemCount; i > 0; i /= 2) {
+            binarySearchComparisons += newItemCount;
+        }
+        const bool useBinarySearch = (binarySearchComparisons < existingItemCount);
+
+        // insertPositions[i] is the index of the first existing item that must be
+        // ordered behind the new item i.
+        QVector<int> insertPositions;
+        if (useBinarySearch) {
+            insertPositions.reserve(newItemCount);
+            KFileItemModelLessThan lessThan(this);
+            QList<ItemData*>::const_iterator first = m_itemData.constBegin();
+            foreach (const ItemData* newItem, newItems) {
+                first = std::upper_bound(first, m_itemData.constEnd(), newItem, lessThan);
+                insertPositions.append(first - m_itemData.constBegin());
+            }
+        }
+
         m_itemData.reserve(totalItemCount);
         for (int i = existingItemCount; i < totalItemCount; ++i) {
             m_itemData.append(0);
@@ -1053,7 +1228,13 @@ void KFileItemModel::insertItems(QList<ItemData*>& newItems)
 
         while (sourceIndexNewItems >= 0) {
             ItemData* newItem = newItems.at(sourceIndexNewItems);
-            if (sourceIndexExistingItems >= 0 && lessThan(newItem, m_itemData.at(sourceIndexExistingItems))) {
+            bool moveExistingItem = false;
+            if (sourceIndexExistingItems >= 0) {
+                moveExistingItem = useBinarySearch
+                                   ? sourceIndexExistingItems >= insertPositions.at(sourceIndexNewItems)
+                                   : lessThan(newItem, m_itemData.at(sourceIndexExistingItems));
+            }
+            if (moveExistingItem) {
                 // Move an existing item to its new position. If any new items
                 // are behind it, push the item range to itemRanges.
                 if (rangeCount > 0) {
@@ -1172,6 +1353,8 @@ QList<KFileItemModel::ItemData*> KFileItemModel::createItemDataList(const KUrl&
         ItemData* itemData = new ItemData();
         itemData->item = item;
         itemData->parent = parentItem;
+        updateSortValues(itemData);
+        updateTextSortKey(itemData);
         itemDataList.append(itemData);
     }
 
@@ -1256,6 +1439,133 @@ void KFileItemModel::removeExpandedItems()
     }
 }
 
+void KFileItemModel::insertSnapshotItems(const KUrl& url)
+{
+    KUrl directoryUrl = url;
+    directoryUrl.adjustPath(KUrl::RemoveTrailingSlash);
+    if (!directoryUrl.isLocalFile()) {
+        return;
+    }
+
+    // Store a new snapshot after the loading has been completed.
+    m_snapshotDirectory = directoryUrl;
+    m_snapshotItemCount = 0;
+    m_snapshotChanged = false;
+
+    if (count() > 0 || !m_pendingItemsToInsert.isEmpty() || m_filter.hasSetFilters()) {
+        // The snapshot can only be used if the dir lister has not provided
+        // any items yet. Filtered items are not supported for simplicity.
+        return;
+    }
+
+    const KFileItemList items = KFileItemModelSnapshot::load(directoryUrl, snapshotOptions());
+    if (items.isEmpty()) {
+        return;
+    }
+
+#ifdef KFILEITEMMODEL_DEBUG
+    kDebug() << "Inserting" << items.count() << "items from the snapshot of" << directoryUrl;
+#endif
+
+    m_snapshotItemCount = items.count();
+    m_snapshotUrls.reserve(items.count());
+    foreach (const KFileItem& item, items) {
+        m_snapshotUrls.insert(item.url());
+    }
+
+    QList<ItemData*> itemDataList = createItemDataList(directoryUrl, items);
+    insertItems(itemDataList);
+}
+
+KFileItemList KFileItemModel::replaceSnapshotItems(const KFileItemList& items)
+{
+    KFileItemList newItems;
+    QList<QPair<KFileItem, KFileItem> > changedItems;
+
+    foreach (const KFileItem& item, items) {
+        const KUrl url = item.url();
+        if (!m_snapshotUrls.remove(url)) {
+            newItems.append(item);
+            continue;
+        }
+
+        const int index = m_items.value(url, -1);
+        if (index < 0) {
+            newItems.append(item);
+            continue;
+        }
+
+        const KFileItem& snapshotItem = m_itemData.at(index)->item;
+        if (snapshotItem.cmp(item)) {
+            // Prefer the item from the dir lister, which might provide
+            // more information, but there is no need to update the view.
+            m_itemData[index]->item = item;
+        } else {
+            changedItems.append(qMakePair(snapshotItem, item));
+        }
+    }
+
+    if (!changedItems.isEmpty()) {
+        m_snapshotChanged = true;
+        slotRefreshItems(changedItems);
+    }
+
+    return newItems;
+}
+
+void KFileItemModel::finishSnapshot()
+{
+    if (!m_snapshotUrls.isEmpty()) {
+        // Remove the items that have been deleted since the snapshot has been stored.
+        KFileItemList removedItems;
+        foreach (const KUrl& url, m_snapshotUrls) {
+            const int index = m_items.value(url, -1);
+            if (index >= 0) {
+                removedItems.append(m_itemData.at(index)->item);
+            }
+        }
+        m_snapshotUrls.clear();
+
+        if (!removedItems.isEmpty()) {
+            m_snapshotChanged = true;
+            slotItemsDeleted(removedItems);
+        }
+    }
+
+    if (m_filter.hasSetFilters()) {
+        // Filtered items are not part of m_itemData, so the snapshot would be incomplete.
+        m_snapshotDirectory.clear();
+        return;
+    }
+
+    KFileItemList items;
+    items.reserve(count());
+    foreach (const ItemData* itemData, m_itemData) {
+        if (!itemData->parent) {
+            items.append(itemData->item);
+        }
+    }
+
+    // If no item has been changed or removed, the listing only differs from the
+    // snapshot if the dir lister has provided additional items.
+    if (m_snapshotChanged || items.count() != m_snapshotItemCount) {
+        KFileItemModelSnapshot::save(m_snapshotDirectory, snapshotOptions(), items);
+    }
+    m_snapshotDirectory.clear();
+}
+
+KFileItemModelSnapshot::Options KFileItemModel::snapshotOptions() const
+{
+    KFileItemModelSnapshot::Options options;
+    if (showHiddenFiles()) {
+        options |= KFileItemModelSnapshot::HiddenFiles;
+    }
+    if (showDirectoriesOnly()) {
+        options |= KFileItemModelSnapshot::DirectoriesOnly;
+    }
+    return options;
+}
+
 void KFileItemModel::emitItemsChangedAndTriggerResorting(const KItemRangeList& itemRanges, const QSet<QByteArray>& changedRoles)
 {
     emit itemsChanged(itemRanges, changedRoles);
@@ -1392,6 +1702,11 @@ QHash<QByteArray, QVariant> KFileItemModel::retrieveData(const KFileItem& item,
         data.insert(sharedValue("size"), item.size());
     }
 
+    if (m_requestRole[RecursiveSizeRole] && !isDir) {
+        // The total size of directories is calculated by KFileItemModelRolesUpdater
+        data.insert(sharedValue("recursiveSize"), item.size());
+    }
+
     if (m_requestRole[DateRole]) {
         // Don't use KFileItem::timeString() as this is too expensive when
         // having several thousands of items. Instead the formatting of the
@@ -1468,6 +1783,54 @@ QHash<QByteArray, QVariant> KFileItemModel::retrieveData(const KFileItem& item,
     return data;
 }
 
+void KFileItemModel::updateSortValues(ItemData* data) const
+{
+    const KFileItem& item = data->item;
+    SortValues& sortValues = data->sortValues;
+
+    if (item.isDir()) {
+        // For directories the "size" role contains the number of sub-items,
+        // which gets resolved asynchronously by KFileItemModelRolesUpdater.
+        const QVariant subItemsCount = data->values.value("size");
+        sortValues.size = 0;
+        sortValues.subItemsCount = subItemsCount.isNull() ? UnknownSubItemsCount : subItemsCount.toInt();
+
+        // The total size of the directory tree gets resolved asynchronously as well
+        const QVariant recursiveSize = data->values.value("recursiveSize");
+        sortValues.recursiveSize = recursiveSize.isNull() ? -1 : recursiveSize.toLongLong();
+    } else {
+        sortValues.size = item.size();
+        sortValues.subItemsCount = UnknownSubItemsCount;
+        sortValues.recursiveSize = item.size();
+    }
+
+    const KDateTime dateTime = item.time(KFileItem::ModificationTime);
+    sortValues.date = dateTime.isValid() ? dateTime.toTime_t() : -1;
+
+    sortValues.rating = data->values.value("rating").toInt();
+}
+
+void KFileItemModel::updateTextSortKey(ItemData* data) const
+{
+    data->sortValues.textKey = textSortKey(data->item.text());
+}
+
+void KFileItemModel::updateAllSortValues()
+{
+    foreach (ItemData* itemData, m_itemData) {
+        updateSortValues(itemData);
+        updateTextSortKey(itemData);
+    }
+    foreach (ItemData* itemData, m_filteredItems) {
+        updateSortValues(itemData);
+        updateTextSortKey(itemData);
+    }
+    foreach (ItemData* itemData, m_pendingItemsToInsert) {
+        updateSortValues(itemData);
+        updateTextSortKey(itemData);
+    }
+}
+
 bool KFileItemModel::lessThan(const ItemData* a, const ItemData* b) const
 {
     int result = 0;
@@ -1518,26 +1881,6 @@ bool KFileItemModel::lessThan(const ItemData* a, const ItemData* b) const
     return (sortOrder() == Qt::AscendingOrder) ? result < 0 : result > 0;
 }
 
-/**
- * Helper class for KFileItemModel::sort().
- */
-class KFileItemModelLessThan
-{
-public:
-    KFileItemModelLessThan(const KFileItemModel* model) :
-        m_model(model)
-    {
-    }
-
-    bool operator()(const KFileItemModel::ItemData* a, const KFileItemModel::ItemData* b) const
-    {
-        return m_model->lessThan(a, b);
-    }
-
-private:
-    const KFileItemModel* m_model;
-};
-
 void KFileItemModel::sort(QList<KFileItemModel::ItemData*>::iterator begin,
                           QList<KFileItemModel::ItemData*>::iterator end) const
 {
@@ -1573,46 +1916,54 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b) const
             // See "if (m_sortFoldersFirst || m_sortRole == SizeRole)" in KFileItemModel::lessThan():
             Q_ASSERT(itemB.isDir());
 
-            const QVariant valueA = a->values.value("size");
-            const QVariant valueB = b->values.value("size");
-            if (valueA.isNull() && valueB.isNull()) {
-                result = 0;
-            } else if (valueA.isNull()) {
-                result = -1;
-            } else if (valueB.isNull()) {
+            // Directories with an unknown number of sub-items are sorted
+            // first, as UnknownSubItemsCount is smaller than any count.
+            const int countA = a->sortValues.subItemsCount;
+            const int countB = b->sortValues.subItemsCount;
+            if (countA > countB) {
                 result = +1;
-            } else {
-                result = valueA.toInt() - valueB.toInt();
+            } else if (countA < countB) {
+                result = -1;
             }
         } else {
             // See "if (m_sortFoldersFirst || m_sortRole == SizeRole)" in KFileItemModel::lessThan():
             Q_ASSERT(!itemB.isDir());
-            const KIO::filesize_t sizeA = itemA.size();
-            const KIO::filesize_t sizeB = itemB.size();
+            const KIO::filesize_t sizeA = a->sortValues.size;
+            const KIO::filesize_t sizeB = b->sortValues.size;
             if (sizeA > sizeB) {
                 result = +1;
             } else if (sizeA < sizeB) {
                 result = -1;
-            } else {
-                result = 0;
             }
         }
         break;
     }
 
+    case RecursiveSizeRole: {
+        // Directories with an unknown size are sorted first
+        const qint64 sizeA = a->sortValues.recursiveSize;
+        const qint64 sizeB = b->sortValues.recursiveSize;
+        if (sizeA > sizeB) {
+            result = +1;
+        } else if (sizeA < sizeB) {
+            result = -1;
+        }
+        break;
+    }
+
     case DateRole: {
-        const KDateTime dateTimeA = itemA.time(KFileItem::ModificationTime);
-        const KDateTime dateTimeB = itemB.time(KFileItem::ModificationTime);
-        if (dateTimeA < dateTimeB) {
+        const qint64 dateA = a->sortValues.date;
+        const qint64 dateB = b->sortValues.date;
+        if (dateA < dateB) {
             result = -1;
-        } else if (dateTimeA > dateTimeB) {
+        } else if (dateA > dateB) {
             result = +1;
         }
         break;
     }
 
     case RatingRole: {
-        result = a->values.value("rating").toInt() - b->values.value("rating").toInt();
+        result = a->sortValues.rating - b->sortValues.rating;
         break;
     }
 
@@ -1639,8 +1990,21 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b) const
         return result;
     }
 
-    // Fallback #1: Compare the text of the items
-    result = stringCompare(itemA.text(), itemB.text());
+    // Fallback #1: Compare the text of the items. The pre-computed sort keys
+    // define the order in most cases, only equal or missing keys require
+    // comparing the texts themselves.
+    const QByteArray& keyA = a->sortValues.textKey;
+    const QByteArray& keyB = b->sortValues.textKey;
+    if (!keyA.isEmpty() && !keyB.isEmpty()) {
+        const int keyLength = qMin(keyA.length(), keyB.length());
+        result = memcmp(keyA.constData(), keyB.constData(), keyLength);
+        if (result == 0) {
+            result = keyA.length() - keyB.length();
+        }
+    }
+    if (result == 0) {
+        result = stringCompare(itemA.text(), itemB.text());
+    }
     if (result != 0) {
         return result;
     }
@@ -1680,6 +2044,151 @@ int KFileItemModel::stringCompare(const QString& a, const QString& b) const
                             : QString::compare(a, b, Qt::CaseSensitive);
 }
 
+QByteArray KFileItemModel::textSortKey(const QString& text) const
+{
+    // Valid keys start with a non-zero byte, so that an empty key
+    // indicates that the text must be compared with stringCompare().
+    QByteArray key(1, '\x01');
+    key.reserve(text.length() * 4);
+
+    if (!m_naturalSorting) {
+        // QString::compare() compares the UTF-16 code units, which is equivalent
+        // to comparing their big-endian byte representation.
+        const QString folded = (m_caseSensitivity == Qt::CaseInsensitive) ? text.toCaseFolded() : text;
+        const QChar* c = folded.constData();
+        const QChar* end = c + folded.length();
+        for (; c != end; ++c) {
+            if (c->isHighSurrogate() || c->isLowSurrogate()) {
+                // Case folding might differ for characters outside the BMP
+                return QByteArray();
+            }
+            key.append(char(c->row()));
+            key.append(char(c->cell()));
+        }
+        return key;
+    }
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+    // The key reproduces the steps of KStringHandler::naturalCompare(), which
+    // splits the text into sequences of "letters", of punctuation and spaces
+    // ("separators") and of digits:
+    // - Letter sequences are compared by QString::localeAwareCompare(), which
+    //   is based on strcoll() on Unix. Comparing the strxfrm() keys gives the
+    //   same results. The key is terminated by '\0', which is smaller than any
+    //   byte of a strxfrm() key.
+    // - Separators are compared by their code.
+    // - Digit sequences starting with '0' are compared digit by digit, where
+    //   the shorter sequence is sorted after the longer one. Other digit
+    //   sequences are compared by their value.
+    // If separators are followed by different kinds of sequences,
+    // naturalCompare() compares the first characters of the sequences in a
+    // specific way, which is reproduced by the order of the marker bytes
+    // below. The rare cases that cannot be reproduced fall back to
+    // stringCompare().
+    enum Marker {
+        LeadingZeroDigits = 0x02,     // Digit sequence starting with '0'
+        EndAfterSeparators = 0x03,    // The text ends with separators
+        LowSeparator = 0x04,          // Separator with a code smaller than '0'
+        Digits = 0x05,                // Digit sequence not starting with '0'
+        HighSeparator = 0x06,         // Separator with a code greater than '9'
+        LettersAfterSeparators = 0x07,
+        LeadingZeroDigitsEnd = 0x7F   // Greater than any digit
+    };
+
+    const QString lowered = (m_caseSensitivity == Qt::CaseInsensitive) ? text.toLower() : text;
+    const QChar* c = lowered.constData();
+    const QChar* end = c + lowered.length();
+    while (true) {
+        const QChar* begin = c;
+        while (c != end && !c->isDigit() && !c->isPunct() && !c->isSpace()) {
+            const ushort unicode = c->unicode();
+            if (unicode < '1' || unicode == QChar::ObjectReplacementCharacter || unicode == QChar::ReplacementCharacter) {
+                // naturalCompare() compares symbols like '$' or '+' with digits
+                // by their code, and it handles replacement characters specially.
+                return QByteArray();
+            }
+            ++c;
+        }
+
+        if (c != begin) {
+            const QByteArray local8Bit = QString::fromRawData(begin, c - begin).toLocal8Bit();
+            const size_t size = strxfrm(0, local8Bit.constData(), 0);
+            const int oldLength = key.length();
+            key.resize(oldLength + size + 1);
+            strxfrm(key.data() + oldLength, local8Bit.constData(), size + 1);
+            key.resize(oldLength + size);
+        }
+        key.append('\0');
+
+        if (c == end) {
+            break;
+        }
+
+        begin = c;
+        while (c != end && (c->isPunct() || c->isSpace())) {
+            if (c->unicode() == QChar::ObjectReplacementCharacter || c->unicode() == QChar::ReplacementCharacter) {
+                return QByteArray();
+            }
+            key.append(char(c->unicode() < '0' ? LowSeparator : HighSeparator));
+            key.append(char(c->row()));
+            key.append(char(c->cell()));
+            ++c;
+        }
+
+        if (c == end) {
+            if (c != begin) {
+                key.append(char(EndAfterSeparators));
+            }
+            break;
+        }
+
+        if (!c->isDigit()) {
+            // Separators are followed by letters
+            key.append(char(LettersAfterSeparators));
+            continue;
+        }
+
+        begin = c;
+        while (c != end && c->isDigit()) {
+            if (c->unicode() > '9') {
+                // naturalCompare() compares non-ASCII digits by their code
+                return QByteArray();
+            }
+            ++c;
+        }
+
+        const int digitsCount = c - begin;
+        if (*begin == QLatin1Char('0')) {
+            key.append(char(LeadingZeroDigits));
+            for (int i = 0; i < digitsCount; ++i) {
+                key.append(char(begin[i].unicode()));
+            }
+            key.append(char(LeadingZeroDigitsEnd));
+        } else {
+            if (digitsCount > 0xFFFF) {
+                return QByteArray();
+            }
+            key.append(char(Digits));
+            key.append(char(digitsCount >> 8));
+            key.append(char(digitsCount & 0xFF));
+            for (int i = 0; i < digitsCount; ++i) {
+                key.append(char(begin[i].unicode()));
+            }
+        }
+
+        if (c == end) {
+            break;
+        }
+    }
+
+    return key;
+#else
+    // QString::localeAwareCompare() is not based on strcoll()
+    Q_UNUSED(key);
+    return QByteArray();
+#endif
+}
+
 bool KFileItemModel::useMaximumUpdateInterval() const
 {
     return !m_dirLister->url().isLocalFile();
@@ -1787,6 +2296,40 @@ QList<QPair<int, QVariant> > KFileItemModel::sizeRoleGroups() const
     return groups;
 }
 
+QList<QPair<int, QVariant> > KFileItemModel::recursiveSizeRoleGroups() const
+{
+    Q_ASSERT(!m_itemData.isEmpty());
+
+    const int maxIndex = count() - 1;
+    QList<QPair<int, QVariant> > groups;
+
+    QString groupValue;
+    for (int i = 0; i <= maxIndex; ++i) {
+        if (isChildItem(i)) {
+            continue;
+        }
+
+        const qint64 size = m_itemData.at(i)->sortValues.recursiveSize;
+        QString newGroupValue;
+        if (size < 0) {
+            newGroupValue = i18nc("@title:group Size", "Unknown");
+        } else if (size < 5 * 1024 * 1024) {
+            newGroupValue = i18nc("@title:group Size", "Small");
+        } else if (size < 10 * 1024 * 1024) {
+            newGroupValue = i18nc("@title:group Size", "Medium");
+        } else {
+            newGroupValue = i18nc("@title:group Size", "Big");
+        }
+
+        if (newGroupValue != groupValue) {
+            groupValue = newGroupValue;
+            groups.append(QPair<int, QVariant>(i, newGroupValue));
+        }
+    }
+
+    return groups;
+}
+
 QList<QPair<int, QVariant> > KFileItemModel::dateRoleGroups() const
 {
     Q_ASSERT(!m_itemData.isEmpty());
@@ -1953,7 +2496,7 @@ QList<QPair<int, QVariant> > KFileItemModel::ratingRoleGroups() const
         if (isChildItem(i)) {
             continue;
         }
-        const int newGroupValue = m_itemData.at(i)->values.value("rating", 0).toInt();
+        const int newGroupValue = m_itemData.at(i)->sortValues.rating;
         if (newGroupValue != groupValue) {
             groupValue = newGroupValue;
             groups.append(QPair<int, QVariant>(i, newGroupValue));
@@ -2036,6 +2579,7 @@ const KFileItemModel::RoleInfoMap* KFileItemModel::rolesInfoMap(int& count)
         { "duration",    DurationRole,    I18N_NOOP2_NOSTRIP("@label", "Duration"),         I18N_NOOP2_NOSTRIP("@label", "Audio"),    true,  true  },
         { "track",       TrackRole,       I18N_NOOP2_NOSTRIP("@label", "Track"),            I18N_NOOP2_NOSTRIP("@label", "Audio"),    true,  true  },
         { "path",        PathRole,        I18N_NOOP2_NOSTRIP("@label", "Path"),             I18N_NOOP2_NOSTRIP("@label", "Other"),    false, false },
+        { "recursiveSize", RecursiveSizeRole, I18N_NOOP2_NOSTRIP("@label", "Total Size"),   I18N_NOOP2_NOSTRIP("@label", "Other"),    false, false },
         { "destination", DestinationRole, I18N_NOOP2_NOSTRIP("@label", "Link Destination"), I18N_NOOP2_NOSTRIP("@label", "Other"),    false, false },
         { "copiedFrom",  CopiedFromRole,  I18N_NOOP2_NOSTRIP("@label", "Copied From"),      I18N_NOOP2_NOSTRIP("@label", "Other"),    true,  false },
         { "permissions", PermissionsRole, I18N_NOOP2_NOSTRIP("@label", "Permissions"),      I18N_NOOP2_NOSTRIP("@label", "Other"),    false, false },
@@ -2056,8 +2600,9 @@ void KFileItemModel::determineMimeTypes(const KFileItemList& items, int timeout)
         // KFileItem::determineMimeType() reads the .directory file inside to
         // load the icon, but this is not necessary at all if we just need the
         // type. Some special code for setting the correct mime type for
-        // directories is in retrieveData().
-        if (!item.isDir()) {
+        // directories is in retrieveData(). Files on slow mounts are left
+        // to the KMimeTypeDetector of KFileItemModelRolesUpdater.
+        if (!item.isDir() && !KMimeTypeDetector::isSlow(item)) {
             item.determineMimeType();
         }
 
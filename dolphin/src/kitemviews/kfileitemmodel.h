@@ -25,8 +25,13 @@
 #include <KUrl>
 #include <kitemviews/kitemmodelbase.h>
 #include <kitemviews/private/kfileitemmodelfilter.h>
+#include <kitemviews/private/kfileitemmodelsnapshot.h>
 
 #include <QHash>
+#include <QMap>
+#include <QVector>
+
+#include <climits>
 
 class KFileItemModelDirLister;
 class QTimer;
@@ -54,6 +59,10 @@ public:
      * directoryLoadingStarted(), directoryLoadingProgress() and directoryLoadingCompleted()
      * indicate the current state of the loading process. The items
      * of the directory are added after the loading has been completed.
+     *
+     * If a snapshot of a large local directory is available (see
+     * KFileItemModelSnapshot), its items are added immediately and
+     * updated as soon as the actual items have been loaded.
      */
     void loadDirectory(const KUrl& url);
 
@@ -81,6 +90,13 @@ public:
     virtual QHash<QByteArray, QVariant> data(int index) const;
     virtual bool setData(int index, const QHash<QByteArray, QVariant>& values);
 
+    /**
+     * Sets the values of several items at once. The keys of \a itemsValues
+     * are the indexes of the items. In contrast to invoking setData() for
+     * each item, the signal itemsChanged() is emitted only once.
+     */
+    void setItemsData(const QMap<int, QHash<QByteArray, QVariant> >& itemsValues);
+
     /**
      * Sets a separate sorting with directories first (true) or a mixed
      * sorting of files and directories (false).
@@ -99,7 +115,7 @@ public:
     bool showDirectoriesOnly() const;
 
     /** @reimp */
-    virtual QMimeData* createMimeData(const QSet<int>& indexes) const;
+    virtual QMimeData* createMimeData(const KItemSet& indexes) const;
 
     /** @reimp */
     virtual int indexForKeyboardSearch(const QString& text, int startFromIndex = 0) const;
@@ -272,7 +288,7 @@ private slots:
 
     void slotCompleted();
     void slotCanceled();
-    void slotItemsAdded(const KUrl& directoryUrl, const KFileItemList& items);
+    void slotItemsAdded(const KUrl& directoryUrl, const KFileItemList& newItems);
     void slotItemsDeleted(const KFileItemList& items);
     void slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >& items);
     void slotClear();
@@ -285,7 +301,7 @@ private:
     enum RoleType {
         // User visible roles:
         NoRole, NameRole, SizeRole, DateRole, PermissionsRole, OwnerRole,
-        GroupRole, TypeRole, DestinationRole, PathRole,
+        GroupRole, TypeRole, DestinationRole, PathRole, RecursiveSizeRole,
         // User visible roles available with Nepomuk:
         CommentRole, TagsRole, RatingRole, ImageSizeRole, OrientationRole,
         WordCountRole, LineCountRole, ArtistRole, AlbumRole, DurationRole, TrackRole,
@@ -296,11 +312,32 @@ private:
         RolesCount
     };
 
+    enum { UnknownSubItemsCount = INT_MIN };
+
+    /**
+     * Typed copies of the role-values that are compared by sortRoleCompare().
+     * Keeping them next to the item prevents a QHash lookup and a QVariant
+     * conversion for each of the O(n * log(n)) comparisons when sorting.
+     * The values are kept in sync with ItemData::values by updateSortValues().
+     */
+    struct SortValues
+    {
+        SortValues() : size(0), subItemsCount(UnknownSubItemsCount), recursiveSize(-1), date(0), rating(0), textKey() {}
+        KIO::filesize_t size;  // Size of a file
+        int subItemsCount;     // Number of items inside a directory (role "size")
+        qint64 recursiveSize;  // Size of a file or directory tree, -1 if unknown (role "recursiveSize")
+        qint64 date;           // Modification time in seconds since 1970
+        int rating;
+        QByteArray textKey;    // Sort key for KFileItem::text(), see textSortKey()
+    };
+
     struct ItemData
     {
         KFileItem item;
         QHash<QByteArray, QVariant> values;
         ItemData* parent;
+        SortValues sortValues;
+        QString lowerCaseText; // Lower case version of item.text(), see filterText()
     };
 
     enum RemoveItemsBehavior {
@@ -323,6 +360,36 @@ private:
 
     void removeExpandedItems();
 
+    /**
+     * Inserts the items of the snapshot of the directory \a url, if
+     * a valid snapshot is available.
+     */
+    void insertSnapshotItems(const KUrl& url);
+
+    /**
+     * Replaces the items from the snapshot by the items \a items, which
+     * have been received from the dir lister. Emits itemsChanged() only for
+     * items that are different from the snapshot.
+     * @return Items that have not been part of the snapshot.
+     */
+    KFileItemList replaceSnapshotItems(const KFileItemList& items);
+
+    /**
+     * Removes the items from the snapshot that have not been received from
+     * the dir lister, and stores a new snapshot of the directory if the
+     * listing differs from the old snapshot.
+     */
+    void finishSnapshot();
+
+    KFileItemModelSnapshot::Options snapshotOptions() const;
+
+    /**
+     * Applies the values \a values to the item with the index \a index
+     * without emitting itemsChanged().
+     * @return Roles whose values have been changed.
+     */
+    QSet<QByteArray> applyData(int index, const QHash<QByteArray, QVariant>& values);
+
     /**
      * This function is called by setData() and slotRefreshItems(). It emits
      * the itemsChanged() signal, checks if the sort order is still correct,
@@ -349,6 +416,27 @@ private:
 
     QHash<QByteArray, QVariant> retrieveData(const KFileItem& item, const ItemData* parent) const;
 
+    /**
+     * Updates ItemData::sortValues from the KFileItem and the
+     * role-values of \a data. Must be invoked each time one of them
+     * has been changed. The text sort key is not touched, see
+     * updateTextSortKey().
+     */
+    void updateSortValues(ItemData* data) const;
+
+    /**
+     * Updates SortValues::textKey of \a data. Must be invoked if the
+     * text of the item has been changed.
+     */
+    void updateTextSortKey(ItemData* data) const;
+
+    /**
+     * Updates the sort values of all items, including the filtered and
+     * the pending items. Must be invoked if the natural sorting or the
+     * case sensitivity has been changed.
+     */
+    void updateAllSortValues();
+
     /**
      * @return True if the item-data \a a should be ordered before the item-data
      *         \b. The item-data may have different parent-items.
@@ -370,10 +458,23 @@ private:
 
     int stringCompare(const QString& a, const QString& b) const;
 
+    /**
+     * @return Binary sort key for \a text. Comparing two keys with memcmp()
+     *         orders the texts like stringCompare() does. Texts that only differ
+     *         in the case get equal keys, hence stringCompare() must be used as
+     *         fallback if the keys are equal. An empty key is returned if the
+     *         order of stringCompare() cannot be reproduced for \a text, which
+     *         must then be compared with stringCompare() as well. Computing the
+     *         key once per item is much cheaper than comparing the texts for each
+     *         of the O(n * log(n)) comparisons when sorting.
+     */
+    QByteArray textSortKey(const QString& text) const;
+
     bool useMaximumUpdateInterval() const;
 
     QList<QPair<int, QVariant> > nameRoleGroups() const;
     QList<QPair<int, QVariant> > sizeRoleGroups() const;
+    QList<QPair<int, QVariant> > recursiveSizeRoleGroups() const;
     QList<QPair<int, QVariant> > dateRoleGroups() const;
     QList<QPair<int, QVariant> > permissionRoleGroups() const;
     QList<QPair<int, QVariant> > ratingRoleGroups() const;
@@ -395,10 +496,37 @@ private:
      */
     void emitSortProgress(int resolvedCount);
 
+    enum FilterScope {
+        AllItems,
+        VisibleItems
+    };
+
     /**
      * Applies the filters set through @ref setNameFilter and @ref setMimeTypeFilters.
+     * If \a scope is VisibleItems, the filtered items are not checked again, as
+     * it is known that they still don't match (e.g. the name filter got narrowed).
      */
-    void applyFilters();
+    void applyFilters(FilterScope scope = AllItems);
+
+    /**
+     * @return For each item of \a items whether it matches the filter. Large
+     *         lists of items are split into chunks that are checked concurrently.
+     */
+    QVector<bool> filterMatches(const QList<ItemData*>& items) const;
+
+    /**
+     * Checks the items between \a begin and \a end against \a filter and
+     * stores the result in \a matches. Is invoked by filterMatches() and
+     * must not access any member, as it may run in several threads.
+     */
+    static void matchItems(const KFileItemModelFilter& filter, const QList<ItemData*>& items,
+                           int begin, int end, bool* matches);
+
+    /**
+     * @return Lower case version of the text of \a data, which is folded only
+     *         once per item and then cached in ItemData::lowerCaseText.
+     */
+    static const QString& filterText(ItemData* data);
 
     /**
      * Removes filtered items whose expanded parents have been deleted
@@ -477,8 +605,20 @@ private:
     // and done step after step in slotCompleted().
     QSet<KUrl> m_urlsToExpand;
 
+    // URLs of the items that have been inserted from a snapshot and have not been
+    // received from the dir lister yet. See KFileItemModel::insertSnapshotItems().
+    QSet<KUrl> m_snapshotUrls;
+
+    // Directory for which a snapshot should be stored after the loading has been completed.
+    KUrl m_snapshotDirectory;
+
+    // Number of items that have been inserted from the snapshot, and whether the
+    // listing of the dir lister differs from them. An unchanged snapshot is not stored again.
+    int m_snapshotItemCount;
+    bool m_snapshotChanged;
+
     friend class KFileItemModelLessThan;       // Accesses lessThan() method
-    friend class KFileItemModelRolesUpdater;   // Accesses emitSortProgress() method
+    friend class KFileItemModelRolesUpdater;   // Accesses emitSortProgress() and slotRefreshItems()
     friend class KFileItemModelTest;           // For unit testing
     friend class KFileItemModelBenchmark;      // For unit testing
     friend class KFileItemListViewTest;        // For unit testing
@@ -31,9 +31,13 @@
 
 #include "private/kpixmapmodifier.h"
 #include "private/kdirectorycontentscounter.h"
+#include "private/kdirectorysizecounter.h"
+#include "private/kmimetypedetector.h"
+#include "private/kpreviewcache.h"
+#include "private/kpreviewprocessor.h"
 
 #include <QApplication>
-#include <QPainter>
+#include <QImage>
 #include <QPixmap>
 #include <QElapsedTimer>
 #include <QTimer>
@@ -87,7 +91,10 @@ KFileItemModelRolesUpdater::KFileItemModelRolesUpdater(KFileItemModel* model, QO
     m_recentlyChangedItemsTimer(0),
     m_recentlyChangedItems(),
     m_changedItems(),
-    m_directoryContentsCounter(0)
+    m_directoryContentsCounter(0),
+    m_directorySizeCounter(0),
+    m_mimeTypeDetector(0),
+    m_previewProcessor(0)
   #ifdef HAVE_NEPOMUK
   , m_nepomukResourceWatcher(0),
     m_nepomukUriItems()
@@ -120,6 +127,7 @@ KFileItemModelRolesUpdater::KFileItemModelRolesUpdater(KFileItemModel* model, QO
     connect(m_recentlyChangedItemsTimer, SIGNAL(timeout()), this, SLOT(resolveRecentlyChangedItems()));
 
     m_resolvableRoles.insert("size");
+    m_resolvableRoles.insert("recursiveSize");
     m_resolvableRoles.insert("type");
     m_resolvableRoles.insert("isExpandable");
 #ifdef HAVE_NEPOMUK
@@ -127,8 +135,25 @@ KFileItemModelRolesUpdater::KFileItemModelRolesUpdater(KFileItemModel* model, QO
 #endif
 
     m_directoryContentsCounter = new KDirectoryContentsCounter(m_model, this);
+
+    // Watching the counted directories requires one inotify watch for each
+    // directory, which might be exhausted by folders with many subfolders.
+    const KConfigGroup counterConfig(KGlobal::config(), "DirectoryContentsCounter");
+    m_directoryContentsCounter->setWatchDirectories(counterConfig.readEntry("WatchDirectories", true));
+
+    m_directorySizeCounter = new KDirectorySizeCounter(m_model, this);
+    connect(m_directorySizeCounter, SIGNAL(result(QString,KIO::filesize_t,bool)),
+            this,                   SLOT(slotDirectorySizeReceived(QString,KIO::filesize_t,bool)));
     connect(m_directoryContentsCounter, SIGNAL(result(QString,int)),
             this,                       SLOT(slotDirectoryContentsCountReceived(QString,int)));
+
+    m_mimeTypeDetector = new KMimeTypeDetector(this);
+    connect(m_mimeTypeDetector, SIGNAL(mimeTypesDetected(QHash<KUrl,QString>)),
+            this,               SLOT(slotMimeTypesDetected(QHash<KUrl,QString>)));
+
+    m_previewProcessor = new KPreviewProcessor(this);
+    connect(m_previewProcessor, SIGNAL(previewsProcessed(QHash<KUrl,QImage>)),
+            this,               SLOT(slotPreviewsProcessed(QHash<KUrl,QImage>)));
 }
 
 KFileItemModelRolesUpdater::~KFileItemModelRolesUpdater()
@@ -140,6 +165,11 @@ void KFileItemModelRolesUpdater::setIconSize(const QSize& size)
 {
     if (size != m_iconSize) {
         m_iconSize = size;
+        if (m_previewShown) {
+            // Previews that are processed currently have the old size
+            m_previewProcessor->clear();
+        }
+
         if (m_state == Paused) {
             m_iconSizeChangedDuringPausing = true;
         } else if (m_previewShown) {
@@ -262,6 +292,11 @@ void KFileItemModelRolesUpdater::setRoles(const QSet<QByteArray>& roles)
     if (m_roles != roles) {
         m_roles = roles;
 
+        if (!roles.contains("recursiveSize") && m_model->sortRole() != "recursiveSize") {
+            // Calculating the total size of large directory trees is expensive
+            m_directorySizeCounter->clear();
+        }
+
 #ifdef HAVE_NEPOMUK
         if (Nepomuk2::ResourceManager::instance()->initialized()) {
             // Check whether there is at least one role that must be resolved
@@ -395,6 +430,8 @@ void KFileItemModelRolesUpdater::slotItemsRemoved(const KItemRangeList& itemRang
         m_recentlyChangedItems.clear();
         m_recentlyChangedItemsTimer->stop();
         m_changedItems.clear();
+        m_mimeTypeDetector->clear();
+        m_previewProcessor->clear();
 
         killPreviewJob();
     } else {
@@ -502,70 +539,41 @@ void KFileItemModelRolesUpdater::slotGotPreview(const KFileItem& item, const QPi
         return;
     }
 
-    QPixmap scaledPixmap = pixmap;
-
     const QString mimeType = item.mimetype();
     const int slashIndex = mimeType.indexOf(QLatin1Char('/'));
     const QString mimeTypeGroup = mimeType.left(slashIndex);
-    if (mimeTypeGroup == QLatin1String("image")) {
-        if (m_enlargeSmallPreviews) {
-            KPixmapModifier::applyFrame(scaledPixmap, m_iconSize);
-        } else {
-            // Assure that small previews don't get enlarged. Instead they
-            // should be shown centered within the frame.
-            const QSize contentSize = KPixmapModifier::sizeInsideFrame(m_iconSize);
-            const bool enlargingRequired = scaledPixmap.width()  < contentSize.width() &&
-                                           scaledPixmap.height() < contentSize.height();
-            if (enlargingRequired) {
-                QSize frameSize = scaledPixmap.size();
-                frameSize.scale(m_iconSize, Qt::KeepAspectRatio);
-
-                QPixmap largeFrame(frameSize);
-                largeFrame.fill(Qt::transparent);
-
-                KPixmapModifier::applyFrame(largeFrame, frameSize);
-
-                QPainter painter(&largeFrame);
-                painter.drawPixmap((largeFrame.width()  - scaledPixmap.width()) / 2,
-                                   (largeFrame.height() - scaledPixmap.height()) / 2,
-                                   scaledPixmap);
-                scaledPixmap = largeFrame;
-            } else {
-                // The image must be shrinked as it is too large to fit into
-                // the available icon size
-                KPixmapModifier::applyFrame(scaledPixmap, m_iconSize);
-            }
-        }
-    } else {
-        KPixmapModifier::scale(scaledPixmap, m_iconSize);
-    }
+    const bool applyFrame = (mimeTypeGroup == QLatin1String("image"));
 
-    QHash<QByteArray, QVariant> data = rolesData(item);
+    // Scaling and framing is done by a worker thread. QPixmap may only be
+    // used by the main thread, so the preview is passed as QImage.
+    m_previewProcessor->addPreview(item.url(), pixmap.toImage(), m_iconSize,
+                                   applyFrame, m_enlargeSmallPreviews, previewCacheKey(item));
 
-    const QStringList overlays = data["iconOverlays"].toStringList();
-    // Strangely KFileItem::overlays() returns empty string-values, so
-    // we need to check first whether an overlay must be drawn at all.
-    // It is more efficient to do it here, as KIconLoader::drawOverlays()
-    // assumes that an overlay will be drawn and has some additional
-    // setup time.
-    foreach (const QString& overlay, overlays) {
-        if (!overlay.isEmpty()) {
-            // There is at least one overlay, draw all overlays above m_pixmap
-            // and cancel the check
-            KIconLoader::global()->drawOverlays(overlays, scaledPixmap, KIconLoader::Desktop);
-            break;
+    m_finishedItems.insert(item);
+}
+
+void KFileItemModelRolesUpdater::slotPreviewsProcessed(const QHash<KUrl, QImage>& previews)
+{
+    QMap<int, QHash<QByteArray, QVariant> > itemsData;
+
+    QHashIterator<KUrl, QImage> it(previews);
+    while (it.hasNext()) {
+        it.next();
+        const int index = m_model->index(it.key());
+        if (index >= 0) {
+            itemsData.insert(index, previewRolesData(m_model->fileItem(index), it.value()));
         }
     }
 
-    data.insert("iconPixmap", scaledPixmap);
+    if (itemsData.isEmpty()) {
+        return;
+    }
 
     disconnect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
                this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
-    m_model->setData(index, data);
+    m_model->setItemsData(itemsData);
     connect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
             this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
-
-    m_finishedItems.insert(item);
 }
 
 void KFileItemModelRolesUpdater::slotPreviewFailed(const KFileItem& item)
@@ -781,6 +789,82 @@ void KFileItemModelRolesUpdater::slotDirectoryContentsCountReceived(const QStrin
     }
 }
 
+void KFileItemModelRolesUpdater::slotDirectorySizeReceived(const QString& path, KIO::filesize_t size, bool finished)
+{
+    if (!m_roles.contains("recursiveSize") && m_model->sortRole() != "recursiveSize") {
+        return;
+    }
+
+    const int index = m_model->index(KUrl(path));
+    if (index >= 0) {
+        QHash<QByteArray, QVariant> data;
+        data.insert("recursiveSize", size);
+        data.insert("recursiveSizePending", !finished);
+
+        disconnect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
+                   this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
+        m_model->setData(index, data);
+        connect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
+                this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
+    }
+}
+
+void KFileItemModelRolesUpdater::slotMimeTypesDetected(const QHash<KUrl, QString>& mimeTypes)
+{
+    QList<QPair<KFileItem, KFileItem> > refreshedItems;
+    refreshedItems.reserve(mimeTypes.count());
+
+    QHashIterator<KUrl, QString> it(mimeTypes);
+    while (it.hasNext()) {
+        it.next();
+        const int index = m_model->index(it.key());
+        if (index < 0) {
+            continue;
+        }
+
+        const KFileItem oldItem = m_model->fileItem(index);
+        if (oldItem.isMimeTypeKnown()) {
+            continue;
+        }
+
+        // KFileItem offers no way to set the MIME type, so the item is
+        // replaced by an item whose UDS entry contains the MIME type.
+        KIO::UDSEntry entry = oldItem.entry();
+        entry.insert(KIO::UDSEntry::UDS_MIME_TYPE, it.value());
+        const KFileItem newItem(entry, oldItem.url());
+        refreshedItems.append(qMakePair(oldItem, newItem));
+    }
+
+    if (refreshedItems.isEmpty()) {
+        return;
+    }
+
+    // KFileItemModel::slotRefreshItems() applies the icons and the types
+    // of the new items. The other roles are kept.
+    disconnect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
+               this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
+    m_model->slotRefreshItems(refreshedItems);
+    connect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
+            this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
+
+    const bool createPreviews = m_previewShown && (m_state == Idle || m_state == PreviewJobRunning);
+
+    typedef QPair<KFileItem, KFileItem> ItemPair;
+    foreach (const ItemPair& itemPair, refreshedItems) {
+        if (m_finishedItems.remove(itemPair.first)) {
+            m_finishedItems.insert(itemPair.second);
+        } else if (createPreviews) {
+            // Previews can only be created for items with a known MIME type,
+            // so startPreviewJob() has skipped the item.
+            m_pendingPreviewItems.append(itemPair.second);
+        }
+    }
+
+    if (createPreviews && m_state == Idle && !m_pendingPreviewItems.isEmpty()) {
+        startPreviewJob();
+    }
+}
+
 void KFileItemModelRolesUpdater::startUpdating()
 {
     if (m_state == Paused) {
@@ -797,8 +881,18 @@ void KFileItemModelRolesUpdater::startUpdating()
     killPreviewJob();
     m_pendingIndexes.clear();
 
-    QElapsedTimer timer;
-    timer.start();
+    const QList<int> indexes = indexesToResolve();
+
+    // Detect the MIME types of files on slow mounts in the background,
+    // starting with the visible items.
+    KFileItemList slowItems;
+    foreach (int index, indexes) {
+        const KFileItem item = m_model->fileItem(index);
+        if (KMimeTypeDetector::isSlow(item)) {
+            slowItems.append(item);
+        }
+    }
+    m_mimeTypeDetector->prioritizeItems(slowItems);
 
     // Determine the icons for the visible items synchronously.
     updateVisibleIcons();
@@ -810,19 +904,18 @@ void KFileItemModelRolesUpdater::startUpdating()
     }
 
     // Start the preview job or the asynchronous resolving of all roles.
-    QList<int> indexes = indexesToResolve();
-
     if (m_previewShown) {
-        m_pendingPreviewItems.clear();
-        m_pendingPreviewItems.reserve(indexes.count());
+        KFileItemList items;
+        items.reserve(indexes.count());
 
         foreach (int index, indexes) {
             const KFileItem item = m_model->fileItem(index);
             if (!m_finishedItems.contains(item)) {
-                m_pendingPreviewItems.append(item);
+                items.append(item);
             }
         }
 
+        m_pendingPreviewItems = applyCachedPreviews(items);
         startPreviewJob();
     } else {
         m_pendingIndexes = indexes;
@@ -899,9 +992,20 @@ void KFileItemModelRolesUpdater::startPreviewJob()
 
         do {
             const KFileItem item = m_pendingPreviewItems.takeFirst();
+            if (KMimeTypeDetector::isSlow(item)) {
+                // The item is passed to a new preview job by
+                // slotMimeTypesDetected() when the MIME type is known.
+                m_mimeTypeDetector->addItem(item);
+                continue;
+            }
             item.determineMimeType();
             itemSubSet.append(item);
         } while (!m_pendingPreviewItems.isEmpty() && timer.elapsed() < MaxBlockTimeout);
+
+        if (itemSubSet.isEmpty()) {
+            QTimer::singleShot(0, this, SLOT(slotPreviewJobFinished()));
+            return;
+        }
     }
 
     KIO::PreviewJob* job = new KIO::PreviewJob(itemSubSet, cacheSize, &m_enabledPlugins);
@@ -996,7 +1100,11 @@ void KFileItemModelRolesUpdater::applySortRole(int index)
     const KFileItem item = m_model->fileItem(index);
 
     if (m_model->sortRole() == "type") {
-        if (!item.isMimeTypeKnown()) {
+        if (KMimeTypeDetector::isSlow(item)) {
+            // The type is applied by slotMimeTypesDetected()
+            m_mimeTypeDetector->addItem(item);
+            return;
+        } else if (!item.isMimeTypeKnown()) {
             item.determineMimeType();
         }
 
@@ -1004,6 +1112,12 @@ void KFileItemModelRolesUpdater::applySortRole(int index)
     } else if (m_model->sortRole() == "size" && item.isLocalFile() && item.isDir()) {
         const QString path = item.localPath();
         data.insert("size", m_directoryContentsCounter->countDirectoryContentsSynchronously(path));
+    } else if (m_model->sortRole() == "recursiveSize") {
+        if (item.isLocalFile() && item.isDir()) {
+            // The total size is applied by slotDirectorySizeReceived()
+            m_directorySizeCounter->addDirectory(item.localPath());
+        }
+        return;
     } else {
         // Probably the sort role is a Nepomuk role - just determine all roles.
         data = rolesData(item);
@@ -1032,8 +1146,14 @@ bool KFileItemModelRolesUpdater::applyResolvedRoles(const KFileItem& item, Resol
 
     const bool resolveAll = (hint == ResolveAll);
 
+    // The icon of an item on a slow mount is applied by
+    // slotMimeTypesDetected() when the MIME type is known.
+    const bool detectMimeTypeAsynchronously = KMimeTypeDetector::isSlow(item);
+
     bool iconChanged = false;
-    if (!item.isMimeTypeKnown() || !item.isFinalIconKnown()) {
+    if (detectMimeTypeAsynchronously) {
+        m_mimeTypeDetector->addItem(item);
+    } else if (!item.isMimeTypeKnown() || !item.isFinalIconKnown()) {
         item.determineMimeType();
         iconChanged = true;
     } else {
@@ -1054,7 +1174,9 @@ bool KFileItemModelRolesUpdater::applyResolvedRoles(const KFileItem& item, Resol
             data = rolesData(item);
         }
 
-        data.insert("iconName", item.iconName());
+        if (!detectMimeTypeAsynchronously) {
+            data.insert("iconName", item.iconName());
+        }
 
         if (m_clearPreviews) {
             data.insert("iconPixmap", QPixmap());
@@ -1089,7 +1211,13 @@ QHash<QByteArray, QVariant> KFileItemModelRolesUpdater::rolesData(const KFileIte
         }
     }
 
-    if (m_roles.contains("type")) {
+    if (m_roles.contains("recursiveSize") && item.isDir() && item.isLocalFile()) {
+        // The total size is calculated in the background and received
+        // in slotDirectorySizeReceived.
+        m_directorySizeCounter->addDirectory(item.localPath());
+    }
+
+    if (m_roles.contains("type") && !KMimeTypeDetector::isSlow(item)) {
         data.insert("type", item.mimeComment());
     }
 
@@ -1127,8 +1255,77 @@ QHash<QByteArray, QVariant> KFileItemModelRolesUpdater::rolesData(const KFileIte
     return data;
 }
 
+QHash<QByteArray, QVariant> KFileItemModelRolesUpdater::previewRolesData(const KFileItem& item, const QImage& preview)
+{
+    QPixmap scaledPixmap = QPixmap::fromImage(preview);
+
+    QHash<QByteArray, QVariant> data = rolesData(item);
+
+    const QStringList overlays = data["iconOverlays"].toStringList();
+    // Strangely KFileItem::overlays() returns empty string-values, so
+    // we need to check first whether an overlay must be drawn at all.
+    // It is more efficient to do it here, as KIconLoader::drawOverlays()
+    // assumes that an overlay will be drawn and has some additional
+    // setup time.
+    foreach (const QString& overlay, overlays) {
+        if (!overlay.isEmpty()) {
+            // There is at least one overlay, draw all overlays above m_pixmap
+            // and cancel the check
+            KIconLoader::global()->drawOverlays(overlays, scaledPixmap, KIconLoader::Desktop);
+            break;
+        }
+    }
+
+    data.insert("iconPixmap", scaledPixmap);
+    return data;
+}
+
+KFileItemList KFileItemModelRolesUpdater::applyCachedPreviews(const KFileItemList& items)
+{
+    KFileItemList remainingItems;
+    remainingItems.reserve(items.count());
+
+    QMap<int, QHash<QByteArray, QVariant> > itemsData;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    KPreviewCache& previewCache = KPreviewCache::instance();
+    foreach (const KFileItem& item, items) {
+        QImage preview;
+        if (timer.elapsed() < MaxBlockTimeout && previewCache.find(previewCacheKey(item), &preview)) {
+            const int index = m_model->index(item);
+            if (index >= 0) {
+                itemsData.insert(index, previewRolesData(item, preview));
+                m_finishedItems.insert(item);
+                continue;
+            }
+        }
+
+        remainingItems.append(item);
+    }
+
+    if (!itemsData.isEmpty()) {
+        disconnect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
+                   this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
+        m_model->setItemsData(itemsData);
+        connect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
+                this,    SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
+    }
+
+    return remainingItems;
+}
+
+QString KFileItemModelRolesUpdater::previewCacheKey(const KFileItem& item) const
+{
+    return KPreviewCache::key(item, m_iconSize, m_enlargeSmallPreviews, m_enabledPlugins);
+}
+
 void KFileItemModelRolesUpdater::updateAllPreviews()
 {
+    // Previews that are processed currently are outdated
+    m_previewProcessor->clear();
+
     if (m_state == Paused) {
         m_previewChangedDuringPausing = true;
     } else {
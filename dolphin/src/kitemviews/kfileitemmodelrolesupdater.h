@@ -33,8 +33,12 @@
 #include <QStringList>
 
 class KDirectoryContentsCounter;
+class KDirectorySizeCounter;
 class KFileItemModel;
 class KJob;
+class KMimeTypeDetector;
+class KPreviewProcessor;
+class QImage;
 class QPixmap;
 class QTimer;
 
@@ -176,11 +180,19 @@ private slots:
                              const QByteArray& previous);
 
     /**
-     * Is invoked after a preview has been received successfully.
+     * Is invoked after a preview has been received successfully. The
+     * preview is scaled and framed by m_previewProcessor.
      * @see startPreviewJob()
+     * @see slotPreviewsProcessed()
      */
     void slotGotPreview(const KFileItem& item, const QPixmap& pixmap);
 
+    /**
+     * Applies the previews that have been scaled and framed by
+     * m_previewProcessor to the model in one transaction.
+     */
+    void slotPreviewsProcessed(const QHash<KUrl, QImage>& previews);
+
     /**
      * Is invoked after generating a preview has failed.
      * @see startPreviewJob()
@@ -220,6 +232,19 @@ private slots:
 
     void slotDirectoryContentsCountReceived(const QString& path, int count);
 
+    /**
+     * Applies the total size \a size of the directory tree \a path to the role
+     * "recursiveSize". Is invoked periodically until \a finished is true.
+     */
+    void slotDirectorySizeReceived(const QString& path, KIO::filesize_t size, bool finished);
+
+    /**
+     * Replaces the items whose MIME types have been detected by
+     * m_mimeTypeDetector by items with known MIME types. The model
+     * is updated for all items at once.
+     */
+    void slotMimeTypesDetected(const QHash<KUrl, QString>& mimeTypes);
+
 private:
     /**
      * Starts the updating of all roles. The visible items are handled first.
@@ -264,6 +289,24 @@ private:
     bool applyResolvedRoles(const KFileItem& item, ResolveHint hint);
     QHash<QByteArray, QVariant> rolesData(const KFileItem& item);
 
+    /**
+     * @return The roles of \a item, including the role "iconPixmap" with
+     *         the scaled and framed preview \a preview and the overlays.
+     */
+    QHash<QByteArray, QVariant> previewRolesData(const KFileItem& item, const QImage& preview);
+
+    /**
+     * Applies the previews from the KPreviewCache to the items of \a items
+     * for MaxBlockTimeout ms.
+     * @return Items whose previews have not been found in the cache.
+     */
+    KFileItemList applyCachedPreviews(const KFileItemList& items);
+
+    /**
+     * @return The key of the preview of \a item in the KPreviewCache.
+     */
+    QString previewCacheKey(const KFileItem& item) const;
+
     /**
      * @return The number of items of the path \a path.
      */
@@ -345,6 +388,9 @@ private:
     QSet<KFileItem> m_changedItems;
 
     KDirectoryContentsCounter* m_directoryContentsCounter;
+    KDirectorySizeCounter* m_directorySizeCounter;
+    KMimeTypeDetector* m_mimeTypeDetector;
+    KPreviewProcessor* m_previewProcessor;
 
 #ifdef HAVE_NEPOMUK
     Nepomuk2::ResourceWatcher* m_nepomukResourceWatcher;
@@ -43,7 +43,7 @@ KItemListSelectionManager::~KItemListSelectionManager()
 void KItemListSelectionManager::setCurrentItem(int current)
 {
     const int previous = m_currentItem;
-    const QSet<int> previousSelection = selectedItems();
+    const KItemSet previousSelection = selectedItems();
 
     if (m_model && current >= 0 && current < m_model->count()) {
         m_currentItem = current;
@@ -55,7 +55,7 @@ void KItemListSelectionManager::setCurrentItem(int current)
         emit currentChanged(m_currentItem, previous);
 
         if (m_isAnchoredSelectionActive) {
-            const QSet<int> selection = selectedItems();
+            const KItemSet selection = selectedItems();
             if (selection != previousSelection) {
                 emit selectionChanged(selection, previousSelection);
             }
@@ -68,18 +68,18 @@ int KItemListSelectionManager::currentItem() const
     return m_currentItem;
 }
 
-void KItemListSelectionManager::setSelectedItems(const QSet<int>& items)
+void KItemListSelectionManager::setSelectedItems(const KItemSet& items)
 {
     if (m_selectedItems != items) {
-        const QSet<int> previous = m_selectedItems;
+        const KItemSet previous = m_selectedItems;
         m_selectedItems = items;
         emit selectionChanged(m_selectedItems, previous);
     }
 }
 
-QSet<int> KItemListSelectionManager::selectedItems() const
+KItemSet KItemListSelectionManager::selectedItems() const
 {
-    QSet<int> selectedItems = m_selectedItems;
+    KItemSet selectedItems = m_selectedItems;
 
     if (m_isAnchoredSelectionActive && m_anchorItem != m_currentItem) {
         Q_ASSERT(m_anchorItem >= 0);
@@ -87,9 +87,7 @@ QSet<int> KItemListSelectionManager::selectedItems() const
         const int from = qMin(m_anchorItem, m_currentItem);
         const int to = qMax(m_anchorItem, m_currentItem);
 
-        for (int index = from; index <= to; ++index) {
-            selectedItems.insert(index);
-        }
+        selectedItems.insert(KItemRange(from, to - from + 1));
     }
 
     return selectedItems;
@@ -127,32 +125,22 @@ void KItemListSelectionManager::setSelected(int index, int count, SelectionMode
     }
 
     endAnchoredSelection();
-    const QSet<int> previous = selectedItems();
+    const KItemSet previous = selectedItems();
 
     count = qMin(count, m_model->count() - index);
 
-    const int endIndex = index + count -1;
+    const KItemRange range(index, count);
     switch (mode) {
     case Select:
-        for (int i = index; i <= endIndex; ++i) {
-            m_selectedItems.insert(i);
-        }
+        m_selectedItems.insert(range);
         break;
 
     case Deselect:
-        for (int i = index; i <= endIndex; ++i) {
-            m_selectedItems.remove(i);
-        }
+        m_selectedItems.remove(range);
         break;
 
     case Toggle:
-        for (int i = index; i <= endIndex; ++i) {
-            if (m_selectedItems.contains(i)) {
-                m_selectedItems.remove(i);
-            } else {
-                m_selectedItems.insert(i);
-            }
-        }
+        m_selectedItems = m_selectedItems ^ KItemSet(range);
         break;
 
     default:
@@ -160,7 +148,7 @@ void KItemListSelectionManager::setSelected(int index, int count, SelectionMode
         break;
     }
 
-    const QSet<int> selection = selectedItems();
+    const KItemSet selection = selectedItems();
     if (selection != previous) {
         emit selectionChanged(selection, previous);
     }
@@ -168,11 +156,11 @@ void KItemListSelectionManager::setSelected(int index, int count, SelectionMode
 
 void KItemListSelectionManager::clearSelection()
 {
-    const QSet<int> previous = selectedItems();
+    const KItemSet previous = selectedItems();
     if (!previous.isEmpty()) {
         m_selectedItems.clear();
         m_isAnchoredSelectionActive = false;
-        emit selectionChanged(QSet<int>(), previous);
+        emit selectionChanged(KItemSet(), previous);
     }
 }
 
@@ -192,9 +180,7 @@ void KItemListSelectionManager::endAnchoredSelection()
         const int from = qMin(m_anchorItem, m_currentItem);
         const int to = qMax(m_anchorItem, m_currentItem);
 
-        for (int index = from; index <= to; ++index) {
-            m_selectedItems.insert(index);
-        }
+        m_selectedItems.insert(KItemRange(from, to - from + 1));
     }
 
     m_isAnchoredSelectionActive = false;
@@ -221,7 +207,7 @@ void KItemListSelectionManager::setModel(KItemModelBase* model)
 void KItemListSelectionManager::itemsInserted(const KItemRangeList& itemRanges)
 {
     // Store the current selection (needed in the selectionChanged() signal)
-    const QSet<int> previousSelection = selectedItems();
+    const KItemSet previousSelection = selectedItems();
 
     // Update the current item
     if (m_currentItem < 0) {
@@ -256,25 +242,9 @@ void KItemListSelectionManager::itemsInserted(const KItemRangeList& itemRanges)
     }
 
     // Update the selections
-    if (!m_selectedItems.isEmpty()) {
-        const QSet<int> previous = m_selectedItems;
-        m_selectedItems.clear();
-        m_selectedItems.reserve(previous.count());
-        QSetIterator<int> it(previous);
-        while (it.hasNext()) {
-            const int index = it.next();
-            int inc = 0;
-            foreach (const KItemRange& itemRange, itemRanges) {
-                if (index < itemRange.index) {
-                    break;
-                }
-                inc += itemRange.count;
-            }
-            m_selectedItems.insert(index + inc);
-        }
-    }
+    m_selectedItems.itemsInserted(itemRanges);
 
-    const QSet<int> selection = selectedItems();
+    const KItemSet selection = selectedItems();
     if (selection != previousSelection) {
         emit selectionChanged(selection, previousSelection);
     }
@@ -283,7 +253,7 @@ void KItemListSelectionManager::itemsInserted(const KItemRangeList& itemRanges)
 void KItemListSelectionManager::itemsRemoved(const KItemRangeList& itemRanges)
 {
     // Store the current selection (needed in the selectionChanged() signal)
-    const QSet<int> previousSelection = selectedItems();
+    const KItemSet previousSelection = selectedItems();
     const int previousCurrent = m_currentItem;
 
     // Update the current item
@@ -306,21 +276,10 @@ void KItemListSelectionManager::itemsRemoved(const KItemRangeList& itemRanges)
         }
     }
 
-    // Update the selections and the anchor item
-    if (!m_selectedItems.isEmpty()) {
-        const QSet<int> previous = m_selectedItems;
-        m_selectedItems.clear();
-        m_selectedItems.reserve(previous.count());
-        QSetIterator<int> it(previous);
-        while (it.hasNext()) {
-            const int index = indexAfterRangesRemoving(it.next(), itemRanges, DiscardRemovedIndex);
-            if (index >= 0)  {
-                m_selectedItems.insert(index);
-            }
-        }
-    }
+    // Update the selections
+    m_selectedItems.itemsRemoved(itemRanges);
 
-    const QSet<int> selection = selectedItems();
+    const KItemSet selection = selectedItems();
     if (selection != previousSelection) {
         emit selectionChanged(selection, previousSelection);
     }
@@ -332,7 +291,7 @@ void KItemListSelectionManager::itemsRemoved(const KItemRangeList& itemRanges)
 void KItemListSelectionManager::itemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes)
 {
     // Store the current selection (needed in the selectionChanged() signal)
-    const QSet<int> previousSelection = selectedItems();
+    const KItemSet previousSelection = selectedItems();
 
     // Update the current item
     if (m_currentItem >= itemRange.index && m_currentItem < itemRange.index + itemRange.count) {
@@ -351,23 +310,9 @@ void KItemListSelectionManager::itemsMoved(const KItemRange& itemRange, const QL
     }
 
     // Update the selections
-    if (!m_selectedItems.isEmpty()) {
-        const QSet<int> previous = m_selectedItems;
-        m_selectedItems.clear();
-        m_selectedItems.reserve(previous.count());
-        QSetIterator<int> it(previous);
-        while (it.hasNext()) {
-            const int index = it.next();
-            if (index >= itemRange.index && index < itemRange.index + itemRange.count) {
-                m_selectedItems.insert(movedToIndexes.at(index - itemRange.index));
-            }
-            else {
-                m_selectedItems.insert(index);
-            }
-        }
-    }
+    m_selectedItems.itemsMoved(itemRange, movedToIndexes);
 
-    const QSet<int> selection = selectedItems();
+    const KItemSet selection = selectedItems();
     if (selection != previousSelection) {
         emit selectionChanged(selection, previousSelection);
     }
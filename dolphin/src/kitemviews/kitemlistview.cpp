@@ -29,6 +29,7 @@
 #include "kitemlistselectionmanager.h"
 #include "kitemlistwidget.h"
 
+#include "private/kitemlistcolumnwidthtracker.h"
 #include "private/kitemlistheaderwidget.h"
 #include "private/kitemlistrubberband.h"
 #include "private/kitemlistsizehintresolver.h"
@@ -55,6 +56,10 @@ namespace {
 
     // Delay in ms for triggering the next autoscroll
     const int RepeatingAutoScrollDelay = 1000 / 60;
+
+    // Maximum time in ms for measuring the preferred column-widths
+    // before the event loop gets processed again
+    const int MaximumColumnWidthsMeasuringTime = 50;
 }
 
 #ifndef QT_NO_ACCESSIBILITY
@@ -91,6 +96,8 @@ KItemListView::KItemListView(QGraphicsWidget* parent) :
     m_visibleGroups(),
     m_visibleCells(),
     m_sizeHintResolver(0),
+    m_columnWidthTracker(0),
+    m_columnWidthsTimer(0),
     m_layouter(0),
     m_animation(0),
     m_layoutTimer(0),
@@ -114,6 +121,13 @@ KItemListView::KItemListView(QGraphicsWidget* parent) :
     m_layouter = new KItemListViewLayouter(this);
     m_layouter->setSizeHintResolver(m_sizeHintResolver);
 
+    m_columnWidthTracker = new KItemListColumnWidthTracker();
+
+    m_columnWidthsTimer = new QTimer(this);
+    m_columnWidthsTimer->setInterval(0);
+    m_columnWidthsTimer->setSingleShot(true);
+    connect(m_columnWidthsTimer, SIGNAL(timeout()), this, SLOT(slotColumnWidthsTimerFinished()));
+
     m_animation = new KItemListViewAnimation(this);
     connect(m_animation, SIGNAL(finished(QGraphicsWidget*,KItemListViewAnimation::AnimationType)),
             this, SLOT(slotAnimationFinished(QGraphicsWidget*,KItemListViewAnimation::AnimationType)));
@@ -150,6 +164,9 @@ KItemListView::~KItemListView()
 
     delete m_sizeHintResolver;
     m_sizeHintResolver = 0;
+
+    delete m_columnWidthTracker;
+    m_columnWidthTracker = 0;
 }
 
 void KItemListView::setScrollOffset(qreal offset)
@@ -223,6 +240,7 @@ void KItemListView::setVisibleRoles(const QList<QByteArray>& roles)
 
     m_sizeHintResolver->clearCache();
     m_layouter->markAsDirty();
+    m_columnWidthTracker->setRoles(roles);
 
     if (m_itemSize.isEmpty()) {
         m_headerWidget->setColumns(roles);
@@ -609,12 +627,12 @@ KItemListHeader* KItemListView::header() const
     return m_header;
 }
 
-QPixmap KItemListView::createDragPixmap(const QSet<int>& indexes) const
+QPixmap KItemListView::createDragPixmap(const KItemSet& indexes) const
 {
     QPixmap pixmap;
 
     if (indexes.count() == 1) {
-        KItemListWidget* item = m_visibleItems.value(indexes.toList().first());
+        KItemListWidget* item = m_visibleItems.value(indexes.first());
         QGraphicsView* graphicsView = scene()->views()[0];
         if (item && graphicsView) {
             pixmap = item->createDragPixmap(0, graphicsView);
@@ -777,6 +795,7 @@ void KItemListView::setStyleOption(const KItemListStyleOption& option)
     m_layouter->markAsDirty();
     doLayout(animate ? Animation : NoAnimation);
 
+    m_columnWidthTracker->invalidate();
     if (m_itemSize.isEmpty()) {
         updatePreferredColumnWidths();
     }
@@ -953,8 +972,9 @@ QList<KItemListWidget*> KItemListView::visibleItemListWidgets() const
 
 void KItemListView::slotItemsInserted(const KItemRangeList& itemRanges)
 {
+    m_columnWidthTracker->itemsInserted(itemRanges);
     if (m_itemSize.isEmpty()) {
-        updatePreferredColumnWidths(itemRanges);
+        updatePreferredColumnWidths(false);
     }
 
     const bool hasMultipleRanges = (itemRanges.count() > 1);
@@ -1056,10 +1076,9 @@ void KItemListView::slotItemsInserted(const KItemRangeList& itemRanges)
 
 void KItemListView::slotItemsRemoved(const KItemRangeList& itemRanges)
 {
+    m_columnWidthTracker->itemsRemoved(itemRanges);
     if (m_itemSize.isEmpty()) {
-        // Don't pass the item-range: The preferred column-widths of
-        // all items must be adjusted when removing items.
-        updatePreferredColumnWidths();
+        updatePreferredColumnWidths(false);
     }
 
     const bool hasMultipleRanges = (itemRanges.count() > 1);
@@ -1172,6 +1191,7 @@ void KItemListView::slotItemsRemoved(const KItemRangeList& itemRanges)
 void KItemListView::slotItemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes)
 {
     m_sizeHintResolver->itemsMoved(itemRange, movedToIndexes);
+    m_columnWidthTracker->itemsMoved(itemRange, movedToIndexes);
     m_layouter->markAsDirty();
 
     if (m_controller) {
@@ -1197,8 +1217,11 @@ void KItemListView::slotItemsChanged(const KItemRangeList& itemRanges,
                                      const QSet<QByteArray>& roles)
 {
     const bool updateSizeHints = itemSizeHintUpdateRequired(roles);
-    if (updateSizeHints && m_itemSize.isEmpty()) {
-        updatePreferredColumnWidths(itemRanges);
+    if (updateSizeHints) {
+        m_columnWidthTracker->itemsChanged(itemRanges);
+        if (m_itemSize.isEmpty()) {
+            updatePreferredColumnWidths(false);
+        }
     }
 
     foreach (const KItemRange& itemRange, itemRanges) {
@@ -1305,7 +1328,7 @@ void KItemListView::slotCurrentChanged(int current, int previous)
     QAccessible::updateAccessibility(this, current+1, QAccessible::Focus);
 }
 
-void KItemListView::slotSelectionChanged(const QSet<int>& current, const QSet<int>& previous)
+void KItemListView::slotSelectionChanged(const KItemSet& current, const KItemSet& previous)
 {
     Q_UNUSED(previous);
 
@@ -1361,6 +1384,15 @@ void KItemListView::slotLayoutTimerFinished()
     doLayout(Animation);
 }
 
+void KItemListView::slotColumnWidthsTimerFinished()
+{
+    if (!m_model || !m_itemSize.isEmpty()) {
+        return;
+    }
+
+    updatePreferredColumnWidths(false);
+}
+
 void KItemListView::slotRubberBandPosChanged()
 {
     update();
@@ -1502,7 +1534,7 @@ void KItemListView::setController(KItemListController* controller)
         if (previous) {
             KItemListSelectionManager* selectionManager = previous->selectionManager();
             disconnect(selectionManager, SIGNAL(currentChanged(int,int)), this, SLOT(slotCurrentChanged(int,int)));
-            disconnect(selectionManager, SIGNAL(selectionChanged(QSet<int>,QSet<int>)), this, SLOT(slotSelectionChanged(QSet<int>,QSet<int>)));
+            disconnect(selectionManager, SIGNAL(selectionChanged(KItemSet,KItemSet)), this, SLOT(slotSelectionChanged(KItemSet,KItemSet)));
         }
 
         m_controller = controller;
@@ -1510,7 +1542,7 @@ void KItemListView::setController(KItemListController* controller)
         if (controller) {
             KItemListSelectionManager* selectionManager = controller->selectionManager();
             connect(selectionManager, SIGNAL(currentChanged(int,int)), this, SLOT(slotCurrentChanged(int,int)));
-            connect(selectionManager, SIGNAL(selectionChanged(QSet<int>,QSet<int>)), this, SLOT(slotSelectionChanged(QSet<int>,QSet<int>)));
+            connect(selectionManager, SIGNAL(selectionChanged(KItemSet,KItemSet)), this, SLOT(slotSelectionChanged(KItemSet,KItemSet)));
         }
 
         onControllerChanged(controller, previous);
@@ -1544,6 +1576,7 @@ void KItemListView::setModel(KItemModelBase* model)
                    this,    SLOT(slotSortRoleChanged(QByteArray,QByteArray)));
 
         m_sizeHintResolver->itemsRemoved(KItemRangeList() << KItemRange(0, m_model->count()));
+        m_columnWidthTracker->itemsRemoved(KItemRangeList() << KItemRange(0, m_model->count()));
     }
 
     m_model = model;
@@ -2101,56 +2134,54 @@ bool KItemListView::useAlternateBackgrounds() const
     return m_itemSize.isEmpty() && m_visibleRoles.count() > 1;
 }
 
-QHash<QByteArray, qreal> KItemListView::preferredColumnWidths(const KItemRangeList& itemRanges) const
+void KItemListView::measureColumnWidths()
 {
     QElapsedTimer timer;
     timer.start();
 
-    QHash<QByteArray, qreal> widths;
+    const KItemListWidgetCreatorBase* creator = widgetCreator();
+    const QList<QByteArray> roles = m_columnWidthTracker->roles();
+    QVector<qreal> widths(roles.count());
+
+    int index = m_columnWidthTracker->nextUnmeasuredIndex();
+    while (index >= 0) {
+        if (timer.elapsed() > MaximumColumnWidthsMeasuringTime) {
+            // When having several thousands of items calculating the sizes can get
+            // very expensive. Measure the remaining items asynchronously to prevent
+            // a blocking user interface.
+            m_columnWidthsTimer->start();
+            return;
+        }
+
+        for (int i = 0; i < roles.count(); ++i) {
+            widths[i] = creator->preferredRoleColumnWidth(roles[i], index, this);
+        }
+        m_columnWidthTracker->setWidths(index, widths);
+
+        index = m_columnWidthTracker->nextUnmeasuredIndex();
+    }
+}
 
+bool KItemListView::applyPreferredColumnWidths()
+{
     // Calculate the minimum width for each column that is required
     // to show the headline unclipped.
     const QFontMetricsF fontMetrics(m_headerWidget->font());
     const int gripMargin   = m_headerWidget->style()->pixelMetric(QStyle::PM_HeaderGripMargin);
     const int headerMargin = m_headerWidget->style()->pixelMetric(QStyle::PM_HeaderMargin);
-    foreach (const QByteArray& visibleRole, visibleRoles()) {
-        const QString headerText = m_model->roleDescription(visibleRole);
-        const qreal headerWidth = fontMetrics.width(headerText) + gripMargin + headerMargin * 2;
-        widths.insert(visibleRole, headerWidth);
-    }
-
-    // Calculate the preferred column withs for each item and ignore values
-    // smaller than the width for showing the headline unclipped.
-    const KItemListWidgetCreatorBase* creator = widgetCreator();
-    int calculatedItemCount = 0;
-    bool maxTimeExceeded = false;
-    foreach (const KItemRange& itemRange, itemRanges) {
-        const int startIndex = itemRange.index;
-        const int endIndex = startIndex + itemRange.count - 1;
-
-        for (int i = startIndex; i <= endIndex; ++i) {
-            foreach (const QByteArray& visibleRole, visibleRoles()) {
-                qreal maxWidth = widths.value(visibleRole, 0);
-                const qreal width = creator->preferredRoleColumnWidth(visibleRole, i, this);
-                maxWidth = qMax(width, maxWidth);
-                widths.insert(visibleRole, maxWidth);
-            }
 
-            if (calculatedItemCount > 100 && timer.elapsed() > 200) {
-                // When having several thousands of items calculating the sizes can get
-                // very expensive. We accept a possibly too small role-size in favour
-                // of having no blocking user interface.
-                maxTimeExceeded = true;
-                break;
-            }
-            ++calculatedItemCount;
-        }
-        if (maxTimeExceeded) {
-            break;
+    bool changed = false;
+    foreach (const QByteArray& role, m_visibleRoles) {
+        const QString headerText = m_model->roleDescription(role);
+        const qreal headerWidth = fontMetrics.width(headerText) + gripMargin + headerMargin * 2;
+        const qreal width = qMax(headerWidth, m_columnWidthTracker->maximumWidth(role));
+        if (width != m_headerWidget->preferredColumnWidth(role)) {
+            m_headerWidget->setPreferredColumnWidth(role, width);
+            changed = true;
         }
     }
 
-    return widths;
+    return changed;
 }
 
 void KItemListView::applyColumnWidthsFromHeader()
@@ -2176,59 +2207,21 @@ void KItemListView::updateWidgetColumnWidths(KItemListWidget* widget)
     }
 }
 
-void KItemListView::updatePreferredColumnWidths(const KItemRangeList& itemRanges)
+void KItemListView::updatePreferredColumnWidths(bool forceUpdate)
 {
     Q_ASSERT(m_itemSize.isEmpty());
-    const int itemCount = m_model->count();
-    int rangesItemCount = 0;
-    foreach (const KItemRange& range, itemRanges) {
-        rangesItemCount += range.count;
+    if (!m_model) {
+        return;
     }
 
-    if (itemCount == rangesItemCount) {
-        const QHash<QByteArray, qreal> preferredWidths = preferredColumnWidths(itemRanges);
-        foreach (const QByteArray& role, m_visibleRoles) {
-            m_headerWidget->setPreferredColumnWidth(role, preferredWidths.value(role));
-        }
-    } else {
-        // Only a sub range of the roles need to be determined.
-        // The chances are good that the widths of the sub ranges
-        // already fit into the available widths and hence no
-        // expensive update might be required.
-        bool changed = false;
-
-        const QHash<QByteArray, qreal> updatedWidths = preferredColumnWidths(itemRanges);
-        QHashIterator<QByteArray, qreal> it(updatedWidths);
-        while (it.hasNext()) {
-            it.next();
-            const QByteArray& role = it.key();
-            const qreal updatedWidth = it.value();
-            const qreal currentWidth = m_headerWidget->preferredColumnWidth(role);
-            if (updatedWidth > currentWidth) {
-                m_headerWidget->setPreferredColumnWidth(role, updatedWidth);
-                changed = true;
-            }
-        }
-
-        if (!changed) {
-            // All the updated sizes are smaller than the current sizes and no change
-            // of the stretched roles-widths is required
-            return;
-        }
-    }
+    measureColumnWidths();
+    const bool changed = applyPreferredColumnWidths();
 
-    if (m_headerWidget->automaticColumnResizing()) {
+    if ((changed || forceUpdate) && m_headerWidget->automaticColumnResizing()) {
         applyAutomaticColumnWidths();
     }
 }
 
-void KItemListView::updatePreferredColumnWidths()
-{
-    if (m_model) {
-        updatePreferredColumnWidths(KItemRangeList() << KItemRange(0, m_model->count()));
-    }
-}
-
 void KItemListView::applyAutomaticColumnWidths()
 {
     Q_ASSERT(m_itemSize.isEmpty());
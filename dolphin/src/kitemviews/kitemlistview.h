@@ -33,6 +33,7 @@
 #include <QGraphicsWidget>
 #include <QSet>
 
+class KItemListColumnWidthTracker;
 class KItemListController;
 class KItemListGroupHeaderCreatorBase;
 class KItemListHeader;
@@ -271,7 +272,7 @@ public:
      * @return Pixmap that is used for a drag operation based on the
      *         items given by \a indexes.
      */
-    virtual QPixmap createDragPixmap(const QSet<int>& indexes) const;
+    virtual QPixmap createDragPixmap(const KItemSet& indexes) const;
 
     /**
      * Lets the user edit the role \a role for item with the index \a index.
@@ -400,13 +401,19 @@ protected slots:
     virtual void slotSortOrderChanged(Qt::SortOrder current, Qt::SortOrder previous);
     virtual void slotSortRoleChanged(const QByteArray& current, const QByteArray& previous);
     virtual void slotCurrentChanged(int current, int previous);
-    virtual void slotSelectionChanged(const QSet<int>& current, const QSet<int>& previous);
+    virtual void slotSelectionChanged(const KItemSet& current, const KItemSet& previous);
 
 private slots:
     void slotAnimationFinished(QGraphicsWidget* widget,
                                KItemListViewAnimation::AnimationType type);
     void slotLayoutTimerFinished();
 
+    /**
+     * Is invoked if the preferred column-widths of some items could not be
+     * measured without blocking the user interface. Measures the next items.
+     */
+    void slotColumnWidthsTimerFinished();
+
     void slotRubberBandPosChanged();
     void slotRubberBandActivationChanged(bool active);
 
@@ -568,13 +575,20 @@ private:
     bool useAlternateBackgrounds() const;
 
     /**
-     * @param itemRanges Items that must be checked for getting the widths of columns.
-     * @return           The preferred width of the column of each visible role. The width will
-     *                   be respected if the width of the item size is <= 0 (see
-     *                   KItemListView::setItemSize()). Per default an empty hash
-     *                   is returned.
+     * Passes the preferred column-widths of the items, which have been inserted or
+     * changed since the last call, to m_columnWidthTracker. If measuring the items
+     * takes too long, the remaining items are measured asynchronously by
+     * m_columnWidthsTimer.
      */
-    QHash<QByteArray, qreal> preferredColumnWidths(const KItemRangeList& itemRanges) const;
+    void measureColumnWidths();
+
+    /**
+     * Sets the preferred column-widths of m_headerWidget to the maximum widths of
+     * m_columnWidthTracker, but at least to the widths required to show the
+     * headlines unclipped.
+     * @return True, if at least one preferred column-width has been changed.
+     */
+    bool applyPreferredColumnWidths();
 
     /**
      * Applies the column-widths from m_headerWidget to the layout
@@ -588,16 +602,12 @@ private:
     void updateWidgetColumnWidths(KItemListWidget* widget);
 
     /**
-     * Updates the preferred column-widths of m_groupHeaderWidget by
-     * invoking KItemListView::columnWidths().
-     */
-    void updatePreferredColumnWidths(const KItemRangeList& itemRanges);
-
-    /**
-     * Convenience method for
-     * updatePreferredColumnWidths(KItemRangeList() << KItemRange(0, m_model->count()).
+     * Updates the preferred column-widths of m_headerWidget by invoking
+     * measureColumnWidths() and applyPreferredColumnWidths(). The automatic
+     * column-widths are only applied again if a preferred column-width has
+     * been changed, unless \a forceUpdate is true.
      */
-    void updatePreferredColumnWidths();
+    void updatePreferredColumnWidths(bool forceUpdate = true);
 
     /**
      * Resizes the column-widths of m_headerWidget based on the preferred widths
@@ -728,6 +738,8 @@ private:
 
     int m_scrollBarExtent;
     KItemListSizeHintResolver* m_sizeHintResolver;
+    KItemListColumnWidthTracker* m_columnWidthTracker;
+    QTimer* m_columnWidthsTimer; // Triggers measuring the remaining column-widths
     KItemListViewLayouter* m_layouter;
     KItemListViewAnimation* m_animation;
 
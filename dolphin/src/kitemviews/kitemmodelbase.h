@@ -26,6 +26,7 @@
 #include <libdolphin_export.h>
 
 #include <kitemviews/kitemrange.h>
+#include <kitemviews/kitemset.h>
 
 #include <QHash>
 #include <QObject>
@@ -149,7 +150,7 @@ public:
      *         caller of this method. The method must be implemented if dragging of
      *         items should be possible.
      */
-    virtual QMimeData* createMimeData(const QSet<int>& indexes) const;
+    virtual QMimeData* createMimeData(const KItemSet& indexes) const;
 
     /**
      * @return Reimplement this to return the index for the first item
@@ -0,0 +1,316 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemset.h"
+
+#include <QList>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    inline int rangeEnd(const KItemRange& range)
+    {
+        return range.index + range.count;
+    }
+
+    // Comparators for std::lower_bound(), which find the first range
+    // that ends at or after, or strictly after the given index.
+    inline bool endsBefore(const KItemRange& range, int index)
+    {
+        return rangeEnd(range) < index;
+    }
+
+    inline bool endsAtOrBefore(const KItemRange& range, int index)
+    {
+        return rangeEnd(range) <= index;
+    }
+
+    // Returns the i-th boundary of the ranges: the start of the
+    // range i / 2 for even i, and the end of the range otherwise.
+    inline int boundary(const QVector<KItemRange>& ranges, int i)
+    {
+        const KItemRange& range = ranges[i / 2];
+        return (i & 1) ? rangeEnd(range) : range.index;
+    }
+}
+
+int KItemSet::count() const
+{
+    int count = 0;
+    foreach (const KItemRange& range, m_ranges) {
+        count += range.count;
+    }
+    return count;
+}
+
+bool KItemSet::contains(int index) const
+{
+    const QVector<KItemRange>::const_iterator it = std::lower_bound(m_ranges.constBegin(), m_ranges.constEnd(),
+                                                                   index, endsAtOrBefore);
+    return it != m_ranges.constEnd() && it->index <= index;
+}
+
+void KItemSet::insert(int index)
+{
+    // Fast path for inserting the indexes in ascending order
+    if (m_ranges.isEmpty() || index > rangeEnd(m_ranges.last())) {
+        m_ranges.append(KItemRange(index, 1));
+        return;
+    }
+
+    const QVector<KItemRange>::iterator it = std::lower_bound(m_ranges.begin(), m_ranges.end(),
+                                                             index, endsBefore);
+    Q_ASSERT(it != m_ranges.end());
+
+    if (rangeEnd(*it) == index) {
+        // Append the index to the range and merge the
+        // range with the next one if they are adjacent now
+        ++it->count;
+        const QVector<KItemRange>::iterator next = it + 1;
+        if (next != m_ranges.end() && next->index == index + 1) {
+            it->count += next->count;
+            m_ranges.erase(next);
+        }
+    } else if (it->index <= index) {
+        // The index is already part of the set
+    } else if (it->index == index + 1) {
+        --it->index;
+        ++it->count;
+    } else {
+        m_ranges.insert(it, KItemRange(index, 1));
+    }
+}
+
+void KItemSet::insert(const KItemRange& range)
+{
+    if (range.count == 1) {
+        insert(range.index);
+    } else if (range.count > 1) {
+        *this = combine(*this, KItemSet(range), Union);
+    }
+}
+
+void KItemSet::remove(int index)
+{
+    const QVector<KItemRange>::iterator it = std::lower_bound(m_ranges.begin(), m_ranges.end(),
+                                                             index, endsAtOrBefore);
+    if (it == m_ranges.end() || it->index > index) {
+        return;
+    }
+
+    if (it->count == 1) {
+        m_ranges.erase(it);
+    } else if (it->index == index) {
+        ++it->index;
+        --it->count;
+    } else if (rangeEnd(*it) - 1 == index) {
+        --it->count;
+    } else {
+        // Split the range
+        const KItemRange secondPart(index + 1, rangeEnd(*it) - index - 1);
+        it->count = index - it->index;
+        m_ranges.insert(it + 1, secondPart);
+    }
+}
+
+void KItemSet::remove(const KItemRange& range)
+{
+    if (range.count == 1) {
+        remove(range.index);
+    } else if (range.count > 1) {
+        *this = combine(*this, KItemSet(range), Difference);
+    }
+}
+
+KItemRangeList KItemSet::ranges() const
+{
+    KItemRangeList ranges;
+    ranges.reserve(m_ranges.count());
+    foreach (const KItemRange& range, m_ranges) {
+        ranges.append(range);
+    }
+    return ranges;
+}
+
+void KItemSet::itemsInserted(const KItemRangeList& itemRanges)
+{
+    if (m_ranges.isEmpty() || itemRanges.isEmpty()) {
+        return;
+    }
+
+    QVector<KItemRange> ranges;
+    ranges.reserve(m_ranges.count() + itemRanges.count());
+
+    KItemRangeList::const_iterator insertedIt = itemRanges.constBegin();
+    const KItemRangeList::const_iterator insertedEnd = itemRanges.constEnd();
+    int increment = 0;
+
+    foreach (const KItemRange& range, m_ranges) {
+        int start = range.index;
+        const int end = rangeEnd(range);
+
+        // Items inserted before the range move the whole range
+        while (insertedIt != insertedEnd && insertedIt->index <= start) {
+            increment += insertedIt->count;
+            ++insertedIt;
+        }
+
+        // Items inserted inside the range split it
+        while (insertedIt != insertedEnd && insertedIt->index < end) {
+            appendRange(ranges, start + increment, insertedIt->index - start);
+            start = insertedIt->index;
+            increment += insertedIt->count;
+            ++insertedIt;
+        }
+
+        appendRange(ranges, start + increment, end - start);
+    }
+
+    m_ranges = ranges;
+}
+
+void KItemSet::itemsRemoved(const KItemRangeList& itemRanges)
+{
+    if (m_ranges.isEmpty() || itemRanges.isEmpty()) {
+        return;
+    }
+
+    QVector<KItemRange> ranges;
+    ranges.reserve(m_ranges.count() + itemRanges.count());
+
+    KItemRangeList::const_iterator removedIt = itemRanges.constBegin();
+    const KItemRangeList::const_iterator removedEnd = itemRanges.constEnd();
+
+    // Number of removed items before the current position
+    int decrement = 0;
+
+    foreach (const KItemRange& range, m_ranges) {
+        int pos = range.index;
+        const int end = rangeEnd(range);
+
+        while (pos < end) {
+            while (removedIt != removedEnd && rangeEnd(*removedIt) <= pos) {
+                decrement += removedIt->count;
+                ++removedIt;
+            }
+
+            if (removedIt != removedEnd && removedIt->index <= pos) {
+                // Skip the removed items
+                pos = rangeEnd(*removedIt);
+                continue;
+            }
+
+            const int partEnd = (removedIt != removedEnd) ? qMin(end, removedIt->index) : end;
+            appendRange(ranges, pos - decrement, partEnd - pos);
+            pos = partEnd;
+        }
+    }
+
+    m_ranges = ranges;
+}
+
+void KItemSet::itemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes)
+{
+    QList<int> movedIndexes;
+    const int movedRangeEnd = rangeEnd(itemRange);
+    for (int index = itemRange.index; index < movedRangeEnd; ++index) {
+        if (contains(index)) {
+            movedIndexes.append(movedToIndexes.at(index - itemRange.index));
+        }
+    }
+
+    if (movedIndexes.isEmpty()) {
+        return;
+    }
+
+    qSort(movedIndexes);
+
+    KItemSet moved;
+    foreach (int index, movedIndexes) {
+        moved.insert(index);
+    }
+
+    *this = combine(combine(*this, KItemSet(itemRange), Difference), moved, Union);
+}
+
+KItemSet KItemSet::combine(const KItemSet& a, const KItemSet& b, Operation operation)
+{
+    KItemSet result;
+    QVector<KItemRange>& ranges = result.m_ranges;
+    ranges.reserve(a.m_ranges.count() + b.m_ranges.count());
+
+    const int boundaryCountA = 2 * a.m_ranges.count();
+    const int boundaryCountB = 2 * b.m_ranges.count();
+    int boundaryA = 0;
+    int boundaryB = 0;
+
+    bool insideA = false;
+    bool insideB = false;
+    bool insideResult = false;
+    int resultStart = 0;
+
+    // The boundaries of the ranges of a set are strictly increasing, so the
+    // state only changes at the boundaries and each boundary is visited once.
+    while (boundaryA < boundaryCountA || boundaryB < boundaryCountB) {
+        const int posA = (boundaryA < boundaryCountA) ? boundary(a.m_ranges, boundaryA) : std::numeric_limits<int>::max();
+        const int posB = (boundaryB < boundaryCountB) ? boundary(b.m_ranges, boundaryB) : std::numeric_limits<int>::max();
+        const int pos = qMin(posA, posB);
+
+        if (posA == pos) {
+            insideA = !insideA;
+            ++boundaryA;
+        }
+        if (posB == pos) {
+            insideB = !insideB;
+            ++boundaryB;
+        }
+
+        bool inside = false;
+        switch (operation) {
+        case Union:               inside = insideA || insideB; break;
+        case Difference:          inside = insideA && !insideB; break;
+        case SymmetricDifference: inside = insideA != insideB; break;
+        }
+
+        if (inside != insideResult) {
+            if (inside) {
+                resultStart = pos;
+            } else {
+                ranges.append(KItemRange(resultStart, pos - resultStart));
+            }
+            insideResult = inside;
+        }
+    }
+
+    return result;
+}
+
+void KItemSet::appendRange(QVector<KItemRange>& ranges, int index, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    if (!ranges.isEmpty() && rangeEnd(ranges.last()) == index) {
+        ranges.last().count += count;
+    } else {
+        ranges.append(KItemRange(index, count));
+    }
+}
@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KITEMSET_H
+#define KITEMSET_H
+
+#include <libdolphin_export.h>
+
+#include <kitemviews/kitemrange.h>
+
+#include <QMetaType>
+#include <QVector>
+
+/**
+ * @brief Stores a set of item indexes as a sorted list of ranges.
+ *
+ * Used by KItemListSelectionManager instead of a QSet<int>: Selecting all
+ * items of a large folder requires only one range instead of one hash node
+ * for each item, and adjusting the indexes after inserting or removing items
+ * only requires to iterate the ranges instead of all indexes.
+ *
+ * Finding, inserting and removing an index takes O(log r) to find the range,
+ * where r is the number of ranges. The ranges are non-empty, sorted and never
+ * adjacent, so equal sets always have equal ranges.
+ *
+ * Iterating a KItemSet returns the indexes in ascending order.
+ */
+class LIBDOLPHINPRIVATE_EXPORT KItemSet
+{
+public:
+    class const_iterator
+    {
+    public:
+        const_iterator();
+
+        int operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        const_iterator& operator--();
+        const_iterator operator--(int);
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+
+    private:
+        const_iterator(QVector<KItemRange>::const_iterator rangeIt, int offset);
+
+        QVector<KItemRange>::const_iterator m_rangeIt;
+        int m_offset;
+
+        friend class KItemSet;
+    };
+
+    KItemSet();
+    explicit KItemSet(const KItemRange& range);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator constBegin() const;
+    const_iterator constEnd() const;
+
+    /**
+     * @return Number of indexes in the set. Takes O(r).
+     */
+    int count() const;
+    bool isEmpty() const;
+    void clear();
+
+    bool contains(int index) const;
+    void insert(int index);
+    void insert(const KItemRange& range);
+    void remove(int index);
+    void remove(const KItemRange& range);
+
+    /**
+     * @return Smallest index of the set. The set must not be empty.
+     */
+    int first() const;
+
+    /**
+     * @return Largest index of the set. The set must not be empty.
+     */
+    int last() const;
+
+    /**
+     * @return The sorted ranges of the set.
+     */
+    KItemRangeList ranges() const;
+
+    /**
+     * Adjusts the indexes after the items in \a itemRanges have been inserted
+     * into the model. The indexes of the ranges are related to the model
+     * before the insertion, like in KItemModelBase::itemsInserted().
+     */
+    void itemsInserted(const KItemRangeList& itemRanges);
+
+    /**
+     * Removes the items in \a itemRanges and adjusts the indexes of the
+     * remaining items, like KItemModelBase::itemsRemoved().
+     */
+    void itemsRemoved(const KItemRangeList& itemRanges);
+
+    /**
+     * Adjusts the indexes of the items in \a itemRange that have been moved
+     * to \a movedToIndexes, like KItemModelBase::itemsMoved().
+     */
+    void itemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes);
+
+    bool operator==(const KItemSet& other) const;
+    bool operator!=(const KItemSet& other) const;
+
+    KItemSet& operator<<(int index);
+
+    /**
+     * @return Union of both sets.
+     */
+    KItemSet operator+(const KItemSet& other) const;
+
+    /**
+     * @return Indexes of this set that are not part of \a other.
+     */
+    KItemSet operator-(const KItemSet& other) const;
+
+    /**
+     * @return Indexes that are part of exactly one of both sets.
+     */
+    KItemSet operator^(const KItemSet& other) const;
+
+private:
+    enum Operation {
+        Union,
+        Difference,
+        SymmetricDifference
+    };
+
+    /**
+     * Combines the ranges of both sets by iterating the boundaries of their
+     * ranges once, which takes O(r1 + r2).
+     */
+    static KItemSet combine(const KItemSet& a, const KItemSet& b, Operation operation);
+
+    /**
+     * Appends the range to \a ranges. The range is merged with the last
+     * range, if they are adjacent.
+     */
+    static void appendRange(QVector<KItemRange>& ranges, int index, int count);
+
+private:
+    QVector<KItemRange> m_ranges;
+};
+
+Q_DECLARE_METATYPE(KItemSet)
+
+inline KItemSet::const_iterator::const_iterator() :
+    m_rangeIt(),
+    m_offset(0)
+{
+}
+
+inline KItemSet::const_iterator::const_iterator(QVector<KItemRange>::const_iterator rangeIt, int offset) :
+    m_rangeIt(rangeIt),
+    m_offset(offset)
+{
+}
+
+inline int KItemSet::const_iterator::operator*() const
+{
+    return m_rangeIt->index + m_offset;
+}
+
+inline KItemSet::const_iterator& KItemSet::const_iterator::operator++()
+{
+    ++m_offset;
+    if (m_offset == m_rangeIt->count) {
+        ++m_rangeIt;
+        m_offset = 0;
+    }
+    return *this;
+}
+
+inline KItemSet::const_iterator KItemSet::const_iterator::operator++(int)
+{
+    const_iterator it = *this;
+    ++(*this);
+    return it;
+}
+
+inline KItemSet::const_iterator& KItemSet::const_iterator::operator--()
+{
+    if (m_offset == 0) {
+        --m_rangeIt;
+        m_offset = m_rangeIt->count - 1;
+    } else {
+        --m_offset;
+    }
+    return *this;
+}
+
+inline KItemSet::const_iterator KItemSet::const_iterator::operator--(int)
+{
+    const_iterator it = *this;
+    --(*this);
+    return it;
+}
+
+inline bool KItemSet::const_iterator::operator==(const const_iterator& other) const
+{
+    return m_rangeIt == other.m_rangeIt && m_offset == other.m_offset;
+}
+
+inline bool KItemSet::const_iterator::operator!=(const const_iterator& other) const
+{
+    return !(*this == other);
+}
+
+inline KItemSet::KItemSet() :
+    m_ranges()
+{
+}
+
+inline KItemSet::KItemSet(const KItemRange& range) :
+    m_ranges()
+{
+    if (range.count > 0) {
+        m_ranges.append(range);
+    }
+}
+
+inline KItemSet::const_iterator KItemSet::begin() const
+{
+    return const_iterator(m_ranges.constBegin(), 0);
+}
+
+inline KItemSet::const_iterator KItemSet::end() const
+{
+    return const_iterator(m_ranges.constEnd(), 0);
+}
+
+inline KItemSet::const_iterator KItemSet::constBegin() const
+{
+    return begin();
+}
+
+inline KItemSet::const_iterator KItemSet::constEnd() const
+{
+    return end();
+}
+
+inline bool KItemSet::isEmpty() const
+{
+    return m_ranges.isEmpty();
+}
+
+inline void KItemSet::clear()
+{
+    m_ranges.clear();
+}
+
+inline int KItemSet::first() const
+{
+    Q_ASSERT(!isEmpty());
+    return m_ranges.first().index;
+}
+
+inline int KItemSet::last() const
+{
+    Q_ASSERT(!isEmpty());
+    const KItemRange& range = m_ranges.last();
+    return range.index + range.count - 1;
+}
+
+inline bool KItemSet::operator==(const KItemSet& other) const
+{
+    return m_ranges == other.m_ranges;
+}
+
+inline bool KItemSet::operator!=(const KItemSet& other) const
+{
+    return m_ranges != other.m_ranges;
+}
+
+inline KItemSet& KItemSet::operator<<(int index)
+{
+    insert(index);
+    return *this;
+}
+
+inline KItemSet KItemSet::operator+(const KItemSet& other) const
+{
+    return combine(*this, other, Union);
+}
+
+inline KItemSet KItemSet::operator-(const KItemSet& other) const
+{
+    return combine(*this, other, Difference);
+}
+
+inline KItemSet KItemSet::operator^(const KItemSet& other) const
+{
+    return combine(*this, other, SymmetricDifference);
+}
+
+#endif
@@ -46,8 +46,16 @@
 
 // #define KSTANDARDITEMLISTWIDGET_DEBUG
 
+namespace {
+    // Maximum number of cached text heights and widths of KStandardItemListWidgetInformant
+    const int MaxTextHeightCacheSize = 100000;
+    const int MaxTextWidthCacheSize = 100000;
+}
+
 KStandardItemListWidgetInformant::KStandardItemListWidgetInformant() :
-    KItemListWidgetInformant()
+    KItemListWidgetInformant(),
+    m_textHeightCache(MaxTextHeightCacheSize),
+    m_textWidthCache(MaxTextWidthCacheSize)
 {
 }
 
@@ -66,22 +74,8 @@ QSizeF KStandardItemListWidgetInformant::itemSizeHint(int index, const KItemList
 
         const qreal itemWidth = view->itemSize().width();
         const qreal maxWidth = itemWidth - 2 * option.padding;
-        QTextLine line;
-
-        // Calculate the number of lines required for wrapping the name
-        QTextOption textOption(Qt::AlignHCenter);
-        textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
 
-        qreal textHeight = 0;
-        QTextLayout layout(text, option.font);
-        layout.setTextOption(textOption);
-        layout.beginLayout();
-        while ((line = layout.createLine()).isValid()) {
-            line.setLineWidth(maxWidth);
-            line.naturalTextWidth();
-            textHeight += line.height();
-        }
-        layout.endLayout();
+        qreal textHeight = wrappedTextHeight(text, option.font, maxWidth);
 
         // Add one line for each additional information
         textHeight += additionalRolesCount * option.fontMetrics.lineSpacing();
@@ -141,7 +135,7 @@ qreal KStandardItemListWidgetInformant::preferredRoleColumnWidth(const QByteArra
     if (role == "rating") {
         width += KStandardItemListWidget::preferredRatingSize(option).width();
     } else {
-        width += option.fontMetrics.width(text);
+        width += textWidth(text, option);
 
         if (role == "text") {
             if (view->supportsItemExpanding()) {
@@ -159,6 +153,45 @@ qreal KStandardItemListWidgetInformant::preferredRoleColumnWidth(const QByteArra
     return width;
 }
 
+qreal KStandardItemListWidgetInformant::wrappedTextHeight(const QString& text, const QFont& font, qreal maxWidth) const
+{
+    const QString key = font.key() + QLatin1Char('\n') + QString::number(maxWidth) + QLatin1Char('\n') + text;
+    if (const qreal* cachedHeight = m_textHeightCache.object(key)) {
+        return *cachedHeight;
+    }
+
+    // Calculate the number of lines required for wrapping the name
+    QTextOption textOption(Qt::AlignHCenter);
+    textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+
+    qreal textHeight = 0;
+    QTextLine line;
+    QTextLayout layout(text, font);
+    layout.setTextOption(textOption);
+    layout.beginLayout();
+    while ((line = layout.createLine()).isValid()) {
+        line.setLineWidth(maxWidth);
+        line.naturalTextWidth();
+        textHeight += line.height();
+    }
+    layout.endLayout();
+
+    m_textHeightCache.insert(key, new qreal(textHeight));
+    return textHeight;
+}
+
+qreal KStandardItemListWidgetInformant::textWidth(const QString& text, const KItemListStyleOption& option) const
+{
+    const QString key = option.font.key() + QLatin1Char('\n') + text;
+    if (const qreal* cachedWidth = m_textWidthCache.object(key)) {
+        return *cachedWidth;
+    }
+
+    const qreal width = option.fontMetrics.width(text);
+    m_textWidthCache.insert(key, new qreal(width));
+    return width;
+}
+
 QString KStandardItemListWidgetInformant::itemText(int index, const KItemListView* view) const
 {
     return view->model()->data(index).value("text").toString();
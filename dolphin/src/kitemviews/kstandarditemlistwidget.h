@@ -24,6 +24,7 @@
 
 #include <kitemviews/kitemlistwidget.h>
 
+#include <QCache>
 #include <QPixmap>
 #include <QPointF>
 #include <QStaticText>
@@ -61,6 +62,28 @@ protected:
     virtual QString roleText(const QByteArray& role,
                              const QHash<QByteArray, QVariant>& values) const;
 
+private:
+    /**
+     * @return Height of the text \a text, if it is wrapped to lines with
+     *         the width \a maxWidth like in the icons layout.
+     */
+    qreal wrappedTextHeight(const QString& text, const QFont& font, qreal maxWidth) const;
+
+    /**
+     * @return Width of the unwrapped text \a text for the font metrics of \a option.
+     */
+    qreal textWidth(const QString& text, const KItemListStyleOption& option) const;
+
+    // Wrapping a text with QTextLayout is expensive and the size hints of all items
+    // are discarded on each change of the style option, e.g. when zooming. Cache the
+    // text heights by text, font and line width, so that the layout is only redone
+    // for texts which have not been measured with the same font and width yet.
+    mutable QCache<QString, qreal> m_textHeightCache;
+
+    // The role texts of many items are equal, e.g. the sizes and types. Cache the
+    // widths for the preferred column-widths of the details view.
+    mutable QCache<QString, qreal> m_textWidthCache;
+
     friend class KStandardItemListWidget; // Accesses roleText()
 };
 
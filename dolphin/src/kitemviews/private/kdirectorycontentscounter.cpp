@@ -25,41 +25,58 @@
 
 #include <KDirWatch>
 #include <QThread>
+#include <QTimer>
+
+namespace {
+    // Directories are counted by several threads, as reading large
+    // directories is mostly bound by the file system.
+    const int MaximumWorkerCount = 4;
+
+    // Limits the number of inotify watches used by one counter
+    const int MaximumWatchedDirectories = 1000;
+
+    // Interval in ms for collecting the dirty notifications of KDirWatch
+    const int DirtyDirsInterval = 500;
+}
 
 KDirectoryContentsCounter::KDirectoryContentsCounter(KFileItemModel* model, QObject* parent) :
     QObject(parent),
     m_model(model),
     m_queue(),
-    m_workerThread(0),
-    m_worker(0),
-    m_workerIsBusy(false),
+    m_queuedDirs(),
+    m_workerThreads(),
+    m_workers(),
+    m_idleWorkers(),
+    m_watchDirectories(true),
     m_dirWatcher(0),
-    m_watchedDirs()
+    m_watchedDirs(),
+    m_dirtyDirs(),
+    m_dirtyDirsTimer(0)
 {
     connect(m_model, SIGNAL(itemsRemoved(KItemRangeList)),
             this,    SLOT(slotItemsRemoved()));
 
-    m_workerThread = new QThread(this);
-    m_worker = new KDirectoryContentsCounterWorker();
-    m_worker->moveToThread(m_workerThread);
-
-    connect(this,     SIGNAL(requestDirectoryContentsCount(QString,KDirectoryContentsCounterWorker::Options)),
-            m_worker, SLOT(countDirectoryContents(QString,KDirectoryContentsCounterWorker::Options)));
-    connect(m_worker, SIGNAL(result(QString,int)),
-            this,     SLOT(slotResult(QString,int)));
-
-    m_workerThread->start();
-
     m_dirWatcher = new KDirWatch(this);
     connect(m_dirWatcher, SIGNAL(dirty(QString)), this, SLOT(slotDirWatchDirty(QString)));
+
+    // KDirWatch emits dirty() for each change inside a directory. Collect
+    // the notifications to count each changed directory only once.
+    m_dirtyDirsTimer = new QTimer(this);
+    m_dirtyDirsTimer->setInterval(DirtyDirsInterval);
+    m_dirtyDirsTimer->setSingleShot(true);
+    connect(m_dirtyDirsTimer, SIGNAL(timeout()), this, SLOT(slotDirtyDirsTimerTimeout()));
 }
 
 KDirectoryContentsCounter::~KDirectoryContentsCounter()
 {
-    m_workerThread->quit();
-    m_workerThread->wait();
+    foreach (QThread* thread, m_workerThreads) {
+        thread->quit();
+    }
+    foreach (QThread* thread, m_workerThreads) {
+        thread->wait();
+    }
 
-    delete m_worker;
+    qDeleteAll(m_workers);
 }
 
 void KDirectoryContentsCounter::addDirectory(const QString& path)
@@ -69,59 +86,79 @@ void KDirectoryContentsCounter::addDirectory(const QString& path)
 
 int KDirectoryContentsCounter::countDirectoryContentsSynchronously(const QString& path)
 {
-    if (!m_dirWatcher->contains(path)) {
-        m_dirWatcher->addDir(path);
-        m_watchedDirs.insert(path);
-    }
-
-    KDirectoryContentsCounterWorker::Options options;
+    watchDirectory(path);
+    return KDirectoryContentsCounterWorker::subItemsCount(path, workerOptions());
+}
 
-    if (m_model->showHiddenFiles()) {
-        options |= KDirectoryContentsCounterWorker::CountHiddenFiles;
+void KDirectoryContentsCounter::setWatchDirectories(bool watch)
+{
+    if (m_watchDirectories == watch) {
+        return;
     }
 
-    if (m_model->showDirectoriesOnly()) {
-        options |= KDirectoryContentsCounterWorker::CountDirectoriesOnly;
+    m_watchDirectories = watch;
+    if (!watch) {
+        foreach (const QString& path, m_watchedDirs) {
+            m_dirWatcher->removeDir(path);
+        }
+        m_watchedDirs.clear();
+        m_dirtyDirs.clear();
     }
+}
 
-    return KDirectoryContentsCounterWorker::subItemsCount(path, options);
+bool KDirectoryContentsCounter::watchDirectories() const
+{
+    return m_watchDirectories;
 }
 
 void KDirectoryContentsCounter::slotResult(const QString& path, int count)
 {
-    m_workerIsBusy = false;
+    KDirectoryContentsCounterWorker* worker = qobject_cast<KDirectoryContentsCounterWorker*>(sender());
+    Q_ASSERT(worker);
+    m_idleWorkers.append(worker);
 
-    if (!m_dirWatcher->contains(path)) {
-        m_dirWatcher->addDir(path);
-        m_watchedDirs.insert(path);
-    }
-
-    if (!m_queue.isEmpty()) {
-        startWorker(m_queue.dequeue());
-    }
+    watchDirectory(path);
+    startQueuedWorkers();
 
     emit result(path, count);
 }
 
 void KDirectoryContentsCounter::slotDirWatchDirty(const QString& path)
 {
-    const int index = m_model->index(KUrl(path));
-    if (index >= 0) {
-        if (!m_model->fileItem(index).isDir()) {
-            // If INotify is used, KDirWatch issues the dirty() signal
-            // also for changed files inside the directory, even if we
-            // don't enable this behavior explicitly (see bug 309740).
-            return;
-        }
+    m_dirtyDirs.insert(path);
+    if (!m_dirtyDirsTimer->isActive()) {
+        m_dirtyDirsTimer->start();
+    }
+}
+
+void KDirectoryContentsCounter::slotDirtyDirsTimerTimeout()
+{
+    foreach (const QString& path, m_dirtyDirs) {
+        const int index = m_model->index(KUrl(path));
+        if (index >= 0) {
+            if (!m_model->fileItem(index).isDir()) {
+                // If INotify is used, KDirWatch issues the dirty() signal
+                // also for changed files inside the directory, even if we
+                // don't enable this behavior explicitly (see bug 309740).
+                continue;
+            }
 
-        startWorker(path);
+            startWorker(path);
+        }
     }
+    m_dirtyDirs.clear();
 }
 
 void KDirectoryContentsCounter::slotItemsRemoved()
 {
     const bool allItemsRemoved = (m_model->count() == 0);
 
+    if (allItemsRemoved) {
+        m_queue.clear();
+        m_queuedDirs.clear();
+        m_dirtyDirs.clear();
+    }
+
     if (!m_watchedDirs.isEmpty()) {
         // Don't let KDirWatch watch for removed items
         if (allItemsRemoved) {
@@ -129,7 +166,6 @@ void KDirectoryContentsCounter::slotItemsRemoved()
                 m_dirWatcher->removeDir(path);
             }
             m_watchedDirs.clear();
-            m_queue.clear();
         } else {
             QMutableSetIterator<QString> it(m_watchedDirs);
             while (it.hasNext()) {
@@ -145,20 +181,70 @@ void KDirectoryContentsCounter::slotItemsRemoved()
 
 void KDirectoryContentsCounter::startWorker(const QString& path)
 {
-    if (m_workerIsBusy) {
-        m_queue.enqueue(path);
-    } else {
-        KDirectoryContentsCounterWorker::Options options;
+    if (m_queuedDirs.contains(path)) {
+        // The directory will be counted anyway
+        return;
+    }
 
-        if (m_model->showHiddenFiles()) {
-            options |= KDirectoryContentsCounterWorker::CountHiddenFiles;
-        }
+    m_queue.enqueue(path);
+    m_queuedDirs.insert(path);
+    startQueuedWorkers();
+}
+
+void KDirectoryContentsCounter::startQueuedWorkers()
+{
+    while (!m_queue.isEmpty()) {
+        if (m_idleWorkers.isEmpty()) {
+            const int maximumWorkerCount = qBound(2, QThread::idealThreadCount(), MaximumWorkerCount);
+            if (m_workers.count() >= maximumWorkerCount) {
+                return;
+            }
+
+            QThread* thread = new QThread(this);
+            KDirectoryContentsCounterWorker* worker = new KDirectoryContentsCounterWorker();
+            worker->moveToThread(thread);
+            connect(worker, SIGNAL(result(QString,int)),
+                    this,   SLOT(slotResult(QString,int)));
+            thread->start();
 
-        if (m_model->showDirectoriesOnly()) {
-            options |= KDirectoryContentsCounterWorker::CountDirectoriesOnly;
+            m_workerThreads.append(thread);
+            m_workers.append(worker);
+            m_idleWorkers.append(worker);
         }
 
-        emit requestDirectoryContentsCount(path, options);
-        m_workerIsBusy = true;
+        const QString path = m_queue.dequeue();
+        m_queuedDirs.remove(path);
+
+        KDirectoryContentsCounterWorker* worker = m_idleWorkers.takeLast();
+        QMetaObject::invokeMethod(worker, "countDirectoryContents", Qt::QueuedConnection,
+                                  Q_ARG(QString, path),
+                                  Q_ARG(KDirectoryContentsCounterWorker::Options, workerOptions()));
     }
 }
+
+void KDirectoryContentsCounter::watchDirectory(const QString& path)
+{
+    if (!m_watchDirectories || m_watchedDirs.count() >= MaximumWatchedDirectories) {
+        return;
+    }
+
+    if (!m_dirWatcher->contains(path)) {
+        m_dirWatcher->addDir(path);
+        m_watchedDirs.insert(path);
+    }
+}
+
+KDirectoryContentsCounterWorker::Options KDirectoryContentsCounter::workerOptions() const
+{
+    KDirectoryContentsCounterWorker::Options options;
+
+    if (m_model->showHiddenFiles()) {
+        options |= KDirectoryContentsCounterWorker::CountHiddenFiles;
+    }
+
+    if (m_model->showDirectoriesOnly()) {
+        options |= KDirectoryContentsCounterWorker::CountDirectoriesOnly;
+    }
+
+    return options;
+}
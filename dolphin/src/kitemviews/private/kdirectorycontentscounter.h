@@ -29,6 +29,8 @@
 class KDirWatch;
 class KFileItemModel;
 class QString;
+class QThread;
+class QTimer;
 
 class KDirectoryContentsCounter : public QObject
 {
@@ -57,34 +59,59 @@ public:
      */
     int countDirectoryContentsSynchronously(const QString& path);
 
+    /**
+     * If set to false, the counted directories are not watched for changes.
+     * Each watched directory requires an inotify watch, which are a limited
+     * resource. The counts are updated when the directory is loaded again.
+     * Per default the directories are watched.
+     */
+    void setWatchDirectories(bool watch);
+    bool watchDirectories() const;
+
 signals:
     /**
      * Signals that the directory \a path contains \a count items.
      */
     void result(const QString& path, int count);
 
-    void requestDirectoryContentsCount(const QString& path, KDirectoryContentsCounterWorker::Options options);
-
 private slots:
     void slotResult(const QString& path, int count);
     void slotDirWatchDirty(const QString& path);
+    void slotDirtyDirsTimerTimeout();
     void slotItemsRemoved();
 
 private:
     void startWorker(const QString& path);
 
+    /**
+     * Passes the queued directories to idle workers. New workers
+     * are created until the maximum number of workers is reached.
+     */
+    void startQueuedWorkers();
+
+    void watchDirectory(const QString& path);
+
+    KDirectoryContentsCounterWorker::Options workerOptions() const;
+
 private:
     KFileItemModel* m_model;
 
     QQueue<QString> m_queue;
+    QSet<QString> m_queuedDirs;
 
-    QThread* m_workerThread;
-    KDirectoryContentsCounterWorker* m_worker;
-    bool m_workerIsBusy;
+    QList<QThread*> m_workerThreads;
+    QList<KDirectoryContentsCounterWorker*> m_workers;
+    QList<KDirectoryContentsCounterWorker*> m_idleWorkers;
 
+    bool m_watchDirectories;
     KDirWatch* m_dirWatcher;
     QSet<QString> m_watchedDirs;    // Required as sadly KDirWatch does not offer a getter method
                                     // to get all watched directories.
+
+    // Directories reported as dirty by m_dirWatcher, which are counted
+    // again when m_dirtyDirsTimer expires.
+    QSet<QString> m_dirtyDirs;
+    QTimer* m_dirtyDirsTimer;
 };
 
 #endif
\ No newline at end of file
@@ -20,14 +20,52 @@
 
 #include "kdirectorycontentscounterworker.h"
 
-// Required includes for subItemsCount():
+#include <KGlobal>
+#include <kde_file.h>
+
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+
+// Required includes for countSubItems():
 #ifdef Q_WS_WIN
     #include <QDir>
 #else
     #include <dirent.h>
-    #include <QFile>
 #endif
 
+#include <ctime>
+
+namespace {
+    // Maximum number of directories whose item count is cached
+    const int MaximumCachedDirectories = 10000;
+
+    struct CachedSubItemsCount
+    {
+        time_t modificationTime;
+        int count;
+    };
+}
+
+/**
+ * The item counts are shared by all views of the process and are only valid
+ * as long as the modification time of the directory is unchanged.
+ */
+class KDirectoryContentsCounterCache
+{
+public:
+    KDirectoryContentsCounterCache() :
+        mutex(),
+        counts(MaximumCachedDirectories)
+    {
+    }
+
+    QMutex mutex;
+    QCache<QString, CachedSubItemsCount> counts;
+};
+K_GLOBAL_STATIC(KDirectoryContentsCounterCache, s_cache)
+
 KDirectoryContentsCounterWorker::KDirectoryContentsCounterWorker(QObject* parent) :
     QObject(parent)
 {
@@ -35,6 +73,39 @@ KDirectoryContentsCounterWorker::KDirectoryContentsCounterWorker(QObject* parent
 }
 
 int KDirectoryContentsCounterWorker::subItemsCount(const QString& path, Options options)
+{
+    KDE_struct_stat buffer;
+    if (KDE_stat(QFile::encodeName(path), &buffer) != 0) {
+        return -1;
+    }
+
+    const QString key = QString::number(int(options)) + QLatin1Char(':') + path;
+    {
+        QMutexLocker locker(&s_cache->mutex);
+        const CachedSubItemsCount* cached = s_cache->counts.object(key);
+        if (cached && cached->modificationTime == buffer.st_mtime) {
+            return cached->count;
+        }
+    }
+
+    const int count = countSubItems(path, options);
+
+    // The modification time has a resolution of one second. A change in the same
+    // second as the counting would not be noticed, so recently changed directories
+    // are not cached.
+    if (count >= 0 && buffer.st_mtime < ::time(0) - 1) {
+        CachedSubItemsCount* cached = new CachedSubItemsCount;
+        cached->modificationTime = buffer.st_mtime;
+        cached->count = count;
+
+        QMutexLocker locker(&s_cache->mutex);
+        s_cache->counts.insert(key, cached);
+    }
+
+    return count;
+}
+
+int KDirectoryContentsCounterWorker::countSubItems(const QString& path, Options options)
 {
     const bool countHiddenFiles = options & CountHiddenFiles;
     const bool countDirectoriesOnly = options & CountDirectoriesOnly;
@@ -42,7 +42,7 @@ public:
 
     /**
      * Counts the items inside the directory \a path using the options
-     * \a options.
+     * \a options. The count is cached until the directory gets modified.
      *
      * @return The number of items.
      */
@@ -63,6 +63,12 @@ public slots:
     // is needed here. Just using 'Options' is OK for the compiler, but
     // confuses moc.
     void countDirectoryContents(const QString& path, KDirectoryContentsCounterWorker::Options options);
+
+private:
+    /**
+     * Counts the items inside the directory \a path without using the cache.
+     */
+    static int countSubItems(const QString& path, Options options);
 };
 
 Q_DECLARE_METATYPE(KDirectoryContentsCounterWorker::Options)
@@ -0,0 +1,570 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kdirectorysizecounter.h"
+
+#include <kitemviews/kfileitemmodel.h>
+
+#include <KGlobal>
+
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#ifdef Q_WS_WIN
+    #include <QDir>
+    #include <QFileInfo>
+#else
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <ctime>
+
+namespace {
+    // Interval in ms for announcing the sizes of directory trees that are still read
+    const int ProgressInterval = 500;
+
+    // Maximum number of cached directories plus their subdirectory names
+    const int MaximumCacheCost = 200000;
+
+    // Time in seconds after which a cached directory is read again. Changing
+    // the size of a file does not change the modification time of its directory.
+    const int MaximumCacheAge = 300;
+
+    // Maximum number of tasks of one walk in the shared thread pool. Further
+    // directories are read by the running tasks, so that a large tree does not
+    // fill the queue of the pool and delay the walks of other directories.
+    const int MaximumTasksPerWalk = 4;
+}
+
+/**
+ * File with more than one hard link. Its size is only counted
+ * once per walk, even if it is found in several directories.
+ */
+struct KDirectorySizeLinkedFile
+{
+    quint64 inode;
+    KIO::filesize_t size;
+};
+
+class KDirectorySizeCache
+{
+public:
+    KDirectorySizeCache();
+
+    /**
+     * @return True, if the directory given by \a device and \a inode is cached
+     *         and has not been modified. In this case \a filesSize,
+     *         \a linkedFiles and \a subDirectories contain the cached values.
+     */
+    bool find(quint64 device, quint64 inode, time_t modificationTime,
+              KIO::filesize_t& filesSize, QList<KDirectorySizeLinkedFile>& linkedFiles,
+              QList<QByteArray>& subDirectories);
+
+    void insert(quint64 device, quint64 inode, time_t modificationTime,
+                KIO::filesize_t filesSize, const QList<KDirectorySizeLinkedFile>& linkedFiles,
+                const QList<QByteArray>& subDirectories);
+
+private:
+    struct Entry
+    {
+        time_t modificationTime;
+        time_t cacheTime;
+        KIO::filesize_t filesSize;
+        QList<KDirectorySizeLinkedFile> linkedFiles;
+        QList<QByteArray> subDirectories;
+    };
+
+    QMutex m_mutex;
+    QCache<QPair<quint64, quint64>, Entry> m_entries;
+};
+
+KDirectorySizeCache::KDirectorySizeCache() :
+    m_mutex(),
+    m_entries(MaximumCacheCost)
+{
+}
+
+bool KDirectorySizeCache::find(quint64 device, quint64 inode, time_t modificationTime,
+                               KIO::filesize_t& filesSize, QList<KDirectorySizeLinkedFile>& linkedFiles,
+                               QList<QByteArray>& subDirectories)
+{
+    QMutexLocker locker(&m_mutex);
+    const Entry* entry = m_entries.object(qMakePair(device, inode));
+    if (!entry
+        || entry->modificationTime != modificationTime
+        || ::time(0) - entry->cacheTime > MaximumCacheAge) {
+        return false;
+    }
+
+    filesSize = entry->filesSize;
+    linkedFiles = entry->linkedFiles;
+    subDirectories = entry->subDirectories;
+    return true;
+}
+
+void KDirectorySizeCache::insert(quint64 device, quint64 inode, time_t modificationTime,
+                                 KIO::filesize_t filesSize, const QList<KDirectorySizeLinkedFile>& linkedFiles,
+                                 const QList<QByteArray>& subDirectories)
+{
+    const time_t now = ::time(0);
+    if (modificationTime >= now - 1) {
+        // The modification time has a resolution of one second. Another change
+        // in the same second would not be noticed.
+        return;
+    }
+
+    Entry* entry = new Entry;
+    entry->modificationTime = modificationTime;
+    entry->cacheTime = now;
+    entry->filesSize = filesSize;
+    entry->linkedFiles = linkedFiles;
+    entry->subDirectories = subDirectories;
+
+    QMutexLocker locker(&m_mutex);
+    m_entries.insert(qMakePair(device, inode), entry, 1 + linkedFiles.count() + subDirectories.count());
+}
+
+/**
+ * Thread pool and cache shared by all KDirectorySizeCounter instances.
+ */
+class KDirectorySizeCounterShared
+{
+public:
+    KDirectorySizeCounterShared()
+    {
+        // Reading directories is mostly bound by the file system, so also use
+        // several threads on single core machines to keep the disk queue filled.
+        threadPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+    }
+
+    ~KDirectorySizeCounterShared()
+    {
+        threadPool.waitForDone();
+    }
+
+    KDirectorySizeCache cache;
+    QThreadPool threadPool;
+};
+K_GLOBAL_STATIC(KDirectorySizeCounterShared, s_shared)
+
+/**
+ * State of the calculation of the size of one directory tree, which is
+ * shared by the tasks that read the directories of the tree.
+ */
+class KDirectorySizeWalk
+{
+public:
+    KDirectorySizeWalk(QThreadPool* pool, KDirectorySizeCache* cache) :
+        cache(cache),
+        device(0),
+        reportedSize(0),
+        m_threadPool(pool),
+        m_canceled(0),
+        m_mutex(),
+        m_pendingDirectories(),
+        m_activeTasks(0),
+        m_size(0),
+        m_linkedInodes()
+    {
+    }
+
+    /**
+     * Starts reading the tree \a path. \a walk must be a pointer to this walk.
+     */
+    void start(const QSharedPointer<KDirectorySizeWalk>& walk, const QByteArray& path);
+
+    void cancel()
+    {
+        m_canceled.fetchAndStoreOrdered(1);
+
+        QMutexLocker locker(&m_mutex);
+        m_pendingDirectories.clear();
+    }
+
+    bool isCanceled() const
+    {
+        return m_canceled != 0;
+    }
+
+    bool isFinished() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_activeTasks == 0 && m_pendingDirectories.isEmpty();
+    }
+
+    /**
+     * Queues the directories \a paths, and starts tasks for them as long
+     * as less than MaximumTasksPerWalk tasks are active.
+     */
+    void queueDirectories(const QSharedPointer<KDirectorySizeWalk>& walk, const QList<QByteArray>& paths);
+
+    /**
+     * Takes the next queued directory, which is read by the calling task.
+     * @return False, if no directory is queued. The calling task must
+     *         finish then.
+     */
+    bool takeDirectory(QByteArray& path);
+
+    /**
+     * Adds the size \a filesSize of files with one link, and the size of the
+     * files \a linkedFiles that have not been counted yet.
+     */
+    void addSize(KIO::filesize_t filesSize, const QList<KDirectorySizeLinkedFile>& linkedFiles)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_size += filesSize;
+        foreach (const KDirectorySizeLinkedFile& file, linkedFiles) {
+            if (!m_linkedInodes.contains(file.inode)) {
+                m_linkedInodes.insert(file.inode);
+                m_size += file.size;
+            }
+        }
+    }
+
+    KIO::filesize_t size() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_size;
+    }
+
+    KDirectorySizeCache* const cache;
+
+    // Device of the requested directory. Is set by the task reading the
+    // requested directory before any subdirectory gets queued.
+    quint64 device;
+
+    // Size that has been announced last, only used by KDirectorySizeCounter
+    KIO::filesize_t reportedSize;
+
+private:
+    QThreadPool* const m_threadPool;
+    QAtomicInt m_canceled;
+
+    // Protects all following members
+    mutable QMutex m_mutex;
+    QList<QByteArray> m_pendingDirectories;
+    int m_activeTasks;
+    KIO::filesize_t m_size;
+    // Inodes of the files with several hard links that have been counted.
+    // All files are on the same device.
+    QSet<quint64> m_linkedInodes;
+};
+
+/**
+ * Reads directories of a tree. Subdirectories are read by the same task,
+ * unless another task of the walk can be started.
+ */
+class KDirectorySizeTask : public QRunnable
+{
+public:
+    KDirectorySizeTask(const QSharedPointer<KDirectorySizeWalk>& walk, const QByteArray& path, bool isRoot) :
+        QRunnable(),
+        m_walk(walk),
+        m_path(path),
+        m_isRoot(isRoot)
+    {
+    }
+
+    virtual void run()
+    {
+        QByteArray path = m_path;
+        bool isRoot = m_isRoot;
+        do {
+            if (!m_walk->isCanceled()) {
+                readDirectory(path, isRoot);
+            }
+            isRoot = false;
+        } while (m_walk->takeDirectory(path));
+    }
+
+private:
+    void readDirectory(const QByteArray& path, bool isRoot);
+
+    QSharedPointer<KDirectorySizeWalk> m_walk;
+    QByteArray m_path;
+    bool m_isRoot;
+};
+
+void KDirectorySizeWalk::start(const QSharedPointer<KDirectorySizeWalk>& walk, const QByteArray& path)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_activeTasks;
+    m_threadPool->start(new KDirectorySizeTask(walk, path, true));
+}
+
+void KDirectorySizeWalk::queueDirectories(const QSharedPointer<KDirectorySizeWalk>& walk, const QList<QByteArray>& paths)
+{
+    if (paths.isEmpty() || isCanceled()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingDirectories.append(paths);
+    while (m_activeTasks < MaximumTasksPerWalk && !m_pendingDirectories.isEmpty()) {
+        ++m_activeTasks;
+        m_threadPool->start(new KDirectorySizeTask(walk, m_pendingDirectories.takeLast(), false));
+    }
+}
+
+bool KDirectorySizeWalk::takeDirectory(QByteArray& path)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pendingDirectories.isEmpty()) {
+        --m_activeTasks;
+        return false;
+    }
+
+    // Continue depth-first, which keeps the list of pending directories short
+    path = m_pendingDirectories.takeLast();
+    return true;
+}
+
+#ifdef Q_WS_WIN
+void KDirectorySizeTask::readDirectory(const QByteArray& path, bool isRoot)
+{
+    Q_UNUSED(isRoot);
+
+    const QDir dir(QFile::decodeName(path));
+    const QDir::Filters filters = QDir::AllEntries | QDir::Hidden | QDir::System |
+                                  QDir::NoDotAndDotDot | QDir::NoSymLinks;
+
+    // The hard links are not available, so linked files are counted
+    // every time.
+    KIO::filesize_t filesSize = 0;
+    QList<QByteArray> subDirectories;
+    foreach (const QFileInfo& info, dir.entryInfoList(filters)) {
+        if (info.isDir()) {
+            subDirectories.append(QFile::encodeName(info.absoluteFilePath()));
+        } else {
+            filesSize += info.size();
+        }
+    }
+
+    m_walk->addSize(filesSize, QList<KDirectorySizeLinkedFile>());
+    m_walk->queueDirectories(m_walk, subDirectories);
+}
+#else
+void KDirectorySizeTask::readDirectory(const QByteArray& path, bool isRoot)
+{
+    int flags = O_RDONLY | O_DIRECTORY;
+    if (!isRoot) {
+        // Only the requested directory itself may be a link
+        flags |= O_NOFOLLOW;
+    }
+
+    const int fd = ::open(path.constData(), flags);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat dirStat;
+    if (::fstat(fd, &dirStat) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    if (isRoot) {
+        m_walk->device = dirStat.st_dev;
+    } else if (static_cast<quint64>(dirStat.st_dev) != m_walk->device) {
+        // Don't descend into other mounted file systems
+        ::close(fd);
+        return;
+    }
+
+    // The apparent size is used like for the "size" role of the files.
+    // Files with several hard links are only counted once per walk.
+    KIO::filesize_t filesSize = 0;
+    QList<KDirectorySizeLinkedFile> linkedFiles;
+    QList<QByteArray> subDirectories;
+    if (m_walk->cache->find(dirStat.st_dev, dirStat.st_ino, dirStat.st_mtime, filesSize, linkedFiles, subDirectories)) {
+        ::close(fd);
+    } else {
+        DIR* dir = ::fdopendir(fd);
+        if (!dir) {
+            ::close(fd);
+            return;
+        }
+
+        struct dirent* entry = 0;
+        while ((entry = ::readdir(dir)) != 0) {
+            if (m_walk->isCanceled()) {
+                ::closedir(dir);
+                return;
+            }
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+#ifdef _DIRENT_HAVE_D_TYPE
+            // Only files must be stat'ed to get their size
+            if (entry->d_type == DT_DIR) {
+                subDirectories.append(QByteArray(name));
+                continue;
+            } else if (entry->d_type == DT_LNK) {
+                continue;
+            }
+#endif
+
+            struct stat entryStat;
+            if (::fstatat(fd, name, &entryStat, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+
+            if (S_ISDIR(entryStat.st_mode)) {
+                subDirectories.append(QByteArray(name));
+            } else if (S_ISREG(entryStat.st_mode)) {
+                const KIO::filesize_t size = static_cast<KIO::filesize_t>(entryStat.st_size);
+                if (entryStat.st_nlink > 1) {
+                    KDirectorySizeLinkedFile linkedFile;
+                    linkedFile.inode = entryStat.st_ino;
+                    linkedFile.size = size;
+                    linkedFiles.append(linkedFile);
+                } else {
+                    filesSize += size;
+                }
+            }
+        }
+        ::closedir(dir);
+
+        m_walk->cache->insert(dirStat.st_dev, dirStat.st_ino, dirStat.st_mtime, filesSize, linkedFiles, subDirectories);
+    }
+
+    m_walk->addSize(filesSize, linkedFiles);
+
+    const QByteArray prefix = path.endsWith('/') ? path : path + '/';
+    QList<QByteArray> subDirectoryPaths;
+    subDirectoryPaths.reserve(subDirectories.count());
+    foreach (const QByteArray& name, subDirectories) {
+        subDirectoryPaths.append(prefix + name);
+    }
+    m_walk->queueDirectories(m_walk, subDirectoryPaths);
+}
+#endif
+
+KDirectorySizeCounter::KDirectorySizeCounter(KFileItemModel* model, QObject* parent) :
+    QObject(parent),
+    m_model(model),
+    m_walks(),
+    m_progressTimer(0)
+{
+    connect(m_model, SIGNAL(itemsRemoved(KItemRangeList)),
+            this,    SLOT(slotItemsRemoved()));
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(ProgressInterval);
+    connect(m_progressTimer, SIGNAL(timeout()), this, SLOT(slotProgressTimerTimeout()));
+}
+
+KDirectorySizeCounter::~KDirectorySizeCounter()
+{
+    clear();
+}
+
+void KDirectorySizeCounter::addDirectory(const QString& path)
+{
+    if (m_walks.contains(path)) {
+        return;
+    }
+
+    KDirectorySizeCounterShared* shared = s_shared;
+    QSharedPointer<KDirectorySizeWalk> walk(new KDirectorySizeWalk(&shared->threadPool, &shared->cache));
+    walk->start(walk, QFile::encodeName(path));
+    m_walks.insert(path, walk);
+
+    if (!m_progressTimer->isActive()) {
+        m_progressTimer->start();
+    }
+}
+
+void KDirectorySizeCounter::clear()
+{
+    foreach (const QSharedPointer<KDirectorySizeWalk>& walk, m_walks) {
+        walk->cancel();
+    }
+    m_walks.clear();
+    m_progressTimer->stop();
+}
+
+void KDirectorySizeCounter::slotProgressTimerTimeout()
+{
+    // Collect the results first, as the receivers of the signal
+    // might add new directories.
+    typedef QPair<QString, KIO::filesize_t> PathSizePair;
+    QList<PathSizePair> finishedWalks;
+    QList<PathSizePair> runningWalks;
+
+    QMutableHashIterator<QString, QSharedPointer<KDirectorySizeWalk> > it(m_walks);
+    while (it.hasNext()) {
+        it.next();
+        KDirectorySizeWalk* walk = it.value().data();
+
+        // Check isFinished() before getting the size, as the size
+        // might still change until all directories are finished.
+        const bool finished = walk->isFinished();
+        const KIO::filesize_t size = walk->size();
+        if (finished) {
+            finishedWalks.append(qMakePair(it.key(), size));
+            it.remove();
+        } else if (size != walk->reportedSize) {
+            walk->reportedSize = size;
+            runningWalks.append(qMakePair(it.key(), size));
+        }
+    }
+
+    if (m_walks.isEmpty()) {
+        m_progressTimer->stop();
+    }
+
+    foreach (const PathSizePair& pair, runningWalks) {
+        emit result(pair.first, pair.second, false);
+    }
+    foreach (const PathSizePair& pair, finishedWalks) {
+        emit result(pair.first, pair.second, true);
+    }
+}
+
+void KDirectorySizeCounter::slotItemsRemoved()
+{
+    if (m_model->count() == 0) {
+        clear();
+        return;
+    }
+
+    QMutableHashIterator<QString, QSharedPointer<KDirectorySizeWalk> > it(m_walks);
+    while (it.hasNext()) {
+        it.next();
+        if (m_model->index(KUrl(it.key())) < 0) {
+            it.value()->cancel();
+            it.remove();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KDIRECTORYSIZECOUNTER_H
+#define KDIRECTORYSIZECOUNTER_H
+
+#include <kio/global.h>
+
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+
+class KDirectorySizeWalk;
+class KFileItemModel;
+class QTimer;
+
+/**
+ * @brief Calculates the total size of all files inside directory trees.
+ *
+ * The directories of a tree are read by a few tasks of a thread pool that
+ * is shared by all instances. The entries are stat'ed relative to the file
+ * descriptor of their directory, and the walk stays on the file system of
+ * the requested directory. The apparent sizes of the files are summed up
+ * like for the "size" role, and files with several hard links are only
+ * counted once.
+ *
+ * The size of the files and the subdirectories of each directory are cached
+ * by device and inode, so that unchanged directories need not be read again
+ * by other views. As changing a file does not change the modification time
+ * of its directory, cached directories are read again after some minutes.
+ */
+class KDirectorySizeCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KDirectorySizeCounter(KFileItemModel* model, QObject* parent = 0);
+    virtual ~KDirectorySizeCounter();
+
+    /**
+     * Requests the total size of the directory tree \a path. The size is
+     * calculated asynchronously, and the signal \a result is emitted
+     * periodically with the size of the files found so far.
+     */
+    void addDirectory(const QString& path);
+
+    /**
+     * Cancels the calculation of the sizes of all requested directories.
+     */
+    void clear();
+
+signals:
+    /**
+     * Signals that the files inside the directory tree \a path have the
+     * size \a size. If \a finished is false, the tree has not been read
+     * completely yet.
+     */
+    void result(const QString& path, KIO::filesize_t size, bool finished);
+
+private slots:
+    void slotProgressTimerTimeout();
+    void slotItemsRemoved();
+
+private:
+    KFileItemModel* m_model;
+
+    QHash<QString, QSharedPointer<KDirectorySizeWalk> > m_walks;
+    QTimer* m_progressTimer;
+};
+
+#endif
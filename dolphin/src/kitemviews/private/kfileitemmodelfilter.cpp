@@ -32,12 +32,34 @@ KFileItemModelFilter::KFileItemModelFilter() :
 {
 }
 
+KFileItemModelFilter::KFileItemModelFilter(const KFileItemModelFilter& other) :
+    m_useRegExp(other.m_useRegExp),
+    m_regExp(other.m_regExp ? new QRegExp(*other.m_regExp) : 0),
+    m_lowerCasePattern(other.m_lowerCasePattern),
+    m_pattern(other.m_pattern),
+    m_mimeTypes(other.m_mimeTypes)
+{
+}
+
 KFileItemModelFilter::~KFileItemModelFilter()
 {
     delete m_regExp;
     m_regExp = 0;
 }
 
+KFileItemModelFilter& KFileItemModelFilter::operator=(const KFileItemModelFilter& other)
+{
+    if (this != &other) {
+        delete m_regExp;
+        m_regExp = other.m_regExp ? new QRegExp(*other.m_regExp) : 0;
+        m_useRegExp = other.m_useRegExp;
+        m_lowerCasePattern = other.m_lowerCasePattern;
+        m_pattern = other.m_pattern;
+        m_mimeTypes = other.m_mimeTypes;
+    }
+    return *this;
+}
+
 void KFileItemModelFilter::setPattern(const QString& filter)
 {
     m_pattern = filter;
@@ -62,6 +84,15 @@ QString KFileItemModelFilter::pattern() const
     return m_pattern;
 }
 
+bool KFileItemModelFilter::isNarrowedBy(const QString& pattern) const
+{
+    if (m_useRegExp || pattern.contains('*') || pattern.contains('?') || pattern.contains('[')) {
+        return false;
+    }
+
+    return pattern.toLower().contains(m_lowerCasePattern);
+}
+
 void KFileItemModelFilter::setMimeTypes(const QStringList& types)
 {
     m_mimeTypes = types;
@@ -79,6 +110,11 @@ bool KFileItemModelFilter::hasSetFilters() const
 
 
 bool KFileItemModelFilter::matches(const KFileItem& item) const
+{
+    return matches(item, m_pattern.isEmpty() ? QString() : item.text().toLower());
+}
+
+bool KFileItemModelFilter::matches(const KFileItem& item, const QString& lowerCaseText) const
 {
     const bool hasPatternFilter = !m_pattern.isEmpty();
     const bool hasMimeTypesFilter = !m_mimeTypes.isEmpty();
@@ -90,23 +126,24 @@ bool KFileItemModelFilter::matches(const KFileItem& item) const
 
     // If both filters are set, return true when both filters are matched
     if (hasPatternFilter && hasMimeTypesFilter) {
-        return (matchesPattern(item) && matchesType(item));
+        return (matchesPattern(lowerCaseText) && matchesType(item));
     }
 
     // If only one filter is set, return true when that filter is matched
     if (hasPatternFilter) {
-        return matchesPattern(item);
+        return matchesPattern(lowerCaseText);
     }
 
     return matchesType(item);
 }
 
-bool KFileItemModelFilter::matchesPattern(const KFileItem& item) const
+bool KFileItemModelFilter::matchesPattern(const QString& lowerCaseText) const
 {
     if (m_useRegExp) {
-        return m_regExp->exactMatch(item.text());
+        // The regular expression is case insensitive
+        return m_regExp->exactMatch(lowerCaseText);
     } else {
-        return item.text().toLower().contains(m_lowerCasePattern);
+        return lowerCaseText.contains(m_lowerCasePattern);
     }
 }
 
@@ -40,8 +40,11 @@ class LIBDOLPHINPRIVATE_EXPORT KFileItemModelFilter
 
 public:
     KFileItemModelFilter();
+    KFileItemModelFilter(const KFileItemModelFilter& other);
     virtual ~KFileItemModelFilter();
 
+    KFileItemModelFilter& operator=(const KFileItemModelFilter& other);
+
     /**
      * Sets the pattern that is used for a comparison with the item
      * in KFileItemModelFilter::matches(). Per default the pattern
@@ -51,6 +54,14 @@ public:
     void setPattern(const QString& pattern);
     QString pattern() const;
 
+    /**
+     * @return True if each item that matches \a pattern also matches
+     *         the current pattern. This is the case if both patterns are
+     *         sub-strings and \a pattern contains the current pattern,
+     *         e.g. if a character has been appended in the filter bar.
+     */
+    bool isNarrowedBy(const QString& pattern) const;
+
     /**
      * Set the list of mimetypes that are used for comparison with the
      * item in KFileItemModelFilter::matchesMimeType.
@@ -69,11 +80,22 @@ public:
      */
     bool matches(const KFileItem& item) const;
 
+    /**
+     * Same as matches(const KFileItem&), but uses \a lowerCaseText
+     * as lower case version of KFileItem::text(). This allows callers
+     * that check an item several times to fold the case only once.
+     *
+     * The filter is reentrant: Concurrent calls of matches() are only
+     * allowed for different copies of the filter.
+     */
+    bool matches(const KFileItem& item, const QString& lowerCaseText) const;
+
 private:
     /**
-     * @return True if item matches pattern set by @ref setPattern.
+     * @return True if the lower case text of an item matches the
+     *         pattern set by @ref setPattern.
      */
-    bool matchesPattern(const KFileItem& item) const;
+    bool matchesPattern(const QString& lowerCaseText) const;
 
     /**
      * @return True if item matches mimetypes set by @ref setMimeTypes.
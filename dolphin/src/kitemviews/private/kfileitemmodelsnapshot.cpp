@@ -0,0 +1,267 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kfileitemmodelsnapshot.h"
+
+#include <KSaveFile>
+#include <KStandardDirs>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QtConcurrentRun>
+
+#include <utime.h>
+
+namespace {
+    const quint32 SnapshotMagic = 0x444f4c53; // "DOLS"
+    const quint32 SnapshotVersion = 1;
+
+    /**
+     * MIME types, users and groups are shared by many items. They
+     * are stored only once and referenced by their index.
+     */
+    class StringPool
+    {
+    public:
+        qint32 index(const QString& string)
+        {
+            if (string.isEmpty()) {
+                return -1;
+            }
+
+            QHash<QString, qint32>::const_iterator it = m_indexes.constFind(string);
+            if (it != m_indexes.constEnd()) {
+                return it.value();
+            }
+
+            const qint32 index = m_strings.count();
+            m_strings.append(string);
+            m_indexes.insert(string, index);
+            return index;
+        }
+
+        const QStringList& strings() const
+        {
+            return m_strings;
+        }
+
+    private:
+        QStringList m_strings;
+        QHash<QString, qint32> m_indexes;
+    };
+
+    QString pooledString(const QStringList& strings, qint32 index)
+    {
+        return (index >= 0 && index < strings.count()) ? strings.at(index) : QString();
+    }
+
+    qint64 secondsSinceEpoch(const KFileItem& item, KFileItem::FileTimes which)
+    {
+        const KDateTime time = item.time(which);
+        return time.isValid() ? qint64(time.toTime_t()) : -1;
+    }
+}
+
+KFileItemList KFileItemModelSnapshot::load(const KUrl& url, Options options)
+{
+    const qint64 directoryTime = modificationTime(url);
+    if (directoryTime < 0) {
+        return KFileItemList();
+    }
+
+    const QString path = snapshotPath(url);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return KFileItemList();
+    }
+
+    // Map the file instead of reading it to prevent copying
+    // the whole snapshot before it is parsed.
+    const qint64 size = file.size();
+    const uchar* data = file.map(0, size);
+    if (!data) {
+        return KFileItemList();
+    }
+
+    const QByteArray rawData = QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+    QDataStream stream(rawData);
+    stream.setVersion(QDataStream::Qt_4_8);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != SnapshotMagic || version != SnapshotVersion) {
+        return KFileItemList();
+    }
+
+    QString snapshotUrl;
+    qint64 snapshotTime = -1;
+    quint32 snapshotOptions = 0;
+    stream >> snapshotUrl >> snapshotTime >> snapshotOptions;
+    if (snapshotUrl != url.url() || snapshotTime != directoryTime || snapshotOptions != quint32(options)) {
+        // The directory has been changed since the snapshot has been saved.
+        return KFileItemList();
+    }
+
+    QStringList strings;
+    quint32 count = 0;
+    stream >> strings >> count;
+
+    KFileItemList items;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        quint64 fileSize;
+        qint64 modificationTime;
+        qint64 accessTime;
+        quint32 fileType;
+        quint32 access;
+        qint32 userIndex;
+        qint32 groupIndex;
+        qint32 mimeTypeIndex;
+        QString linkDest;
+        stream >> name >> fileSize >> modificationTime >> accessTime >> fileType >> access
+               >> userIndex >> groupIndex >> mimeTypeIndex >> linkDest;
+
+        KIO::UDSEntry entry;
+        entry.insert(KIO::UDSEntry::UDS_NAME, name);
+        entry.insert(KIO::UDSEntry::UDS_SIZE, qint64(fileSize));
+        entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, fileType);
+        entry.insert(KIO::UDSEntry::UDS_ACCESS, access);
+        if (modificationTime >= 0) {
+            entry.insert(KIO::UDSEntry::UDS_MODIFICATION_TIME, modificationTime);
+        }
+        if (accessTime >= 0) {
+            entry.insert(KIO::UDSEntry::UDS_ACCESS_TIME, accessTime);
+        }
+        entry.insert(KIO::UDSEntry::UDS_USER, pooledString(strings, userIndex));
+        entry.insert(KIO::UDSEntry::UDS_GROUP, pooledString(strings, groupIndex));
+
+        const QString mimeType = pooledString(strings, mimeTypeIndex);
+        if (!mimeType.isEmpty()) {
+            entry.insert(KIO::UDSEntry::UDS_MIME_TYPE, mimeType);
+        }
+        if (!linkDest.isEmpty()) {
+            entry.insert(KIO::UDSEntry::UDS_LINK_DEST, linkDest);
+        }
+
+        items.append(KFileItem(entry, url, true, true));
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        return KFileItemList();
+    }
+
+    // Update the modification time of the snapshot, so that
+    // removeUnusedSnapshots() keeps the recently used snapshots.
+    utime(QFile::encodeName(path).constData(), 0);
+
+    return items;
+}
+
+QFuture<void> KFileItemModelSnapshot::save(const KUrl& url, Options options, const KFileItemList& items)
+{
+    if (items.count() < MinimumItemCount) {
+        return QFuture<void>();
+    }
+
+    const qint64 directoryTime = modificationTime(url);
+    if (directoryTime < 0) {
+        return QFuture<void>();
+    }
+
+    StringPool pool;
+    QByteArray itemsData;
+    QDataStream itemsStream(&itemsData, QIODevice::WriteOnly);
+    itemsStream.setVersion(QDataStream::Qt_4_8);
+
+    foreach (const KFileItem& item, items) {
+        const QString mimeType = item.isMimeTypeKnown() ? item.mimetype() : QString();
+        itemsStream << item.name()
+                    << quint64(item.size())
+                    << secondsSinceEpoch(item, KFileItem::ModificationTime)
+                    << secondsSinceEpoch(item, KFileItem::AccessTime)
+                    << quint32(item.mode())
+                    << quint32(item.permissions())
+                    << pool.index(item.user())
+                    << pool.index(item.group())
+                    << pool.index(mimeType)
+                    << item.linkDest();
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    stream << SnapshotMagic << SnapshotVersion
+           << url.url() << directoryTime << quint32(options)
+           << pool.strings() << quint32(items.count());
+    stream.writeRawData(itemsData.constData(), itemsData.size());
+
+    return QtConcurrent::run(&KFileItemModelSnapshot::write, snapshotPath(url), data);
+}
+
+void KFileItemModelSnapshot::write(const QString& path, const QByteArray& data)
+{
+    KSaveFile file(path);
+    if (!file.open()) {
+        return;
+    }
+
+    if (file.write(data) != data.size()) {
+        file.abort();
+        return;
+    }
+
+    if (file.finalize()) {
+        removeUnusedSnapshots(QFileInfo(path).absolutePath());
+    }
+}
+
+void KFileItemModelSnapshot::removeUnusedSnapshots(const QString& directory)
+{
+    // Remove the least recently used snapshots. load() updates the
+    // modification time of a snapshot each time it is used.
+    const QFileInfoList snapshots = QDir(directory).entryInfoList(QDir::Files, QDir::Time);
+    for (int i = MaximumSnapshotCount; i < snapshots.count(); ++i) {
+        QFile::remove(snapshots.at(i).absoluteFilePath());
+    }
+}
+
+QString KFileItemModelSnapshot::snapshotPath(const KUrl& url)
+{
+    const QByteArray hash = QCryptographicHash::hash(url.url().toUtf8(), QCryptographicHash::Md5).toHex();
+    return KStandardDirs::locateLocal("cache", QLatin1String("dolphin/snapshots/") + QLatin1String(hash));
+}
+
+qint64 KFileItemModelSnapshot::modificationTime(const KUrl& url)
+{
+    if (!url.isLocalFile()) {
+        return -1;
+    }
+
+    const QFileInfo info(url.toLocalFile());
+    if (!info.isDir()) {
+        return -1;
+    }
+
+    return info.lastModified().toTime_t();
+}
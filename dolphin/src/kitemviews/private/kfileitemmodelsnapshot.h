@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KFILEITEMMODELSNAPSHOT_H
+#define KFILEITEMMODELSNAPSHOT_H
+
+#include <libdolphin_export.h>
+
+#include <KFileItemList>
+#include <KUrl>
+
+#include <QFuture>
+
+/**
+ * @brief Stores the items of a local directory on disk.
+ *
+ * Listing a large directory on a slow file system can take several
+ * seconds. KFileItemModel uses the snapshot of the last listing to show
+ * the items immediately, and reconciles them with the actual listing
+ * afterwards.
+ *
+ * A snapshot is only valid as long as the modification time of the
+ * directory has not changed and the same hidden files and directory
+ * settings are used. The MIME types of the items are stored too, so
+ * that they need not be determined again.
+ *
+ * At most MaximumSnapshotCount snapshots are kept. If more snapshots are
+ * stored, the least recently used ones are removed.
+ */
+class LIBDOLPHINPRIVATE_EXPORT KFileItemModelSnapshot
+{
+public:
+    enum Option {
+        NoOptions = 0x0,
+        HiddenFiles = 0x1,
+        DirectoriesOnly = 0x2
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    /**
+     * Snapshots are only stored for directories that contain
+     * at least this number of items. Smaller directories can
+     * be listed quickly anyway.
+     */
+    static const int MinimumItemCount = 1000;
+
+    /**
+     * Maximum number of snapshots that are kept in the cache.
+     */
+    static const int MaximumSnapshotCount = 50;
+
+    /**
+     * @return The items of the directory \a url that have been stored by save().
+     *         An empty list is returned if no valid snapshot is available.
+     */
+    static KFileItemList load(const KUrl& url, Options options);
+
+    /**
+     * Stores the items \a items of the directory \a url. Nothing is done if
+     * \a url is not a local directory or has less than MinimumItemCount items.
+     *
+     * The items are serialized in the calling thread, because KFileItem is not
+     * thread-safe. The snapshot is written to disk in a worker thread.
+     * @return Future that is finished when the snapshot has been written.
+     */
+    static QFuture<void> save(const KUrl& url, Options options, const KFileItemList& items);
+
+private:
+    static void write(const QString& path, const QByteArray& data);
+    static void removeUnusedSnapshots(const QString& directory);
+    static QString snapshotPath(const KUrl& url);
+    static qint64 modificationTime(const KUrl& url);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KFileItemModelSnapshot::Options)
+
+#endif
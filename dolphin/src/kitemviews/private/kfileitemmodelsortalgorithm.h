@@ -25,13 +25,99 @@
 #include <QtCore>
 
 #include <algorithm>
+#include <iterator>
+#include <vector>
+
+/**
+ * Merges the sorted item ranges between \a begin and \a pivot and
+ * between \a pivot and \a end into a single sorted range between
+ * \a begin and \a end. The items of the first range are copied
+ * to \a buffer, which must provide space for at least
+ * pivot - begin items.
+ *
+ * In contrast to an in-place merge, which needs O(n * log(n)) moves,
+ * each item is moved only a constant number of times.
+ */
+
+template <typename RandomAccessIterator, typename LessThan, typename T>
+static void bufferedMerge(RandomAccessIterator begin,
+                  RandomAccessIterator pivot,
+                  RandomAccessIterator end,
+                  LessThan lessThan,
+                  T* buffer)
+{
+    if (begin == pivot || pivot == end) {
+        return;
+    }
+
+    if (!lessThan(*pivot, *(pivot - 1))) {
+        // The ranges are in the right order already.
+        return;
+    }
+
+    T* const bufferEnd = std::copy(begin, pivot, buffer);
+
+    T* left = buffer;
+    RandomAccessIterator right = pivot;
+    RandomAccessIterator target = begin;
+    while (left != bufferEnd && right != end) {
+        // Take the item from the first range if both items are
+        // equal to keep the sorting stable.
+        if (lessThan(*right, *left)) {
+            *target = *right;
+            ++right;
+        } else {
+            *target = *left;
+            ++left;
+        }
+        ++target;
+    }
+
+    // Remaining items of the second range are at their place already.
+    std::copy(left, bufferEnd, target);
+}
+
+/**
+ * Merges the sorted item ranges between \a begin and \a pivot and
+ * between \a pivot and \a end into a single sorted range between
+ * \a begin and \a end.
+ */
+
+template <typename RandomAccessIterator, typename LessThan>
+static void merge(RandomAccessIterator begin,
+                  RandomAccessIterator pivot,
+                  RandomAccessIterator end,
+                  LessThan lessThan)
+{
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    std::vector<ValueType> buffer(pivot - begin);
+    if (!buffer.empty()) {
+        bufferedMerge(begin, pivot, end, lessThan, &buffer[0]);
+    }
+}
+
+template <typename RandomAccessIterator, typename LessThan, typename T>
+static void bufferedMergeSort(RandomAccessIterator begin,
+                              RandomAccessIterator end,
+                              LessThan lessThan,
+                              T* buffer)
+{
+    const int span = end - begin;
+    if (span < 2) {
+        return;
+    }
+
+    const RandomAccessIterator middle = begin + span / 2;
+    bufferedMergeSort(begin, middle, lessThan, buffer);
+    bufferedMergeSort(middle, end, lessThan, buffer);
+    bufferedMerge(begin, middle, end, lessThan, buffer);
+}
 
 /**
  * Sorts the items using the merge sort algorithm is used to assure a
  * worst-case of O(n * log(n)) and to keep the number of comparisons low.
- *
- * The implementation is based on qStableSortHelper() from qalgorithms.h
- * Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+ * The sorting is stable. A buffer for half of the items is allocated
+ * once and used for all merges.
  */
 
 template <typename RandomAccessIterator, typename LessThan>
@@ -39,25 +125,25 @@ static void mergeSort(RandomAccessIterator begin,
                       RandomAccessIterator end,
                       LessThan lessThan)
 {
-    // The implementation is based on qStableSortHelper() from qalgorithms.h
-    // Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
-
     const int span = end - begin;
     if (span < 2) {
         return;
     }
 
-    const RandomAccessIterator middle = begin + span / 2;
-    mergeSort(begin, middle, lessThan);
-    mergeSort(middle, end, lessThan);
-    merge(begin, middle, end, lessThan);
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    std::vector<ValueType> buffer(span / 2);
+    bufferedMergeSort(begin, end, lessThan, &buffer[0]);
 }
 
 /**
  * Uses up to \a numberOfThreads threads to sort the items between
- * \a begin and \a end. Only item ranges longer than
- * \a parallelMergeSortingThreshold are split to be sorted by two different
- * threads.
+ * \a begin and \a end. The range is split into one chunk per thread,
+ * but each chunk contains at least \a parallelMergeSortingThreshold items.
+ * The chunks are sorted concurrently, and afterwards neighbouring chunks
+ * are merged concurrently until a single sorted range is left.
+ *
+ * Only the calling thread waits for the results, the threads of the
+ * global QThreadPool never block each other.
  *
  * The comparison function \a lessThan must be reentrant.
  */
@@ -70,73 +156,55 @@ static void parallelMergeSort(RandomAccessIterator begin,
                               int parallelMergeSortingThreshold = 100)
 {
     const int span = end - begin;
+    const int chunkCount = qMin(numberOfThreads, span / qMax(1, parallelMergeSortingThreshold));
+    if (chunkCount < 2) {
+        mergeSort(begin, end, lessThan);
+        return;
+    }
 
-    if (numberOfThreads > 1 && span > parallelMergeSortingThreshold) {
-        const int newNumberOfThreads = numberOfThreads / 2;
-        const RandomAccessIterator middle = begin + span / 2;
-
-        QFuture<void> future = QtConcurrent::run(parallelMergeSort<RandomAccessIterator, LessThan>, begin, middle, lessThan, newNumberOfThreads, parallelMergeSortingThreshold);
-        parallelMergeSort(middle, end, lessThan, newNumberOfThreads, parallelMergeSortingThreshold);
+    QVector<RandomAccessIterator> bounds;
+    bounds.reserve(chunkCount + 1);
+    for (int i = 0; i < chunkCount; ++i) {
+        bounds.append(begin + int(qint64(span) * i / chunkCount));
+    }
+    bounds.append(end);
 
+    // Sort the chunks. The calling thread sorts the first chunk itself
+    // instead of waiting idle.
+    QList<QFuture<void> > futures;
+    for (int i = 1; i < chunkCount; ++i) {
+        futures.append(QtConcurrent::run(mergeSort<RandomAccessIterator, LessThan>, bounds[i], bounds[i + 1], lessThan));
+    }
+    mergeSort(bounds[0], bounds[1], lessThan);
+    foreach (QFuture<void> future, futures) {
         future.waitForFinished();
-
-        merge(begin, middle, end, lessThan);
-    } else {
-        mergeSort(begin, end, lessThan);
     }
-}
 
-/**
- * Merges the sorted item ranges between \a begin and \a pivot and
- * between \a pivot and \a end into a single sorted range between
- * \a begin and \a end.
- *
- * The implementation is based on qMerge() from qalgorithms.h
- * Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
- */
+    // Merge pairs of neighbouring chunks until only one chunk is left.
+    while (bounds.count() > 2) {
+        futures.clear();
 
-template <typename RandomAccessIterator, typename LessThan>
-static void merge(RandomAccessIterator begin,
-                  RandomAccessIterator pivot,
-                  RandomAccessIterator end,
-                  LessThan lessThan)
-{
-    // The implementation is based on qMerge() from qalgorithms.h
-    // Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+        QVector<RandomAccessIterator> mergedBounds;
+        mergedBounds.append(bounds.first());
 
-    const int len1 = pivot - begin;
-    const int len2 = end - pivot;
+        int i = 0;
+        while (i + 2 < bounds.count()) {
+            futures.append(QtConcurrent::run(merge<RandomAccessIterator, LessThan>, bounds[i], bounds[i + 1], bounds[i + 2], lessThan));
+            mergedBounds.append(bounds[i + 2]);
+            i += 2;
+        }
 
-    if (len1 == 0 || len2 == 0) {
-        return;
-    }
+        if (mergedBounds.last() != bounds.last()) {
+            // The number of chunks is odd, the last chunk is merged in the next round.
+            mergedBounds.append(bounds.last());
+        }
 
-    if (len1 + len2 == 2) {
-        if (lessThan(*(begin + 1), *(begin))) {
-            qSwap(*begin, *(begin + 1));
+        foreach (QFuture<void> future, futures) {
+            future.waitForFinished();
         }
-        return;
-    }
 
-    RandomAccessIterator firstCut;
-    RandomAccessIterator secondCut;
-    int len2Half;
-    if (len1 > len2) {
-        const int len1Half = len1 / 2;
-        firstCut = begin + len1Half;
-        secondCut = std::lower_bound(pivot, end, *firstCut, lessThan);
-        len2Half = secondCut - pivot;
-    } else {
-        len2Half = len2 / 2;
-        secondCut = pivot + len2Half;
-        firstCut = std::upper_bound(begin, pivot, *secondCut, lessThan);
+        bounds = mergedBounds;
     }
-
-    std::rotate(firstCut, pivot, secondCut);
-
-    RandomAccessIterator newPivot = firstCut + len2Half;
-    merge(begin, firstCut, newPivot, lessThan);
-    merge(newPivot, secondCut, end, lessThan);
 }
 
 #endif
@@ -0,0 +1,228 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemlistcolumnwidthtracker.h"
+
+KItemListColumnWidthTracker::KItemListColumnWidthTracker() :
+    m_roles(),
+    m_columns(),
+    m_count(0),
+    m_firstUnmeasuredIndex(0)
+{
+}
+
+KItemListColumnWidthTracker::~KItemListColumnWidthTracker()
+{
+}
+
+void KItemListColumnWidthTracker::setRoles(const QList<QByteArray>& roles)
+{
+    m_roles = roles;
+    m_columns = QVector<Column>(roles.count());
+    for (int i = 0; i < m_columns.count(); ++i) {
+        m_columns[i].widths.fill(-1, m_count);
+    }
+    m_firstUnmeasuredIndex = 0;
+}
+
+QList<QByteArray> KItemListColumnWidthTracker::roles() const
+{
+    return m_roles;
+}
+
+int KItemListColumnWidthTracker::count() const
+{
+    return m_count;
+}
+
+void KItemListColumnWidthTracker::itemsInserted(const KItemRangeList& itemRanges)
+{
+    int insertedCount = 0;
+    foreach (const KItemRange& range, itemRanges) {
+        insertedCount += range.count;
+    }
+
+    if (insertedCount == 0) {
+        return;
+    }
+
+    for (int column = 0; column < m_columns.count(); ++column) {
+        const QVector<qreal>& widths = m_columns[column].widths;
+        QVector<qreal> newWidths;
+        newWidths.reserve(m_count + insertedCount);
+
+        // The indexes of the ranges are related to the items before the insertion
+        int sourceIndex = 0;
+        foreach (const KItemRange& range, itemRanges) {
+            while (sourceIndex < range.index) {
+                newWidths.append(widths[sourceIndex]);
+                ++sourceIndex;
+            }
+            newWidths.insert(newWidths.end(), range.count, -1);
+        }
+        while (sourceIndex < m_count) {
+            newWidths.append(widths[sourceIndex]);
+            ++sourceIndex;
+        }
+
+        m_columns[column].widths = newWidths;
+    }
+
+    m_count += insertedCount;
+    m_firstUnmeasuredIndex = qMin(m_firstUnmeasuredIndex, itemRanges.first().index);
+}
+
+void KItemListColumnWidthTracker::itemsRemoved(const KItemRangeList& itemRanges)
+{
+    int removedCount = 0;
+    foreach (const KItemRange& range, itemRanges) {
+        removedCount += range.count;
+    }
+
+    if (removedCount == 0) {
+        return;
+    }
+
+    for (int column = 0; column < m_columns.count(); ++column) {
+        const QVector<qreal>& widths = m_columns[column].widths;
+        QVector<qreal> newWidths;
+        newWidths.reserve(m_count - removedCount);
+
+        int sourceIndex = 0;
+        foreach (const KItemRange& range, itemRanges) {
+            while (sourceIndex < range.index) {
+                newWidths.append(widths[sourceIndex]);
+                ++sourceIndex;
+            }
+
+            const int rangeEnd = range.index + range.count;
+            while (sourceIndex < rangeEnd) {
+                removeWidth(column, widths[sourceIndex]);
+                ++sourceIndex;
+            }
+        }
+        while (sourceIndex < m_count) {
+            newWidths.append(widths[sourceIndex]);
+            ++sourceIndex;
+        }
+
+        m_columns[column].widths = newWidths;
+    }
+
+    m_count -= removedCount;
+    m_firstUnmeasuredIndex = qMin(m_firstUnmeasuredIndex, itemRanges.first().index);
+}
+
+void KItemListColumnWidthTracker::itemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes)
+{
+    // Moving items does not change any width, only the indexes must be adjusted
+    for (int column = 0; column < m_columns.count(); ++column) {
+        const QVector<qreal> widths = m_columns[column].widths;
+        QVector<qreal>& newWidths = m_columns[column].widths;
+
+        const int movedRangeEnd = itemRange.index + itemRange.count;
+        for (int i = itemRange.index; i < movedRangeEnd; ++i) {
+            newWidths[movedToIndexes.at(i - itemRange.index)] = widths.at(i);
+        }
+    }
+
+    m_firstUnmeasuredIndex = qMin(m_firstUnmeasuredIndex, itemRange.index);
+}
+
+void KItemListColumnWidthTracker::itemsChanged(const KItemRangeList& itemRanges)
+{
+    for (int column = 0; column < m_columns.count(); ++column) {
+        QVector<qreal>& widths = m_columns[column].widths;
+        foreach (const KItemRange& range, itemRanges) {
+            const int rangeEnd = qMin(range.index + range.count, m_count);
+            for (int i = range.index; i < rangeEnd; ++i) {
+                removeWidth(column, widths[i]);
+                widths[i] = -1;
+            }
+        }
+    }
+
+    if (!itemRanges.isEmpty()) {
+        m_firstUnmeasuredIndex = qMin(m_firstUnmeasuredIndex, itemRanges.first().index);
+    }
+}
+
+void KItemListColumnWidthTracker::invalidate()
+{
+    for (int column = 0; column < m_columns.count(); ++column) {
+        m_columns[column].widths.fill(-1);
+        m_columns[column].widthCounts.clear();
+    }
+    m_firstUnmeasuredIndex = 0;
+}
+
+int KItemListColumnWidthTracker::nextUnmeasuredIndex()
+{
+    if (m_columns.isEmpty()) {
+        return -1;
+    }
+
+    // All columns of an item are measured together, so checking
+    // the first column is sufficient.
+    const QVector<qreal>& widths = m_columns.first().widths;
+    while (m_firstUnmeasuredIndex < m_count && widths[m_firstUnmeasuredIndex] >= 0) {
+        ++m_firstUnmeasuredIndex;
+    }
+
+    return m_firstUnmeasuredIndex < m_count ? m_firstUnmeasuredIndex : -1;
+}
+
+void KItemListColumnWidthTracker::setWidths(int index, const QVector<qreal>& widths)
+{
+    Q_ASSERT(widths.count() == m_columns.count());
+    for (int column = 0; column < m_columns.count(); ++column) {
+        qreal& width = m_columns[column].widths[index];
+        removeWidth(column, width);
+        width = qMax(qreal(0), widths[column]);
+        addWidth(column, width);
+    }
+}
+
+qreal KItemListColumnWidthTracker::maximumWidth(const QByteArray& role) const
+{
+    const int column = m_roles.indexOf(role);
+    if (column < 0 || m_columns[column].widthCounts.isEmpty()) {
+        return 0;
+    }
+
+    return (m_columns[column].widthCounts.constEnd() - 1).key();
+}
+
+void KItemListColumnWidthTracker::addWidth(int column, qreal width)
+{
+    ++m_columns[column].widthCounts[width];
+}
+
+void KItemListColumnWidthTracker::removeWidth(int column, qreal width)
+{
+    if (width < 0) {
+        return;
+    }
+
+    QMap<qreal, int>& widthCounts = m_columns[column].widthCounts;
+    QMap<qreal, int>::iterator it = widthCounts.find(width);
+    if (it != widthCounts.end() && --it.value() == 0) {
+        widthCounts.erase(it);
+    }
+}
@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KITEMLISTCOLUMNWIDTHTRACKER_H
+#define KITEMLISTCOLUMNWIDTHTRACKER_H
+
+#include <libdolphin_export.h>
+
+#include <kitemviews/kitemrange.h>
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QVector>
+
+/**
+ * @brief Keeps track of the maximum preferred column-width of each role in KItemListView.
+ *
+ * The preferred widths of the items are stored together with a sorted
+ * count of all widths of a role. Inserting, removing and changing items
+ * only requires O(log n) operations to update the maximum width, instead
+ * of measuring all items again.
+ *
+ * Inserted and changed items are marked as unmeasured. The widths of these items
+ * must be provided by setWidths(), which can be done in several steps by
+ * invoking nextUnmeasuredIndex() until it returns -1.
+ */
+class LIBDOLPHINPRIVATE_EXPORT KItemListColumnWidthTracker
+{
+public:
+    KItemListColumnWidthTracker();
+    virtual ~KItemListColumnWidthTracker();
+
+    /**
+     * Sets the roles whose widths are tracked. All items are marked as unmeasured.
+     */
+    void setRoles(const QList<QByteArray>& roles);
+    QList<QByteArray> roles() const;
+
+    /**
+     * @return Number of items.
+     */
+    int count() const;
+
+    void itemsInserted(const KItemRangeList& itemRanges);
+    void itemsRemoved(const KItemRangeList& itemRanges);
+    void itemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes);
+
+    /**
+     * Marks the items in \a itemRanges as unmeasured.
+     */
+    void itemsChanged(const KItemRangeList& itemRanges);
+
+    /**
+     * Marks all items as unmeasured.
+     */
+    void invalidate();
+
+    /**
+     * @return Index of an item whose widths are unknown, or -1 if the widths of
+     *         all items are known. The unmeasured items are returned in ascending order.
+     */
+    int nextUnmeasuredIndex();
+
+    /**
+     * Sets the preferred widths of the item with the index \a index. The
+     * widths must be given in the same order as the roles.
+     */
+    void setWidths(int index, const QVector<qreal>& widths);
+
+    /**
+     * @return Maximum preferred width of all measured items for the role \a role.
+     *         0 is returned if no item has been measured yet.
+     */
+    qreal maximumWidth(const QByteArray& role) const;
+
+private:
+    void addWidth(int column, qreal width);
+    void removeWidth(int column, qreal width);
+
+private:
+    struct Column
+    {
+        // Preferred width of each item, -1 for unmeasured items
+        QVector<qreal> widths;
+        // Number of items for each measured width
+        QMap<qreal, int> widthCounts;
+    };
+
+    QList<QByteArray> m_roles;
+    QVector<Column> m_columns;
+    int m_count;
+
+    // All items before this index have been measured
+    int m_firstUnmeasuredIndex;
+};
+
+#endif
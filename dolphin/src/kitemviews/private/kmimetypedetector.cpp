@@ -0,0 +1,274 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kmimetypedetector.h"
+
+#include <KGlobal>
+#include <kio/global.h>
+#include <kio/udsentry.h>
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QThread>
+#include <QTimer>
+
+namespace {
+    // Detecting MIME types on network mounts is mostly bound by the
+    // latency, so several workers are used also on single core machines.
+    const int MaximumWorkerCount = 4;
+
+    // Number of items that are passed to a worker at once
+    const int BatchSize = 16;
+
+    // Maximum number of files whose MIME type is cached
+    const int MaximumCachedMimeTypes = 10000;
+
+    // Mount points might change, so directories are checked again
+    // after this interval in ms.
+    const qint64 SlowDirectoryCheckInterval = 60000;
+
+    // Maximum number of directories whose mount type is remembered
+    const int MaximumSlowDirectories = 1000;
+
+    struct CachedMimeType
+    {
+        qint64 modificationTime;
+        QString mimeType;
+    };
+
+    struct SlowDirectory
+    {
+        bool slow;
+        qint64 checkTime;
+    };
+}
+
+/**
+ * The detected MIME types and the mount types of the directories are shared
+ * by all instances. Only the main thread accesses them.
+ */
+class KMimeTypeDetectorCache
+{
+public:
+    KMimeTypeDetectorCache() :
+        mimeTypes(MaximumCachedMimeTypes),
+        slowDirectories(),
+        clock()
+    {
+        clock.start();
+    }
+
+    QCache<QPair<quint64, quint64>, CachedMimeType> mimeTypes;
+    QHash<QString, SlowDirectory> slowDirectories;
+    QElapsedTimer clock;
+};
+K_GLOBAL_STATIC(KMimeTypeDetectorCache, s_cache)
+
+KMimeTypeDetector::KMimeTypeDetector(QObject* parent) :
+    QObject(parent),
+    m_queue(),
+    m_queuedUrls(),
+    m_runningUrls(),
+    m_workerThreads(),
+    m_workers(),
+    m_idleWorkers(),
+    m_cachedMimeTypes()
+{
+}
+
+KMimeTypeDetector::~KMimeTypeDetector()
+{
+    foreach (QThread* thread, m_workerThreads) {
+        thread->quit();
+    }
+    foreach (QThread* thread, m_workerThreads) {
+        thread->wait();
+    }
+
+    qDeleteAll(m_workers);
+}
+
+bool KMimeTypeDetector::isSlow(const KFileItem& item)
+{
+    if (item.isNull() || item.isMimeTypeKnown() || item.isDir() || !item.isLocalFile()) {
+        return false;
+    }
+
+    if (item.entry().count() == 0) {
+        // The detected MIME type can only be applied to items that
+        // have been created from an UDS entry.
+        return false;
+    }
+
+    const QString directory = item.url().directory();
+    const qint64 now = s_cache->clock.elapsed();
+
+    QHash<QString, SlowDirectory>& slowDirectories = s_cache->slowDirectories;
+    QHash<QString, SlowDirectory>::iterator it = slowDirectories.find(directory);
+    if (it == slowDirectories.end() || now - it->checkTime > SlowDirectoryCheckInterval) {
+        if (slowDirectories.count() >= MaximumSlowDirectories) {
+            slowDirectories.clear();
+        }
+
+        SlowDirectory slowDirectory;
+        slowDirectory.slow = KIO::probably_slow_mounted(directory);
+        slowDirectory.checkTime = now;
+        it = slowDirectories.insert(directory, slowDirectory);
+    }
+
+    return it->slow;
+}
+
+void KMimeTypeDetector::prioritizeItems(const KFileItemList& items)
+{
+    const QList<KMimeTypeDetectorWorker::Item> queue = m_queue;
+    m_queue.clear();
+    m_queuedUrls.clear();
+
+    foreach (const KFileItem& item, items) {
+        enqueue(item);
+    }
+
+    foreach (const KMimeTypeDetectorWorker::Item& item, queue) {
+        if (!m_queuedUrls.contains(item.url)) {
+            m_queue.append(item);
+            m_queuedUrls.insert(item.url);
+        }
+    }
+
+    startQueuedWorkers();
+}
+
+void KMimeTypeDetector::addItem(const KFileItem& item)
+{
+    enqueue(item);
+    startQueuedWorkers();
+}
+
+void KMimeTypeDetector::clear()
+{
+    m_queue.clear();
+    m_queuedUrls.clear();
+    m_cachedMimeTypes.clear();
+}
+
+void KMimeTypeDetector::slotResult(const KMimeTypeDetectorWorker::Batch& batch)
+{
+    KMimeTypeDetectorWorker* worker = qobject_cast<KMimeTypeDetectorWorker*>(sender());
+    Q_ASSERT(worker);
+    m_idleWorkers.append(worker);
+
+    QHash<KUrl, QString> mimeTypes;
+    foreach (const KMimeTypeDetectorWorker::Item& item, batch) {
+        m_runningUrls.remove(item.url);
+        mimeTypes.insert(item.url, item.mimeType);
+
+        if (item.inode > 0) {
+            CachedMimeType* cachedMimeType = new CachedMimeType();
+            cachedMimeType->modificationTime = item.modificationTime;
+            cachedMimeType->mimeType = item.mimeType;
+            s_cache->mimeTypes.insert(qMakePair(item.device, item.inode), cachedMimeType);
+        }
+    }
+
+    startQueuedWorkers();
+
+    emit mimeTypesDetected(mimeTypes);
+}
+
+void KMimeTypeDetector::emitCachedMimeTypes()
+{
+    if (!m_cachedMimeTypes.isEmpty()) {
+        const QHash<KUrl, QString> mimeTypes = m_cachedMimeTypes;
+        m_cachedMimeTypes.clear();
+        emit mimeTypesDetected(mimeTypes);
+    }
+}
+
+void KMimeTypeDetector::enqueue(const KFileItem& item)
+{
+    if (!isSlow(item)) {
+        return;
+    }
+
+    const KUrl url = item.url();
+    if (m_queuedUrls.contains(url) || m_runningUrls.contains(url) || m_cachedMimeTypes.contains(url)) {
+        return;
+    }
+
+    const KIO::UDSEntry entry = item.entry();
+
+    KMimeTypeDetectorWorker::Item detectorItem;
+    detectorItem.url = url;
+    detectorItem.localPath = item.localPath();
+    detectorItem.mode = item.mode();
+    detectorItem.device = entry.numberValue(KIO::UDSEntry::UDS_DEVICE_ID, 0);
+    detectorItem.inode = entry.numberValue(KIO::UDSEntry::UDS_INODE, 0);
+    detectorItem.modificationTime = entry.numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
+
+    if (detectorItem.inode > 0) {
+        const CachedMimeType* cachedMimeType = s_cache->mimeTypes.object(qMakePair(detectorItem.device, detectorItem.inode));
+        if (cachedMimeType && cachedMimeType->modificationTime == detectorItem.modificationTime) {
+            if (m_cachedMimeTypes.isEmpty()) {
+                QTimer::singleShot(0, this, SLOT(emitCachedMimeTypes()));
+            }
+            m_cachedMimeTypes.insert(url, cachedMimeType->mimeType);
+            return;
+        }
+    }
+
+    m_queue.append(detectorItem);
+    m_queuedUrls.insert(url);
+}
+
+void KMimeTypeDetector::startQueuedWorkers()
+{
+    while (!m_queue.isEmpty()) {
+        if (m_idleWorkers.isEmpty()) {
+            const int maximumWorkerCount = qBound(2, QThread::idealThreadCount(), MaximumWorkerCount);
+            if (m_workers.count() >= maximumWorkerCount) {
+                return;
+            }
+
+            QThread* thread = new QThread(this);
+            KMimeTypeDetectorWorker* worker = new KMimeTypeDetectorWorker();
+            worker->moveToThread(thread);
+            connect(worker, SIGNAL(result(KMimeTypeDetectorWorker::Batch)),
+                    this,   SLOT(slotResult(KMimeTypeDetectorWorker::Batch)));
+            thread->start();
+
+            m_workerThreads.append(thread);
+            m_workers.append(worker);
+            m_idleWorkers.append(worker);
+        }
+
+        KMimeTypeDetectorWorker::Batch batch;
+        while (!m_queue.isEmpty() && batch.count() < BatchSize) {
+            const KMimeTypeDetectorWorker::Item item = m_queue.takeFirst();
+            m_queuedUrls.remove(item.url);
+            m_runningUrls.insert(item.url);
+            batch.append(item);
+        }
+
+        KMimeTypeDetectorWorker* worker = m_idleWorkers.takeLast();
+        QMetaObject::invokeMethod(worker, "detectMimeTypes", Qt::QueuedConnection,
+                                  Q_ARG(KMimeTypeDetectorWorker::Batch, batch));
+    }
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KMIMETYPEDETECTOR_H
+#define KMIMETYPEDETECTOR_H
+
+#include "kmimetypedetectorworker.h"
+
+#include <KFileItem>
+#include <KUrl>
+
+#include <libdolphin_export.h>
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+class QThread;
+
+/**
+ * @brief Detects the MIME types of files on slow file systems in the background.
+ *
+ * Detecting the MIME type of a file may require reading its first bytes.
+ * On network mounts, this blocks for a full round trip for each file. The
+ * detection is done by several worker threads for batches of files, and
+ * the results are announced in batches as well.
+ *
+ * The detected MIME types are shared by all instances and remain valid as
+ * long as the device, the inode, and the modification time of the file are
+ * unchanged.
+ */
+class LIBDOLPHINPRIVATE_EXPORT KMimeTypeDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KMimeTypeDetector(QObject* parent = 0);
+    virtual ~KMimeTypeDetector();
+
+    /**
+     * @return True, if the MIME type of \a item is unknown and determining
+     *         it might block the user interface for a noticeable time,
+     *         because \a item is a local file on a slow (e.g. network) mount.
+     *         The MIME types of such items should be requested from a
+     *         KMimeTypeDetector instead of calling KFileItem::determineMimeType().
+     */
+    static bool isSlow(const KFileItem& item);
+
+    /**
+     * Queues \a items before all other queued items. The MIME types are
+     * detected in the order of the list, so the most important items,
+     * e.g., the visible ones, should be at the beginning. Items that are
+     * not slow according to isSlow() are ignored.
+     */
+    void prioritizeItems(const KFileItemList& items);
+
+    /**
+     * Appends \a item to the queued items, if it is not queued yet.
+     */
+    void addItem(const KFileItem& item);
+
+    /**
+     * Removes all queued items. Batches that are handled by the
+     * worker threads already are not canceled.
+     */
+    void clear();
+
+signals:
+    /**
+     * Signals that the items with the URLs that are the keys of \a mimeTypes
+     * have the MIME types that are the corresponding values.
+     */
+    void mimeTypesDetected(const QHash<KUrl, QString>& mimeTypes);
+
+private slots:
+    void slotResult(const KMimeTypeDetectorWorker::Batch& batch);
+
+    /**
+     * Announces the MIME types that have been found in the cache by enqueue().
+     */
+    void emitCachedMimeTypes();
+
+private:
+    /**
+     * Appends \a item to m_queue, or to m_cachedMimeTypes if its MIME type
+     * is cached already.
+     */
+    void enqueue(const KFileItem& item);
+
+    /**
+     * Passes batches of the queued items to idle workers. New workers
+     * are created until the maximum number of workers is reached.
+     */
+    void startQueuedWorkers();
+
+private:
+    QList<KMimeTypeDetectorWorker::Item> m_queue;
+    QSet<KUrl> m_queuedUrls;
+
+    // URLs of the items that are handled by the workers currently
+    QSet<KUrl> m_runningUrls;
+
+    QList<QThread*> m_workerThreads;
+    QList<KMimeTypeDetectorWorker*> m_workers;
+    QList<KMimeTypeDetectorWorker*> m_idleWorkers;
+
+    QHash<KUrl, QString> m_cachedMimeTypes;
+};
+
+#endif
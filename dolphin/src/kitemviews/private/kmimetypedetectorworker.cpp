@@ -0,0 +1,41 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kmimetypedetectorworker.h"
+
+#include <KMimeType>
+
+KMimeTypeDetectorWorker::KMimeTypeDetectorWorker(QObject* parent) :
+    QObject(parent)
+{
+    qRegisterMetaType<KMimeTypeDetectorWorker::Batch>();
+}
+
+void KMimeTypeDetectorWorker::detectMimeTypes(const KMimeTypeDetectorWorker::Batch& batch)
+{
+    Batch detected = batch;
+    for (Batch::iterator it = detected.begin(); it != detected.end(); ++it) {
+        // Like KFileItem::determineMimeType(), but without touching the
+        // KFileItem, which may only be used by the main thread.
+        const KMimeType::Ptr mimeType = KMimeType::findByUrl(KUrl(it->localPath), it->mode, true);
+        it->mimeType = mimeType ? mimeType->name() : KMimeType::defaultMimeType();
+    }
+
+    emit result(detected);
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KMIMETYPEDETECTORWORKER_H
+#define KMIMETYPEDETECTORWORKER_H
+
+#include <KUrl>
+
+#include <QList>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+
+class KMimeTypeDetectorWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Item
+    {
+        KUrl url;
+        QString localPath;
+        uint mode;
+        quint64 device;
+        quint64 inode;
+        qint64 modificationTime;
+        QString mimeType;
+    };
+    typedef QList<Item> Batch;
+
+    explicit KMimeTypeDetectorWorker(QObject* parent = 0);
+
+signals:
+    /**
+     * Signals that the MIME types of the items of \a batch have been
+     * detected and stored in Item::mimeType.
+     */
+    void result(const KMimeTypeDetectorWorker::Batch& batch);
+
+public slots:
+    /**
+     * Detects the MIME types of the local files of \a batch. The content of
+     * a file is only read if its name is not sufficient for the detection.
+     * The result is announced via the signal \a result.
+     */
+    void detectMimeTypes(const KMimeTypeDetectorWorker::Batch& batch);
+};
+
+Q_DECLARE_METATYPE(KMimeTypeDetectorWorker::Batch)
+
+#endif
@@ -40,6 +40,7 @@
 #include <QSize>
 
 #include <KDebug>
+#include <KGlobal>
 
 #include <config-X11.h> // for HAVE_XRENDER
 #if defined(Q_WS_X11) && defined(HAVE_XRENDER)
@@ -266,7 +267,11 @@ static void shadowBlur(QImage& image, float radius, const QColor& color)
 }
 
 namespace {
-    /** Helper class for drawing frames for KPixmapModifier::applyFrame(). */
+    /**
+     * Helper class for drawing frames for KPixmapModifier::applyFrame().
+     * The tiles are stored as images, so that frames can also be drawn
+     * by other threads than the main thread.
+     */
     class TileSet
     {
     public:
@@ -288,43 +293,47 @@ namespace {
 
             shadowBlur(image, 3, Qt::black);
 
-            QPixmap pixmap = QPixmap::fromImage(image);
-            m_tiles[TopLeftCorner]     = pixmap.copy(0, 0, 8, 8);
-            m_tiles[TopSide]           = pixmap.copy(8, 0, 8, 8);
-            m_tiles[TopRightCorner]    = pixmap.copy(16, 0, 8, 8);
-            m_tiles[LeftSide]          = pixmap.copy(0, 8, 8, 8);
-            m_tiles[RightSide]         = pixmap.copy(16, 8, 8, 8);
-            m_tiles[BottomLeftCorner]  = pixmap.copy(0, 16, 8, 8);
-            m_tiles[BottomSide]        = pixmap.copy(8, 16, 8, 8);
-            m_tiles[BottomRightCorner] = pixmap.copy(16, 16, 8, 8);
+            m_tiles[TopLeftCorner]     = image.copy(0, 0, 8, 8);
+            m_tiles[TopSide]           = image.copy(8, 0, 8, 8);
+            m_tiles[TopRightCorner]    = image.copy(16, 0, 8, 8);
+            m_tiles[LeftSide]          = image.copy(0, 8, 8, 8);
+            m_tiles[RightSide]         = image.copy(16, 8, 8, 8);
+            m_tiles[BottomLeftCorner]  = image.copy(0, 16, 8, 8);
+            m_tiles[BottomSide]        = image.copy(8, 16, 8, 8);
+            m_tiles[BottomRightCorner] = image.copy(16, 16, 8, 8);
         }
 
         void paint(QPainter* p, const QRect& r)
         {
-            p->drawPixmap(r.topLeft(), m_tiles[TopLeftCorner]);
+            // The side tiles are uniform along the side, so stretching
+            // them without smoothing is equivalent to tiling them.
+            p->drawImage(r.topLeft(), m_tiles[TopLeftCorner]);
             if (r.width() - 16 > 0) {
-                p->drawTiledPixmap(r.x() + 8, r.y(), r.width() - 16, 8, m_tiles[TopSide]);
+                p->drawImage(QRect(r.x() + 8, r.y(), r.width() - 16, 8), m_tiles[TopSide]);
             }
-            p->drawPixmap(r.right() - 8 + 1, r.y(), m_tiles[TopRightCorner]);
+            p->drawImage(QPoint(r.right() - 8 + 1, r.y()), m_tiles[TopRightCorner]);
             if (r.height() - 16 > 0) {
-                p->drawTiledPixmap(r.x(), r.y() + 8, 8, r.height() - 16,  m_tiles[LeftSide]);
-                p->drawTiledPixmap(r.right() - 8 + 1, r.y() + 8, 8, r.height() - 16, m_tiles[RightSide]);
+                p->drawImage(QRect(r.x(), r.y() + 8, 8, r.height() - 16),  m_tiles[LeftSide]);
+                p->drawImage(QRect(r.right() - 8 + 1, r.y() + 8, 8, r.height() - 16), m_tiles[RightSide]);
             }
-            p->drawPixmap(r.x(), r.bottom() - 8 + 1, m_tiles[BottomLeftCorner]);
+            p->drawImage(QPoint(r.x(), r.bottom() - 8 + 1), m_tiles[BottomLeftCorner]);
             if (r.width() - 16 > 0) {
-                p->drawTiledPixmap(r.x() + 8, r.bottom() - 8 + 1, r.width() - 16, 8, m_tiles[BottomSide]);
+                p->drawImage(QRect(r.x() + 8, r.bottom() - 8 + 1, r.width() - 16, 8), m_tiles[BottomSide]);
             }
-            p->drawPixmap(r.right() - 8 + 1, r.bottom() - 8 + 1, m_tiles[BottomRightCorner]);
+            p->drawImage(QPoint(r.right() - 8 + 1, r.bottom() - 8 + 1), m_tiles[BottomRightCorner]);
 
             const QRect contentRect = r.adjusted(LeftMargin + 1, TopMargin + 1,
                                                  -(RightMargin + 1), -(BottomMargin + 1));
             p->fillRect(contentRect, Qt::transparent);
         }
 
-        QPixmap m_tiles[NumTiles];
+        QImage m_tiles[NumTiles];
     };
 }
 
+// The creation of the tile set is thread-safe
+K_GLOBAL_STATIC(TileSet, s_tileSet)
+
 void KPixmapModifier::scale(QPixmap& pixmap, const QSize& scaledSize)
 {
     if (scaledSize.isEmpty()) {
@@ -369,10 +378,18 @@ void KPixmapModifier::scale(QPixmap& pixmap, const QSize& scaledSize)
 #endif
 }
 
-void KPixmapModifier::applyFrame(QPixmap& icon, const QSize& scaledSize)
+void KPixmapModifier::scale(QImage& image, const QSize& scaledSize)
 {
-    static TileSet tileSet;
+    if (scaledSize.isEmpty() || image.isNull()) {
+        image = QImage();
+        return;
+    }
+
+    image = image.scaled(scaledSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
 
+void KPixmapModifier::applyFrame(QPixmap& icon, const QSize& scaledSize)
+{
     // Resize the icon to the maximum size minus the space required for the frame
     const QSize size(scaledSize.width() - TileSet::LeftMargin - TileSet::RightMargin,
                      scaledSize.height() - TileSet::TopMargin - TileSet::BottomMargin);
@@ -385,13 +402,39 @@ void KPixmapModifier::applyFrame(QPixmap& icon, const QSize& scaledSize)
     QPainter painter;
     painter.begin(&framedIcon);
     painter.setCompositionMode(QPainter::CompositionMode_Source);
-    tileSet.paint(&painter, framedIcon.rect());
+    s_tileSet->paint(&painter, framedIcon.rect());
     painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
     painter.drawPixmap(TileSet::LeftMargin, TileSet::TopMargin, icon);
 
     icon = framedIcon;
 }
 
+void KPixmapModifier::applyFrame(QImage& icon, const QSize& scaledSize)
+{
+    // Resize the icon to the maximum size minus the space required for the frame
+    scale(icon, sizeInsideFrame(scaledSize));
+
+    QImage framedIcon(icon.width() + TileSet::LeftMargin + TileSet::RightMargin,
+                      icon.height() + TileSet::TopMargin + TileSet::BottomMargin,
+                      QImage::Format_ARGB32_Premultiplied);
+    framedIcon.fill(0);
+
+    QPainter painter;
+    painter.begin(&framedIcon);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    s_tileSet->paint(&painter, framedIcon.rect());
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter.drawImage(TileSet::LeftMargin, TileSet::TopMargin, icon);
+    painter.end();
+
+    icon = framedIcon;
+}
+
+void KPixmapModifier::blur(QImage& image, int radius)
+{
+    stackBlur(image, radius);
+}
+
 QSize KPixmapModifier::sizeInsideFrame(const QSize& frameSize)
 {
     return QSize(frameSize.width() - TileSet::LeftMargin - TileSet::RightMargin,
@@ -22,6 +22,7 @@
 
 #include <libdolphin_export.h>
 
+class QImage;
 class QPixmap;
 class QSize;
 
@@ -31,6 +32,24 @@ public:
     static void scale(QPixmap& pixmap, const QSize& scaledSize);
     static void applyFrame(QPixmap& icon, const QSize& scaledSize);
     static QSize sizeInsideFrame(const QSize& frameSize);
+
+    /**
+     * In contrast to QPixmap, QImage may also be used by other threads
+     * than the main thread. The image versions of scale() and applyFrame()
+     * are thread-safe.
+     */
+    static void scale(QImage& image, const QSize& scaledSize);
+    static void applyFrame(QImage& icon, const QSize& scaledSize);
+
+private:
+    /**
+     * Blurs the alpha channel of \a image with the stack blur algorithm,
+     * which is used for the shadow of the frame. The image must have the
+     * format QImage::Format_ARGB32_Premultiplied.
+     */
+    static void blur(QImage& image, int radius);
+
+    friend class KPixmapModifierBenchmark;   // Accesses blur()
 };
 
 #endif
@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kpreviewcache.h"
+
+#include <KFileItem>
+#include <KGlobal>
+#include <KSharedDataCache>
+
+#include <QImage>
+#include <QMutexLocker>
+#include <QSize>
+#include <QStringList>
+
+#include <cstring>
+
+namespace {
+    // Size of the cache file, which is shared by all processes
+    const unsigned CacheSize = 100 * 1024 * 1024;
+
+    // Size of a framed preview for the default icon size
+    const unsigned ExpectedPreviewSize = 64 * 1024;
+
+    // Must be increased if the look of the frames or the format
+    // of the stored data is changed.
+    const int CacheVersion = 1;
+
+    // Previews with a larger width or height are not cached. The size of
+    // the stored previews is checked before using it, as the cache file
+    // can be changed by other processes.
+    const int MaximumPreviewSide = 4096;
+
+    struct PreviewHeader
+    {
+        qint32 width;
+        qint32 height;
+    };
+}
+
+class KPreviewCacheSingleton
+{
+public:
+    KPreviewCache instance;
+};
+K_GLOBAL_STATIC(KPreviewCacheSingleton, s_previewCache)
+
+
+KPreviewCache& KPreviewCache::instance()
+{
+    return s_previewCache->instance;
+}
+
+KPreviewCache::KPreviewCache() :
+    m_mutex(),
+    m_cache(0)
+{
+    m_cache = new KSharedDataCache("dolphin-previews", CacheSize, ExpectedPreviewSize);
+    m_cache->setEvictionPolicy(KSharedDataCache::EvictLeastRecentlyUsed);
+}
+
+KPreviewCache::~KPreviewCache()
+{
+    delete m_cache;
+}
+
+QString KPreviewCache::key(const KFileItem& item, const QSize& iconSize,
+                           bool enlargeSmallPreviews, const QStringList& enabledPlugins)
+{
+    const KDateTime modificationTime = item.time(KFileItem::ModificationTime);
+    if (!modificationTime.isValid()) {
+        return QString();
+    }
+
+    QStringList plugins = enabledPlugins;
+    plugins.sort();
+
+    return QString::number(CacheVersion) + QLatin1Char(' ') +
+           QString::number(iconSize.width()) + QLatin1Char('x') + QString::number(iconSize.height()) + QLatin1Char(' ') +
+           (enlargeSmallPreviews ? QLatin1String("enlarged ") : QLatin1String("centered ")) +
+           QString::number(modificationTime.toTime_t()) + QLatin1Char(' ') +
+           plugins.join(QLatin1String(",")) + QLatin1Char(' ') +
+           item.url().url();
+}
+
+bool KPreviewCache::find(const QString& key, QImage* destination)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    QByteArray data;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_cache->find(key, &data)) {
+            return false;
+        }
+    }
+
+    if (data.size() < int(sizeof(PreviewHeader))) {
+        return false;
+    }
+
+    PreviewHeader header;
+    std::memcpy(&header, data.constData(), sizeof(PreviewHeader));
+
+    if (header.width <= 0 || header.height <= 0 ||
+        header.width > MaximumPreviewSide || header.height > MaximumPreviewSide) {
+        return false;
+    }
+
+    const qint64 byteCount = qint64(header.width) * header.height * 4;
+    if (data.size() != qint64(sizeof(PreviewHeader)) + byteCount) {
+        return false;
+    }
+
+    // The width of an image with 32 bits per pixel is always aligned,
+    // so the pixels can be copied at once.
+    QImage image(header.width, header.height, QImage::Format_ARGB32_Premultiplied);
+    std::memcpy(image.bits(), data.constData() + sizeof(PreviewHeader), byteCount);
+
+    *destination = image;
+    return true;
+}
+
+void KPreviewCache::insert(const QString& key, const QImage& image)
+{
+    if (key.isEmpty() || image.isNull() ||
+        image.width() > MaximumPreviewSide || image.height() > MaximumPreviewSide) {
+        return;
+    }
+
+    const QImage premultipliedImage = (image.format() == QImage::Format_ARGB32_Premultiplied)
+                                      ? image
+                                      : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    PreviewHeader header;
+    header.width = premultipliedImage.width();
+    header.height = premultipliedImage.height();
+
+    // The previews are stored uncompressed, as decoding compressed images
+    // would delay showing the cached previews of a folder.
+    const int byteCount = header.width * header.height * 4;
+    QByteArray data;
+    data.resize(sizeof(PreviewHeader) + byteCount);
+    std::memcpy(data.data(), &header, sizeof(PreviewHeader));
+    std::memcpy(data.data() + sizeof(PreviewHeader), premultipliedImage.constBits(), byteCount);
+
+    QMutexLocker locker(&m_mutex);
+    m_cache->insert(key, data);
+}
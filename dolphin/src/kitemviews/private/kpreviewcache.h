@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KPREVIEWCACHE_H
+#define KPREVIEWCACHE_H
+
+#include <libdolphin_export.h>
+
+#include <QMutex>
+#include <QString>
+
+class KFileItem;
+class KSharedDataCache;
+class QImage;
+class QSize;
+class QStringList;
+
+/**
+ * @brief Persistent cache for scaled and framed previews.
+ *
+ * The previews are stored in the size in which they are shown, so that
+ * no preview job and no scaling is required when a folder is shown again.
+ * The cache is a memory-mapped file that is shared by all processes which
+ * show Dolphin views, e.g., Dolphin and Konqueror. The least recently used
+ * previews are evicted if the cache is full.
+ *
+ * All methods are thread-safe.
+ */
+class LIBDOLPHINPRIVATE_EXPORT KPreviewCache
+{
+public:
+    static KPreviewCache& instance();
+    virtual ~KPreviewCache();
+
+    /**
+     * @return Key for the preview of \a item, or an empty string if the
+     *         preview cannot be cached because the modification time of
+     *         the item is unknown. All parameters that affect the look of
+     *         the preview are part of the key.
+     */
+    static QString key(const KFileItem& item, const QSize& iconSize,
+                       bool enlargeSmallPreviews, const QStringList& enabledPlugins);
+
+    /**
+     * Stores \a image in \a destination if an image for \a key is cached.
+     * @return True, if the image has been found.
+     */
+    bool find(const QString& key, QImage* destination);
+
+    void insert(const QString& key, const QImage& image);
+
+protected:
+    KPreviewCache();
+
+private:
+    QMutex m_mutex;
+    KSharedDataCache* m_cache;
+
+    friend class KPreviewCacheSingleton;
+};
+
+#endif
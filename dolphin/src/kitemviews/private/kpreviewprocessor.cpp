@@ -0,0 +1,215 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kpreviewprocessor.h"
+
+#include "kpixmapmodifier.h"
+#include "kpreviewcache.h"
+
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace {
+    // Maximum number of threads that process previews. One core
+    // is left for the main thread.
+    const int MaximumThreadCount = 4;
+
+    // Interval in ms for collecting the processed previews, which
+    // corresponds to one frame at 60 frames per second.
+    const int DeliveryInterval = 16;
+}
+
+class KPreviewProcessor::Task : public QRunnable
+{
+public:
+    Task(KPreviewProcessor* processor, int generation, const KUrl& url, const QImage& preview,
+         const QSize& iconSize, bool applyFrame, bool enlargeSmallPreviews, const QString& cacheKey) :
+        QRunnable(),
+        m_processor(processor),
+        m_generation(generation),
+        m_url(url),
+        m_preview(preview),
+        m_iconSize(iconSize),
+        m_applyFrame(applyFrame),
+        m_enlargeSmallPreviews(enlargeSmallPreviews),
+        m_cacheKey(cacheKey)
+    {
+    }
+
+    virtual void run()
+    {
+        if (!m_processor->isCurrentGeneration(m_generation)) {
+            // clear() has been invoked since the task has been queued
+            return;
+        }
+
+        KPreviewProcessor::processPreview(m_preview, m_iconSize, m_applyFrame, m_enlargeSmallPreviews);
+        m_processor->addResult(m_generation, m_url, m_preview);
+
+        if (!m_cacheKey.isEmpty()) {
+            KPreviewCache::instance().insert(m_cacheKey, m_preview);
+        }
+    }
+
+private:
+    KPreviewProcessor* m_processor;
+    int m_generation;
+    KUrl m_url;
+    QImage m_preview;
+    QSize m_iconSize;
+    bool m_applyFrame;
+    bool m_enlargeSmallPreviews;
+    QString m_cacheKey;
+};
+
+KPreviewProcessor::KPreviewProcessor(QObject* parent) :
+    QObject(parent),
+    m_threadPool(0),
+    m_deliveryTimer(0),
+    m_mutex(),
+    m_generation(0),
+    m_results()
+{
+    m_threadPool = new QThreadPool(this);
+    m_threadPool->setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, MaximumThreadCount));
+
+    m_deliveryTimer = new QTimer(this);
+    m_deliveryTimer->setInterval(DeliveryInterval);
+    m_deliveryTimer->setSingleShot(true);
+    connect(m_deliveryTimer, SIGNAL(timeout()), this, SLOT(slotDeliveryTimerTimeout()));
+}
+
+KPreviewProcessor::~KPreviewProcessor()
+{
+    // The tasks access this object. Queued tasks return
+    // immediately, as clear() increases the generation.
+    clear();
+    m_threadPool->waitForDone();
+}
+
+void KPreviewProcessor::addPreview(const KUrl& url, const QImage& preview, const QSize& iconSize,
+                                   bool applyFrame, bool enlargeSmallPreviews, const QString& cacheKey)
+{
+    int generation;
+    {
+        QMutexLocker locker(&m_mutex);
+        generation = m_generation;
+    }
+
+    m_threadPool->start(new Task(this, generation, url, preview, iconSize,
+                                 applyFrame, enlargeSmallPreviews, cacheKey));
+}
+
+void KPreviewProcessor::clear()
+{
+    m_deliveryTimer->stop();
+
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    m_results.clear();
+}
+
+void KPreviewProcessor::processPreview(QImage& preview, const QSize& iconSize,
+                                       bool applyFrame, bool enlargeSmallPreviews)
+{
+    if (preview.format() != QImage::Format_ARGB32_Premultiplied) {
+        preview = preview.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    if (!applyFrame) {
+        KPixmapModifier::scale(preview, iconSize);
+        return;
+    }
+
+    if (enlargeSmallPreviews) {
+        KPixmapModifier::applyFrame(preview, iconSize);
+        return;
+    }
+
+    // Assure that small previews don't get enlarged. Instead they
+    // should be shown centered within the frame.
+    const QSize contentSize = KPixmapModifier::sizeInsideFrame(iconSize);
+    const bool enlargingRequired = preview.width()  < contentSize.width() &&
+                                   preview.height() < contentSize.height();
+    if (enlargingRequired) {
+        QSize frameSize = preview.size();
+        frameSize.scale(iconSize, Qt::KeepAspectRatio);
+
+        QImage largeFrame(frameSize, QImage::Format_ARGB32_Premultiplied);
+        largeFrame.fill(0);
+
+        KPixmapModifier::applyFrame(largeFrame, frameSize);
+
+        QPainter painter(&largeFrame);
+        painter.drawImage((largeFrame.width()  - preview.width()) / 2,
+                          (largeFrame.height() - preview.height()) / 2,
+                          preview);
+        painter.end();
+        preview = largeFrame;
+    } else {
+        // The image must be shrinked as it is too large to fit into
+        // the available icon size
+        KPixmapModifier::applyFrame(preview, iconSize);
+    }
+}
+
+void KPreviewProcessor::slotResultsAvailable()
+{
+    if (!m_deliveryTimer->isActive()) {
+        m_deliveryTimer->start();
+    }
+}
+
+void KPreviewProcessor::slotDeliveryTimerTimeout()
+{
+    QHash<KUrl, QImage> results;
+    {
+        QMutexLocker locker(&m_mutex);
+        results.swap(m_results);
+    }
+
+    if (!results.isEmpty()) {
+        emit previewsProcessed(results);
+    }
+}
+
+bool KPreviewProcessor::isCurrentGeneration(int generation)
+{
+    QMutexLocker locker(&m_mutex);
+    return generation == m_generation;
+}
+
+void KPreviewProcessor::addResult(int generation, const KUrl& url, const QImage& preview)
+{
+    QMutexLocker locker(&m_mutex);
+    if (generation != m_generation) {
+        return;
+    }
+
+    const bool wasEmpty = m_results.isEmpty();
+    m_results.insert(url, preview);
+    if (wasEmpty) {
+        // Start m_deliveryTimer in the main thread
+        QMetaObject::invokeMethod(this, "slotResultsAvailable", Qt::QueuedConnection);
+    }
+}
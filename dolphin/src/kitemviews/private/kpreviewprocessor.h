@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KPREVIEWPROCESSOR_H
+#define KPREVIEWPROCESSOR_H
+
+#include <KUrl>
+
+#include <libdolphin_export.h>
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+
+class QThreadPool;
+class QTimer;
+
+/**
+ * @brief Scales and frames previews in worker threads.
+ *
+ * The previews are processed as QImage, which in contrast to QPixmap may
+ * be used by other threads than the main thread. The processed previews
+ * are collected and announced together once per frame, so that the
+ * receiver can update the model with one transaction.
+ */
+class LIBDOLPHINPRIVATE_EXPORT KPreviewProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KPreviewProcessor(QObject* parent = 0);
+    virtual ~KPreviewProcessor();
+
+    /**
+     * Scales the preview \a preview of the item \a url to \a iconSize. If
+     * \a applyFrame is true, a frame is drawn around the preview. The result
+     * is announced by the signal previewsProcessed().
+     *
+     * @param enlargeSmallPreviews If false, framed previews that are smaller
+     *                             than the area inside the frame are centered
+     *                             in the frame instead of being enlarged.
+     * @param cacheKey             If not empty, the result is stored in the
+     *                             KPreviewCache with this key.
+     */
+    void addPreview(const KUrl& url, const QImage& preview, const QSize& iconSize,
+                    bool applyFrame, bool enlargeSmallPreviews, const QString& cacheKey);
+
+    /**
+     * Discards all previews that have not been announced yet. Must be
+     * invoked if the previews are outdated, e.g., because the icon size
+     * has been changed.
+     */
+    void clear();
+
+    /**
+     * Scales and frames \a preview like addPreview(), but synchronously.
+     */
+    static void processPreview(QImage& preview, const QSize& iconSize,
+                               bool applyFrame, bool enlargeSmallPreviews);
+
+signals:
+    /**
+     * Signals that the previews that are the values of \a previews
+     * have been processed for the items that are the keys.
+     */
+    void previewsProcessed(const QHash<KUrl, QImage>& previews);
+
+private slots:
+    void slotResultsAvailable();
+    void slotDeliveryTimerTimeout();
+
+private:
+    class Task;
+
+    /**
+     * @return True, if clear() has not been invoked since a preview of
+     *         the generation \a generation has been added.
+     */
+    bool isCurrentGeneration(int generation);
+
+    /**
+     * Is invoked by the worker threads and stores the processed preview
+     * \a preview, if clear() has not been invoked since the preview has
+     * been added.
+     */
+    void addResult(int generation, const KUrl& url, const QImage& preview);
+
+    QThreadPool* m_threadPool;
+    QTimer* m_deliveryTimer;
+
+    // Protects m_generation and m_results
+    QMutex m_mutex;
+    int m_generation;
+    QHash<KUrl, QImage> m_results;
+};
+
+#endif
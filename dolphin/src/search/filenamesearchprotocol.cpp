@@ -18,6 +18,7 @@
  ***************************************************************************/
 
 #include "filenamesearchprotocol.h"
+#include "filenamesearchwalker.h"
 
 #include <KComponentData>
 #include <KDirLister>
@@ -25,17 +26,21 @@
 #include <KIO/NetAccess>
 #include <KIO/Job>
 #include <KUrl>
+#include <KUser>
 #include <ktemporaryfile.h>
 
 #include <QCoreApplication>
 #include <QEventLoop>
+#include <QFileInfo>
 #include <QRegExp>
 
 FileNameSearchProtocol::FileNameSearchProtocol( const QByteArray &pool, const QByteArray &app ) :
     SlaveBase("search", pool, app),
     m_checkContent(false),
     m_regExp(0),
-    m_iteratedDirs()
+    m_iteratedDirs(),
+    m_userNames(),
+    m_groupNames()
 {
 }
 
@@ -59,8 +64,12 @@ void FileNameSearchProtocol::listDir(const KUrl& url)
         m_checkContent = true;
     }
 
-    const QString urlString = url.queryItem("url");
-    searchDirectory(KUrl(urlString));
+    const KUrl directory(url.queryItem("url"));
+    if (directory.isLocalFile() && QFileInfo(directory.toLocalFile()).isDir()) {
+        searchLocalDirectory(directory.toLocalFile());
+    } else {
+        searchDirectory(directory);
+    }
 
     cleanup();
     finished();
@@ -127,6 +136,71 @@ void FileNameSearchProtocol::searchDirectory(const KUrl& directory)
     }
 }
 
+void FileNameSearchProtocol::searchLocalDirectory(const QString& path)
+{
+    FileNameSearchWalker walker(m_regExp ? *m_regExp : QRegExp(), m_checkContent);
+    walker.start(path);
+
+    QList<FileNameSearchWalker::Match> matches = walker.takeMatches();
+    while (!matches.isEmpty()) {
+        if (wasKilled()) {
+            walker.cancel();
+            return;
+        }
+
+        KIO::UDSEntryList entries;
+        entries.reserve(matches.count());
+        foreach (const FileNameSearchWalker::Match& match, matches) {
+            const QString itemPath = QFile::decodeName(match.path);
+
+            KIO::UDSEntry entry;
+            entry.insert(KIO::UDSEntry::UDS_NAME, itemPath.mid(itemPath.lastIndexOf(QLatin1Char('/')) + 1));
+            entry.insert(KIO::UDSEntry::UDS_URL, KUrl(itemPath).url());
+            entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, match.stat.st_mode & S_IFMT);
+            entry.insert(KIO::UDSEntry::UDS_ACCESS, match.stat.st_mode & 07777);
+            entry.insert(KIO::UDSEntry::UDS_SIZE, match.stat.st_size);
+            entry.insert(KIO::UDSEntry::UDS_MODIFICATION_TIME, match.stat.st_mtime);
+            entry.insert(KIO::UDSEntry::UDS_ACCESS_TIME, match.stat.st_atime);
+            entry.insert(KIO::UDSEntry::UDS_USER, userName(match.stat.st_uid));
+            entry.insert(KIO::UDSEntry::UDS_GROUP, groupName(match.stat.st_gid));
+            if (!match.linkDest.isEmpty()) {
+                entry.insert(KIO::UDSEntry::UDS_LINK_DEST, QFile::decodeName(match.linkDest));
+            }
+            entries.append(entry);
+        }
+        listEntries(entries);
+
+        matches = walker.takeMatches();
+    }
+    listEntry(KIO::UDSEntry(), true);
+}
+
+QString FileNameSearchProtocol::userName(uid_t uid)
+{
+    QHash<uid_t, QString>::const_iterator it = m_userNames.constFind(uid);
+    if (it != m_userNames.constEnd()) {
+        return it.value();
+    }
+
+    const KUser user(uid);
+    const QString name = user.isValid() ? user.loginName() : QString::number(uid);
+    m_userNames.insert(uid, name);
+    return name;
+}
+
+QString FileNameSearchProtocol::groupName(gid_t gid)
+{
+    QHash<gid_t, QString>::const_iterator it = m_groupNames.constFind(gid);
+    if (it != m_groupNames.constEnd()) {
+        return it.value();
+    }
+
+    const KUserGroup group(gid);
+    const QString name = group.isValid() ? group.name() : QString::number(gid);
+    m_groupNames.insert(gid, name);
+    return name;
+}
+
 bool FileNameSearchProtocol::contentContainsPattern(const KUrl& fileName) const
 {
     Q_ASSERT(m_regExp);
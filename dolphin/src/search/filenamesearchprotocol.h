@@ -22,6 +22,10 @@
 
 #include <kio/slavebase.h>
 
+#include <QHash>
+
+#include <sys/types.h>
+
 class KFileItem;
 class KUrl;
 class QRegExp;
@@ -44,6 +48,15 @@ public:
 private:
     void searchDirectory(const KUrl& directory);
 
+    /**
+     * Searches the local directory \a path with FileNameSearchWalker, which
+     * is a lot faster than iterating each directory with a KDirLister.
+     */
+    void searchLocalDirectory(const QString& path);
+
+    QString userName(uid_t uid);
+    QString groupName(gid_t gid);
+
     /**
      * @return True, if the pattern m_searchPattern is part of
      *         the file \a fileName.
@@ -55,6 +68,10 @@ private:
     bool m_checkContent;
     QRegExp* m_regExp;
     QSet<QString> m_iteratedDirs;
+
+    // Caches the names of users and groups for searchLocalDirectory()
+    QHash<uid_t, QString> m_userNames;
+    QHash<gid_t, QString> m_groupNames;
 };
 
 #endif
@@ -0,0 +1,412 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "filenamesearchwalker.h"
+
+#include <KMimeType>
+
+#include <QFile>
+#include <QThread>
+
+#include <dirent.h>
+#include <cctype>
+#include <cstring>
+
+namespace {
+    // Number of matches that may be pending before the workers get paused
+    const int MaximumPendingMatches = 4096;
+
+    // Number of matches a worker collects before passing them to takeMatches()
+    const int MatchesBatchSize = 64;
+
+    // Number of directory entries after which a worker checks whether the search has been canceled
+    const int CancelCheckInterval = 256;
+
+    // Number of directories that may be queued for all workers. Further directories
+    // are searched depth-first by the worker that found them.
+    const int MaximumPendingDirectories = 1024;
+
+    // Number of bytes of a file that are read at once when checking its content
+    const int ContentChunkSize = 64 * 1024;
+
+    /**
+     * @return True, if the \a size bytes at \a data contain the lower
+     *         case pattern \a pattern, compared case-insensitively.
+     */
+    bool containsLiteral(const char* data, int size, const QByteArray& pattern)
+    {
+        const int patternLength = pattern.length();
+        if (size < patternLength) {
+            return false;
+        }
+
+        const char first = pattern[0];
+        const char* end = data + size - patternLength;
+        for (const char* it = data; it <= end; ++it) {
+            if (std::tolower(static_cast<unsigned char>(*it)) != first) {
+                continue;
+            }
+
+            int i = 1;
+            while (i < patternLength && std::tolower(static_cast<unsigned char>(it[i])) == pattern[i]) {
+                ++i;
+            }
+            if (i == patternLength) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+class FileNameSearchWalker::Worker : public QThread
+{
+public:
+    Worker(FileNameSearchWalker* walker) :
+        QThread(),
+        m_walker(walker)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        m_walker->work();
+    }
+
+private:
+    FileNameSearchWalker* m_walker;
+};
+
+FileNameSearchWalker::FileNameSearchWalker(const QRegExp& regExp, bool checkContent) :
+    m_regExp(regExp),
+    m_checkContent(checkContent && !regExp.isEmpty()),
+    m_literalPattern(),
+    m_workers(),
+    m_mutex(),
+    m_directoriesAvailable(),
+    m_matchesAvailable(),
+    m_matchesTaken(),
+    m_pendingDirectories(),
+    m_activeWorkers(0),
+    m_canceled(false),
+    m_matches(),
+    m_visitedDirectories()
+{
+    const QString pattern = regExp.pattern();
+    bool isLiteral = regExp.patternSyntax() == QRegExp::Wildcard;
+    for (int i = 0; isLiteral && i < pattern.length(); ++i) {
+        const QChar c = pattern.at(i);
+        isLiteral = c.unicode() < 128 && c != QLatin1Char('*') && c != QLatin1Char('?') && c != QLatin1Char('[');
+    }
+    if (isLiteral) {
+        m_literalPattern = pattern.toLower().toLatin1();
+    }
+}
+
+FileNameSearchWalker::~FileNameSearchWalker()
+{
+    cancel();
+    foreach (Worker* worker, m_workers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+void FileNameSearchWalker::start(const QString& path)
+{
+    QByteArray directory = QFile::encodeName(path);
+    while (directory.length() > 1 && directory.endsWith('/')) {
+        directory.chop(1);
+    }
+
+    KDE_struct_stat buffer;
+    if (KDE_stat(directory.constData(), &buffer) == 0) {
+        markVisited(buffer.st_dev, buffer.st_ino);
+    }
+    m_pendingDirectories.enqueue(directory);
+
+    // Searching is mostly bound by the file system, so also use several
+    // threads on single core machines to keep the disk queue filled.
+    const int threadCount = qBound(2, QThread::idealThreadCount(), 8);
+    for (int i = 0; i < threadCount; ++i) {
+        Worker* worker = new Worker(this);
+        m_workers.append(worker);
+        worker->start();
+    }
+}
+
+void FileNameSearchWalker::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_canceled = true;
+    m_directoriesAvailable.wakeAll();
+    m_matchesAvailable.wakeAll();
+    m_matchesTaken.wakeAll();
+}
+
+QList<FileNameSearchWalker::Match> FileNameSearchWalker::takeMatches()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_matches.isEmpty() && !isFinished()) {
+        m_matchesAvailable.wait(&m_mutex);
+    }
+
+    QList<Match> matches;
+    if (!m_canceled) {
+        matches.swap(m_matches);
+    }
+    m_matchesTaken.wakeAll();
+    return matches;
+}
+
+void FileNameSearchWalker::work()
+{
+    // QRegExp is reentrant but not thread-safe, so each worker uses its own copy.
+    QRegExp regExp = m_regExp;
+
+    // Directories that this worker searches itself, as the queue was full.
+    // The worker counts as active as long as this list is not empty.
+    QList<QByteArray> directories;
+
+    m_mutex.lock();
+    while (!m_canceled) {
+        if (directories.isEmpty()) {
+            while (m_pendingDirectories.isEmpty() && m_activeWorkers > 0 && !m_canceled) {
+                m_directoriesAvailable.wait(&m_mutex);
+            }
+
+            if (m_canceled || m_pendingDirectories.isEmpty()) {
+                break;
+            }
+
+            directories.append(m_pendingDirectories.dequeue());
+            ++m_activeWorkers;
+        }
+
+        const QByteArray directory = directories.takeLast();
+        m_mutex.unlock();
+
+        searchDirectory(directory, regExp, directories);
+
+        m_mutex.lock();
+
+        // Pass the topmost directories to the other workers while the queue is not full
+        bool enqueued = false;
+        while (directories.count() > 1 && m_pendingDirectories.count() < MaximumPendingDirectories) {
+            m_pendingDirectories.enqueue(directories.takeFirst());
+            enqueued = true;
+        }
+        if (enqueued) {
+            m_directoriesAvailable.wakeAll();
+        }
+
+        if (directories.isEmpty()) {
+            --m_activeWorkers;
+        }
+    }
+
+    // Wake up all other workers and takeMatches(), as the search has been finished
+    m_directoriesAvailable.wakeAll();
+    m_matchesAvailable.wakeAll();
+    m_mutex.unlock();
+}
+
+void FileNameSearchWalker::searchDirectory(const QByteArray& path, QRegExp& regExp,
+                                           QList<QByteArray>& subDirectories)
+{
+    if (path == "/proc") {
+        // Don't try to iterate the /proc directory of Linux
+        return;
+    }
+
+    DIR* dir = ::opendir(path.constData());
+    if (!dir) {
+        return;
+    }
+
+    QList<Match> matches;
+
+    const QByteArray prefix = (path == "/") ? path : path + '/';
+    int entryCount = 0;
+    KDE_struct_dirent* entry = 0;
+    while ((entry = KDE_readdir(dir)) != 0) {
+        if (++entryCount % CancelCheckInterval == 0 && isCanceled()) {
+            break;
+        }
+
+        const char* name = entry->d_name;
+        if (name[0] == '.') {
+            // Skip "." and "..", and hidden items like the KDirLister does by default
+            continue;
+        }
+
+        const QByteArray itemPath = prefix + name;
+        const bool nameMatches = regExp.isEmpty() || QFile::decodeName(name).contains(regExp);
+
+        // Only get the file information if required, which is the case for
+        // matching items and for items that might be directories or text files.
+        bool needsStat = nameMatches || m_checkContent;
+#ifdef _DIRENT_HAVE_D_TYPE
+        needsStat = needsStat || entry->d_type == DT_DIR || entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN;
+#else
+        needsStat = true;
+#endif
+        if (!needsStat) {
+            continue;
+        }
+
+        Match match;
+        if (KDE_lstat(itemPath.constData(), &match.stat) != 0) {
+            continue;
+        }
+
+        if (S_ISLNK(match.stat.st_mode)) {
+            char linkDest[4096];
+            const ssize_t length = ::readlink(itemPath.constData(), linkDest, sizeof(linkDest) - 1);
+            if (length > 0) {
+                match.linkDest = QByteArray(linkDest, length);
+            }
+
+            // Use the information of the link target, if the link is not broken
+            KDE_struct_stat targetBuffer;
+            if (KDE_stat(itemPath.constData(), &targetBuffer) == 0) {
+                match.stat = targetBuffer;
+            }
+        }
+
+        const bool isDir = S_ISDIR(match.stat.st_mode);
+        bool addItem = nameMatches;
+        if (!addItem && m_checkContent && S_ISREG(match.stat.st_mode)) {
+            const KMimeType::Ptr mimeType = KMimeType::findByPath(QFile::decodeName(itemPath));
+            if (mimeType && mimeType->name().startsWith(QLatin1String("text/"))) {
+                addItem = contentContainsPattern(itemPath, regExp);
+            }
+        }
+
+        if (isDir && markVisited(match.stat.st_dev, match.stat.st_ino)) {
+            subDirectories.append(itemPath);
+        }
+
+        if (addItem) {
+            match.path = itemPath;
+            matches.append(match);
+            if (matches.count() >= MatchesBatchSize) {
+                addMatches(matches);
+            }
+        }
+    }
+    ::closedir(dir);
+
+    addMatches(matches);
+}
+
+void FileNameSearchWalker::addMatches(QList<Match>& matches)
+{
+    if (matches.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while (m_matches.count() >= MaximumPendingMatches && !m_canceled) {
+        m_matchesTaken.wait(&m_mutex);
+    }
+
+    m_matches.append(matches);
+    matches.clear();
+    m_matchesAvailable.wakeAll();
+}
+
+bool FileNameSearchWalker::markVisited(dev_t device, ino_t inode)
+{
+    const QPair<quint64, quint64> key(device, inode);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_visitedDirectories.contains(key)) {
+        return false;
+    }
+    m_visitedDirectories.insert(key);
+    return true;
+}
+
+bool FileNameSearchWalker::contentContainsPattern(const QByteArray& path, QRegExp& regExp) const
+{
+    // The file is read in chunks instead of being mapped, as a mapped file
+    // that gets truncated while being searched results in a SIGBUS.
+    QFile file(QFile::decodeName(path));
+    if (!file.open(QIODevice::ReadOnly) || file.size() <= 0) {
+        return false;
+    }
+
+    if (!m_literalPattern.isEmpty()) {
+        // Compare the bytes case-insensitively, without decoding the file. The
+        // end of each chunk is kept for matches that span two chunks.
+        const int overlap = m_literalPattern.length() - 1;
+        QByteArray buffer;
+        buffer.resize(ContentChunkSize + overlap);
+        int kept = 0;
+        while (true) {
+            const qint64 read = file.read(buffer.data() + kept, ContentChunkSize);
+            if (read <= 0) {
+                return false;
+            }
+
+            const int size = kept + read;
+            if (containsLiteral(buffer.constData(), size, m_literalPattern)) {
+                return true;
+            }
+
+            kept = qMin(size, overlap);
+            std::memmove(buffer.data(), buffer.constData() + size - kept, kept);
+        }
+    }
+
+    // The pattern contains wildcards: Check each line of the file
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.isEmpty()) {
+            // Reading failed
+            break;
+        }
+
+        if (line.endsWith('\n')) {
+            line.chop(1);
+        }
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+
+        if (QString::fromLocal8Bit(line.constData(), line.length()).contains(regExp)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool FileNameSearchWalker::isCanceled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_canceled;
+}
+
+bool FileNameSearchWalker::isFinished() const
+{
+    return m_canceled || (m_pendingDirectories.isEmpty() && m_activeWorkers == 0);
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef FILENAMESEARCHWALKER_H
+#define FILENAMESEARCHWALKER_H
+
+#include <kde_file.h>
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QQueue>
+#include <QRegExp>
+#include <QSet>
+#include <QWaitCondition>
+
+class QThread;
+
+/**
+ * @brief Searches a local directory tree with several threads.
+ *
+ * Used by FileNameSearchProtocol for local directories instead of
+ * iterating each directory with a KDirLister. The directories are
+ * read directly from the file system, and stat() is only invoked for
+ * directories and for items that match the search pattern.
+ *
+ * The matches are collected by the worker threads and must be fetched
+ * by the caller with takeMatches(). If the caller cannot keep up, the
+ * workers are paused until the matches have been fetched.
+ */
+class FileNameSearchWalker
+{
+public:
+    struct Match
+    {
+        QByteArray path;
+        QByteArray linkDest;
+        KDE_struct_stat stat;
+    };
+
+    /**
+     * @param regExp        Pattern that must be part of the name of a matching item.
+     *                      If the pattern is empty, all items match.
+     * @param checkContent  If true, also files with a text MIME type that contain the
+     *                      pattern are matching items.
+     */
+    FileNameSearchWalker(const QRegExp& regExp, bool checkContent);
+    ~FileNameSearchWalker();
+
+    /**
+     * Starts searching the local directory \a path.
+     */
+    void start(const QString& path);
+
+    /**
+     * Stops searching. Pending calls of takeMatches() return immediately.
+     */
+    void cancel();
+
+    /**
+     * Waits until at least one match is available and returns all
+     * available matches. An empty list is returned if the search
+     * has been finished or canceled.
+     */
+    QList<Match> takeMatches();
+
+private:
+    class Worker;
+
+    /**
+     * Is invoked by the worker threads and searches pending
+     * directories until the search has been finished.
+     */
+    void work();
+
+    /**
+     * Searches the directory \a path and appends its subdirectories
+     * that have not been visited yet to \a subDirectories.
+     */
+    void searchDirectory(const QByteArray& path, QRegExp& regExp,
+                         QList<QByteArray>& subDirectories);
+
+    /**
+     * Adds the matches \a matches and waits if too many matches have
+     * not been fetched by takeMatches() yet.
+     */
+    void addMatches(QList<Match>& matches);
+
+    /**
+     * @return True, if the directory with the device \a device and the inode
+     *         \a inode has not been visited yet. The directory is marked as visited.
+     */
+    bool markVisited(dev_t device, ino_t inode);
+
+    /**
+     * @return True, if the file \a path contains the pattern \a regExp.
+     */
+    bool contentContainsPattern(const QByteArray& path, QRegExp& regExp) const;
+
+    bool isFinished() const;
+    bool isCanceled() const;
+
+    QRegExp m_regExp;
+    bool m_checkContent;
+
+    // Lower case pattern used for a byte-level content search, if the
+    // pattern contains no wildcards.
+    QByteArray m_literalPattern;
+
+    QList<Worker*> m_workers;
+
+    // Protects all following members
+    mutable QMutex m_mutex;
+    QWaitCondition m_directoriesAvailable;
+    QWaitCondition m_matchesAvailable;
+    QWaitCondition m_matchesTaken;
+
+    QQueue<QByteArray> m_pendingDirectories;
+    int m_activeWorkers;
+    bool m_canceled;
+    QList<Match> m_matches;
+    QSet<QPair<quint64, quint64> > m_visitedDirectories;
+};
+
+#endif
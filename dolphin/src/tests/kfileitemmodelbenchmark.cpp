@@ -62,6 +62,8 @@ public:
 private slots:
     void insertAndRemoveManyItems_data();
     void insertAndRemoveManyItems();
+    void insertManyItemsWithNaturalSorting_data();
+    void insertManyItemsWithNaturalSorting();
     void insertManyChildItems();
 
 private:
@@ -119,6 +121,20 @@ void KFileItemModelBenchmark::insertAndRemoveManyItems_data()
         KItemRangeList itemRangeListSecondHalf;
         itemRangeListSecondHalf << KItemRange(firstHalf.count(), secondHalf.count());
 
+        // Insert 10 items into a large model, which happens e.g. if a few
+        // files are created in a directory that is being watched.
+        KFileItemList fewNew, allButFewNew;
+        KItemRangeList itemRangeListFewNewInserted;
+        const int fewNewDistance = n / 10;
+        for (int i = 0; i < n; ++i) {
+            if (i % fewNewDistance == fewNewDistance / 2) {
+                itemRangeListFewNewInserted << KItemRange(i - fewNew.count(), 1);
+                fewNew << all.at(i);
+            } else {
+                allButFewNew << all.at(i);
+            }
+        }
+
         KItemRangeList itemRangeListOddInserted, itemRangeListOddRemoved;
         for (int i = 0; i < odd.count(); ++i) {
             // Note that the index in the KItemRange is the index of
@@ -142,6 +158,9 @@ void KFileItemModelBenchmark::insertAndRemoveManyItems_data()
         snprintf(buffer, bufferSize, "even + odd--n=%i", n);
         QTest::newRow(buffer) << even << odd << KFileItemList() << all << itemRangeListOddInserted << KItemRangeList();
 
+        snprintf(buffer, bufferSize, "all but few + few--n=%i", n);
+        QTest::newRow(buffer) << allButFewNew << fewNew << KFileItemList() << all << itemRangeListFewNewInserted << KItemRangeList();
+
         snprintf(buffer, bufferSize, "all - 2nd half--n=%i", n);
         QTest::newRow(buffer) << all << KFileItemList() << secondHalf << firstHalf << KItemRangeList() << itemRangeListSecondHalf;
 
@@ -209,6 +228,70 @@ void KFileItemModelBenchmark::insertAndRemoveManyItems()
     }
 }
 
+void KFileItemModelBenchmark::insertManyItemsWithNaturalSorting_data()
+{
+    QTest::addColumn<KFileItemList>("items");
+    QTest::addColumn<KFileItemList>("expectedItems");
+
+    QList<int> sizes;
+    sizes << 1000 << 4000 << 16000 << 64000 << 256000;
+
+    foreach (int n, sizes) {
+        // Names like "File 12 - Part 3.txt" contain several numbers, which
+        // are compared by their value when natural sorting is enabled.
+        QStringList allStrings;
+        for (int i = 0; i < n; ++i) {
+            allStrings << QString("File %1 - Part %2.txt").arg(i / 10).arg(i % 10);
+        }
+
+        const KFileItemList expectedItems = createFileItemList(allStrings);
+
+        KFileItemList randomItems = expectedItems;
+        KRandomSequence randomSequence(0);
+        randomSequence.randomize(randomItems);
+
+        KFileItemList reversedItems;
+        for (int i = n - 1; i >= 0; --i) {
+            reversedItems << expectedItems.at(i);
+        }
+
+        const int bufferSize = 128;
+        char buffer[bufferSize];
+
+        snprintf(buffer, bufferSize, "natural, sorted--n=%i", n);
+        QTest::newRow(buffer) << expectedItems << expectedItems;
+
+        snprintf(buffer, bufferSize, "natural, reversed--n=%i", n);
+        QTest::newRow(buffer) << reversedItems << expectedItems;
+
+        snprintf(buffer, bufferSize, "natural, random--n=%i", n);
+        QTest::newRow(buffer) << randomItems << expectedItems;
+    }
+}
+
+void KFileItemModelBenchmark::insertManyItemsWithNaturalSorting()
+{
+    QFETCH(KFileItemList, items);
+    QFETCH(KFileItemList, expectedItems);
+
+    KFileItemModel model;
+    model.m_naturalSorting = true;
+    model.setRoles(QSet<QByteArray>() << "text");
+
+    QBENCHMARK {
+        model.slotClear();
+        model.slotItemsAdded(model.directory(), items);
+        model.slotCompleted();
+        QCOMPARE(model.count(), items.count());
+    }
+
+    QVERIFY(model.isConsistent());
+
+    for (int i = 0; i < model.count(); ++i) {
+        QCOMPARE(model.fileItem(i), expectedItems.at(i));
+    }
+}
+
 void KFileItemModelBenchmark::insertManyChildItems()
 {
     // TODO: this function needs to be adjusted to the changes in KFileItemModel
@@ -23,8 +23,12 @@
 #include <KDirLister>
 #include <kio/job.h>
 
+#include <cstring>
+#include <sys/stat.h>
+
 #include "kitemviews/kfileitemmodel.h"
 #include "kitemviews/private/kfileitemmodeldirlister.h"
+#include "kitemviews/private/kfileitemmodelsnapshot.h"
 #include "testdir.h"
 
 void myMessageOutput(QtMsgType type, const char* msg)
@@ -79,6 +83,9 @@ private slots:
     void testMakeExpandedItemHidden();
     void testRemoveFilteredExpandedItems();
     void testSorting();
+    void testSortByDirectorySize();
+    void testSortByRecursiveSize();
+    void testTextSortKey();
     void testIndexForKeyboardSearch();
     void testNameFilter();
     void testEmptyPath();
@@ -90,6 +97,7 @@ private slots:
     void testNameRoleGroups();
     void testNameRoleGroupsWithExpandedItems();
     void testInconsistentModel();
+    void testSnapshotReconciliation();
 
 private:
     QStringList itemsInModel() const;
@@ -924,6 +932,136 @@ void KFileItemModelTest::testSorting()
     // TODO: Sort by other roles; show/hide hidden files
 }
 
+void KFileItemModelTest::testSortByDirectorySize()
+{
+    m_model->setSortRole("size");
+
+    m_testDir->createDir("a");
+    m_testDir->createDir("b");
+    m_testDir->createDir("c");
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(itemsInserted(KItemRangeList)), DefaultTimeout));
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "b" << "c");
+
+    // Simulate that KFileItemModelRolesUpdater has counted the sub-items
+    // of "a" and "b". Directories with an unknown count are sorted first.
+    QHash<QByteArray, QVariant> size;
+    size.insert("size", 5);
+    m_model->setData(0, size);
+    size.insert("size", 2);
+    m_model->setData(1, size);
+
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(itemsMoved(KItemRange,QList<int>)), DefaultTimeout));
+    QCOMPARE(itemsInModel(), QStringList() << "c" << "b" << "a");
+    QVERIFY(m_model->isConsistent());
+
+    size.insert("size", 3);
+    m_model->setData(0, size);
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(itemsMoved(KItemRange,QList<int>)), DefaultTimeout));
+    QCOMPARE(itemsInModel(), QStringList() << "b" << "c" << "a");
+    QVERIFY(m_model->isConsistent());
+}
+
+void KFileItemModelTest::testSortByRecursiveSize()
+{
+    m_model->setSortRole("recursiveSize");
+
+    m_testDir->createDir("a");
+    m_testDir->createDir("b");
+    m_testDir->createDir("c");
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(itemsInserted(KItemRangeList)), DefaultTimeout));
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "b" << "c");
+
+    // Simulate that KFileItemModelRolesUpdater has calculated the total size
+    // of "a" and "b". Directories with an unknown size are sorted first.
+    QHash<QByteArray, QVariant> size;
+    size.insert("recursiveSize", KIO::filesize_t(5000000000LL));
+    m_model->setData(0, size);
+    size.insert("recursiveSize", KIO::filesize_t(2000));
+    m_model->setData(1, size);
+
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(itemsMoved(KItemRange,QList<int>)), DefaultTimeout));
+    QCOMPARE(itemsInModel(), QStringList() << "c" << "b" << "a");
+    QVERIFY(m_model->isConsistent());
+
+    // A partial size that exceeds the size of "a" moves "c" to the end
+    size.insert("recursiveSize", KIO::filesize_t(6000000000LL));
+    m_model->setData(0, size);
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(itemsMoved(KItemRange,QList<int>)), DefaultTimeout));
+    QCOMPARE(itemsInModel(), QStringList() << "b" << "a" << "c");
+    QVERIFY(m_model->isConsistent());
+}
+
+/**
+ * Verifies that comparing the pre-computed sort keys of texts gives the
+ * same order as KFileItemModel::stringCompare().
+ */
+void KFileItemModelTest::testTextSortKey()
+{
+    QStringList texts;
+    texts << QString() << "a" << "A" << "a0" << "a1" << "a01" << "a001" << "a2" << "a10" << "a010"
+          << "1" << "01" << "10" << "a." << "a.0" << "a.5" << "a._" << "a.b" << "a$1" << "_a" << ".hidden"
+          << "file.txt" << "File.txt" << "FILE.TXT" << "file 2.txt" << "file_2.txt" << "file-2.txt"
+          << "file10.txt" << "file 10.txt" << "x y" << "x  y" << "xy" << "x-y"
+          << QString::fromUtf8("über") << QString::fromUtf8("Über") << "uber" << QString::fromUtf8("été 2")
+          << QString::fromUtf8("\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e") << "zebra";
+
+    const bool naturalSorting = m_model->m_naturalSorting;
+    const Qt::CaseSensitivity caseSensitivity = m_model->m_caseSensitivity;
+
+    for (int natural = 0; natural <= 1; ++natural) {
+        for (int sensitive = 0; sensitive <= 1; ++sensitive) {
+            m_model->m_naturalSorting = (natural == 1);
+            m_model->m_caseSensitivity = (sensitive == 1) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+            QList<QByteArray> keys;
+            foreach (const QString& text, texts) {
+                keys.append(m_model->textSortKey(text));
+            }
+
+            for (int i = 0; i < texts.count(); ++i) {
+                for (int j = 0; j < texts.count(); ++j) {
+                    const QByteArray& keyA = keys.at(i);
+                    const QByteArray& keyB = keys.at(j);
+                    if (keyA.isEmpty() || keyB.isEmpty()) {
+                        // The texts are compared by stringCompare()
+                        continue;
+                    }
+
+                    int keyResult = memcmp(keyA.constData(), keyB.constData(), qMin(keyA.length(), keyB.length()));
+                    if (keyResult == 0) {
+                        keyResult = keyA.length() - keyB.length();
+                    }
+                    if (keyResult == 0) {
+                        // Equal keys fall back to stringCompare()
+                        continue;
+                    }
+
+                    const int result = m_model->stringCompare(texts.at(i), texts.at(j));
+                    QVERIFY2((keyResult < 0) == (result < 0) && result != 0,
+                             qPrintable(QString("%1 <=> %2, natural: %3, case sensitive: %4")
+                                        .arg(texts.at(i)).arg(texts.at(j)).arg(natural).arg(sensitive)));
+                }
+            }
+
+            // Usual names must get a key, otherwise the keys are useless
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+            QVERIFY(!m_model->textSortKey("file 10.txt").isEmpty());
+#else
+            if (natural == 0) {
+                QVERIFY(!m_model->textSortKey("file 10.txt").isEmpty());
+            }
+#endif
+        }
+    }
+
+    m_model->m_naturalSorting = naturalSorting;
+    m_model->m_caseSensitivity = caseSensitivity;
+}
+
 void KFileItemModelTest::testIndexForKeyboardSearch()
 {
     QStringList files;
@@ -998,6 +1136,15 @@ void KFileItemModelTest::testNameFilter()
     m_model->setNameFilter("bC"); // Shows "Abc" and "Bcd"
     QCOMPARE(m_model->count(), 2);
 
+    m_model->setNameFilter("bCd"); // Narrows the filter, shows only "Bcd"
+    QCOMPARE(m_model->count(), 1);
+
+    m_model->setNameFilter("c"); // Widens the filter, shows "Abc", "Bcd" and "Cde"
+    QCOMPARE(m_model->count(), 3);
+
+    m_model->setNameFilter("a*"); // Shows A1, A2 and Abc
+    QCOMPARE(m_model->count(), 3);
+
     m_model->setNameFilter(QString()); // Shows again all items
     QCOMPARE(m_model->count(), 5);
 }
@@ -1462,6 +1609,63 @@ void KFileItemModelTest::testInconsistentModel()
 
 }
 
+/**
+ * Verifies that the items from a snapshot are shown immediately and are
+ * reconciled with the actual listing: Items that have been added, removed
+ * or modified since the snapshot has been stored must be updated.
+ */
+void KFileItemModelTest::testSnapshotReconciliation()
+{
+    QStringList files;
+    for (int i = 0; i < KFileItemModelSnapshot::MinimumItemCount; ++i) {
+        files << QString("file%1.txt").arg(i, 4, 10, QChar('0'));
+    }
+    m_testDir->createFiles(files);
+
+    const KUrl directoryUrl = m_testDir->url();
+
+    // Store a snapshot where "file0000.txt" is missing, "file0001.txt" has
+    // a different size, and "removed.txt" does not exist on the disk.
+    KFileItemList snapshotItems;
+    for (int i = 2; i < files.count(); ++i) {
+        KUrl url = directoryUrl;
+        url.addPath(files.at(i));
+        snapshotItems.append(KFileItem(KFileItem::Unknown, KFileItem::Unknown, url));
+    }
+
+    KIO::UDSEntry modifiedEntry;
+    modifiedEntry.insert(KIO::UDSEntry::UDS_NAME, QString("file0001.txt"));
+    modifiedEntry.insert(KIO::UDSEntry::UDS_SIZE, 1000);
+    modifiedEntry.insert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFREG);
+    modifiedEntry.insert(KIO::UDSEntry::UDS_ACCESS, 0644);
+    snapshotItems.append(KFileItem(modifiedEntry, directoryUrl, true, true));
+
+    KIO::UDSEntry removedEntry(modifiedEntry);
+    removedEntry.insert(KIO::UDSEntry::UDS_NAME, QString("removed.txt"));
+    snapshotItems.append(KFileItem(removedEntry, directoryUrl, true, true));
+
+    QCOMPARE(snapshotItems.count(), KFileItemModelSnapshot::MinimumItemCount);
+    KFileItemModelSnapshot::save(directoryUrl, KFileItemModelSnapshot::NoOptions, snapshotItems).waitForFinished();
+
+    // The snapshot items are inserted before the dir lister provides any items.
+    m_model->loadDirectory(directoryUrl);
+    QCOMPARE(m_model->count(), snapshotItems.count());
+    QVERIFY(itemsInModel().contains("removed.txt"));
+    QVERIFY(!itemsInModel().contains("file0000.txt"));
+
+    KUrl modifiedUrl = directoryUrl;
+    modifiedUrl.addPath("file0001.txt");
+    QCOMPARE(m_model->fileItem(m_model->index(modifiedUrl)).size(), KIO::filesize_t(1000));
+
+    // After the loading has been completed, the model must match the actual listing.
+    QVERIFY(QTest::kWaitForSignal(m_model, SIGNAL(directoryLoadingCompleted()), DefaultTimeout));
+
+    QStringList listedItems = itemsInModel();
+    listedItems.sort();
+    QCOMPARE(listedItems, files);
+    QCOMPARE(m_model->fileItem(m_model->index(modifiedUrl)).size(), KIO::filesize_t(4));
+}
+
 QStringList KFileItemModelTest::itemsInModel() const
 {
     QStringList items;
@@ -0,0 +1,149 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include <qtest_kde.h>
+
+#include "kitemviews/private/kitemlistcolumnwidthtracker.h"
+
+class KItemListColumnWidthTrackerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void testMeasureItems();
+    void testInsertItems();
+    void testRemoveItems();
+    void testMoveItems();
+    void testChangeItems();
+    void testInvalidate();
+
+private:
+    void measureAll(qreal offset = 0);
+
+    KItemListColumnWidthTracker m_tracker;
+};
+
+void KItemListColumnWidthTrackerTest::init()
+{
+    m_tracker.itemsRemoved(KItemRangeList() << KItemRange(0, m_tracker.count()));
+    m_tracker.setRoles(QList<QByteArray>() << "text" << "size");
+
+    // Insert 10 items, the width of the item with the index i is i
+    m_tracker.itemsInserted(KItemRangeList() << KItemRange(0, 10));
+    measureAll();
+}
+
+/**
+ * Sets the width of each unmeasured item to its index plus \a offset for the
+ * role "text" and to the double of this for the role "size".
+ */
+void KItemListColumnWidthTrackerTest::measureAll(qreal offset)
+{
+    int index = m_tracker.nextUnmeasuredIndex();
+    while (index >= 0) {
+        m_tracker.setWidths(index, QVector<qreal>() << index + offset << 2 * (index + offset));
+        index = m_tracker.nextUnmeasuredIndex();
+    }
+}
+
+void KItemListColumnWidthTrackerTest::testMeasureItems()
+{
+    QCOMPARE(m_tracker.count(), 10);
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), -1);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(9));
+    QCOMPARE(m_tracker.maximumWidth("size"), qreal(18));
+    QCOMPARE(m_tracker.maximumWidth("date"), qreal(0));
+}
+
+void KItemListColumnWidthTrackerTest::testInsertItems()
+{
+    m_tracker.itemsInserted(KItemRangeList() << KItemRange(2, 1) << KItemRange(5, 2));
+    QCOMPARE(m_tracker.count(), 13);
+
+    // The inserted items are at the indexes 2, 6 and 7 now
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), 2);
+    m_tracker.setWidths(2, QVector<qreal>() << 100 << 1);
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), 6);
+    m_tracker.setWidths(6, QVector<qreal>() << 1 << 1);
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), 7);
+    m_tracker.setWidths(7, QVector<qreal>() << 1 << 1);
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), -1);
+
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(100));
+    QCOMPARE(m_tracker.maximumWidth("size"), qreal(18));
+}
+
+void KItemListColumnWidthTrackerTest::testRemoveItems()
+{
+    m_tracker.itemsRemoved(KItemRangeList() << KItemRange(1, 2) << KItemRange(9, 1));
+    QCOMPARE(m_tracker.count(), 7);
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), -1);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(8));
+    QCOMPARE(m_tracker.maximumWidth("size"), qreal(16));
+
+    m_tracker.itemsRemoved(KItemRangeList() << KItemRange(0, 7));
+    QCOMPARE(m_tracker.count(), 0);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(0));
+}
+
+void KItemListColumnWidthTrackerTest::testMoveItems()
+{
+    // Swap the items 8 and 9 and remove the item 9 afterwards,
+    // which had the index 8 before.
+    m_tracker.itemsMoved(KItemRange(8, 2), QList<int>() << 9 << 8);
+    m_tracker.itemsRemoved(KItemRangeList() << KItemRange(9, 1));
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(9));
+
+    m_tracker.itemsRemoved(KItemRangeList() << KItemRange(8, 1));
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(7));
+}
+
+void KItemListColumnWidthTrackerTest::testChangeItems()
+{
+    m_tracker.itemsChanged(KItemRangeList() << KItemRange(8, 2));
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(7));
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), 8);
+
+    // Decreasing the widths must decrease the maximum width
+    m_tracker.setWidths(8, QVector<qreal>() << 1 << 1);
+    m_tracker.setWidths(9, QVector<qreal>() << 1 << 1);
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), -1);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(7));
+    QCOMPARE(m_tracker.maximumWidth("size"), qreal(14));
+}
+
+void KItemListColumnWidthTrackerTest::testInvalidate()
+{
+    m_tracker.invalidate();
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), 0);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(0));
+
+    measureAll(5);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(14));
+
+    m_tracker.setRoles(QList<QByteArray>() << "date");
+    QCOMPARE(m_tracker.nextUnmeasuredIndex(), 0);
+    QCOMPARE(m_tracker.maximumWidth("text"), qreal(0));
+}
+
+QTEST_KDEMAIN(KItemListColumnWidthTrackerTest, NoGUI)
+
+#include "kitemlistcolumnwidthtrackertest.moc"
@@ -0,0 +1,156 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include <qtest_kde.h>
+
+#include "kitemviews/kitemmodelbase.h"
+#include "kitemviews/kitemlistselectionmanager.h"
+
+namespace {
+    const int ItemCount = 1000000;
+}
+
+class DummyModel : public KItemModelBase
+{
+public:
+    DummyModel();
+    virtual int count() const;
+    virtual QHash<QByteArray, QVariant> data(int index) const;
+};
+
+DummyModel::DummyModel() :
+    KItemModelBase()
+{
+}
+
+int DummyModel::count() const
+{
+    return ItemCount;
+}
+
+QHash<QByteArray, QVariant> DummyModel::data(int index) const
+{
+    Q_UNUSED(index);
+    return QHash<QByteArray, QVariant>();
+}
+
+class KItemListSelectionManagerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void selectAll();
+    void isSelected();
+    void toggleEveryOtherItem();
+    void insertItemsIntoLargeSelection();
+    void removeItemsFromLargeSelection();
+
+private:
+    KItemListSelectionManager* m_selectionManager;
+    DummyModel* m_model;
+};
+
+void KItemListSelectionManagerBenchmark::init()
+{
+    m_model = new DummyModel();
+    m_selectionManager = new KItemListSelectionManager();
+    m_selectionManager->setModel(m_model);
+}
+
+void KItemListSelectionManagerBenchmark::cleanup()
+{
+    delete m_selectionManager;
+    m_selectionManager = 0;
+
+    delete m_model;
+    m_model = 0;
+}
+
+void KItemListSelectionManagerBenchmark::selectAll()
+{
+    QBENCHMARK {
+        m_selectionManager->setSelected(0, ItemCount);
+        m_selectionManager->clearSelection();
+    }
+}
+
+void KItemListSelectionManagerBenchmark::isSelected()
+{
+    // Select every 10th item to get a large number of ranges
+    for (int i = 0; i < ItemCount; i += 10) {
+        m_selectionManager->setSelected(i);
+    }
+
+    int selectedCount = 0;
+    QBENCHMARK {
+        selectedCount = 0;
+        for (int i = 0; i < ItemCount; ++i) {
+            if (m_selectionManager->isSelected(i)) {
+                ++selectedCount;
+            }
+        }
+    }
+    QCOMPARE(selectedCount, ItemCount / 10);
+}
+
+void KItemListSelectionManagerBenchmark::toggleEveryOtherItem()
+{
+    m_selectionManager->setSelected(0, ItemCount);
+
+    QBENCHMARK {
+        for (int i = 0; i < 10000; i += 2) {
+            m_selectionManager->setSelected(i, 1, KItemListSelectionManager::Toggle);
+        }
+    }
+}
+
+void KItemListSelectionManagerBenchmark::insertItemsIntoLargeSelection()
+{
+    KItemRangeList itemRanges;
+    for (int i = 0; i < ItemCount; i += 1000) {
+        itemRanges << KItemRange(i, 1);
+    }
+
+    QBENCHMARK {
+        m_selectionManager->setSelected(0, ItemCount);
+        m_selectionManager->itemsInserted(itemRanges);
+        m_selectionManager->clearSelection();
+    }
+}
+
+void KItemListSelectionManagerBenchmark::removeItemsFromLargeSelection()
+{
+    KItemRangeList itemRanges;
+    for (int i = 0; i < ItemCount; i += 1000) {
+        itemRanges << KItemRange(i, 1);
+    }
+
+    QBENCHMARK {
+        m_selectionManager->setSelected(0, ItemCount);
+        m_selectionManager->itemsRemoved(itemRanges);
+        m_selectionManager->clearSelection();
+    }
+}
+
+QTEST_KDEMAIN(KItemListSelectionManagerBenchmark, NoGUI)
+
+#include "kitemlistselectionmanagerbenchmark.moc"
@@ -0,0 +1,227 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include <qtest_kde.h>
+
+#include "kitemviews/kitemset.h"
+
+#include <QSet>
+
+namespace {
+    QList<int> toList(const KItemSet& set)
+    {
+        QList<int> list;
+        foreach (int index, set) {
+            list.append(index);
+        }
+        return list;
+    }
+
+    KItemSet fromSet(const QSet<int>& set)
+    {
+        KItemSet result;
+        foreach (int index, set) {
+            result.insert(index);
+        }
+        return result;
+    }
+
+    QList<int> sorted(const QSet<int>& set)
+    {
+        QList<int> list = set.toList();
+        qSort(list);
+        return list;
+    }
+}
+
+class KItemSetTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testInsert();
+    void testRemove();
+    void testOperators();
+    void testItemsInserted();
+    void testItemsRemoved();
+    void testItemsMoved();
+    void testRandomOperations();
+};
+
+void KItemSetTest::testInsert()
+{
+    KItemSet set;
+    QVERIFY(set.isEmpty());
+    QCOMPARE(set.count(), 0);
+
+    set << 5 << 7 << 6;
+    QCOMPARE(set.ranges(), KItemRangeList() << KItemRange(5, 3));
+
+    set.insert(KItemRange(10, 5));
+    QCOMPARE(set.ranges(), KItemRangeList() << KItemRange(5, 3) << KItemRange(10, 5));
+
+    // Fill the gap between both ranges
+    set.insert(KItemRange(7, 4));
+    QCOMPARE(set.ranges(), KItemRangeList() << KItemRange(5, 10));
+    QCOMPARE(set.count(), 10);
+    QCOMPARE(set.first(), 5);
+    QCOMPARE(set.last(), 14);
+
+    QVERIFY(!set.contains(4));
+    QVERIFY(set.contains(5));
+    QVERIFY(set.contains(14));
+    QVERIFY(!set.contains(15));
+}
+
+void KItemSetTest::testRemove()
+{
+    KItemSet set(KItemRange(0, 10));
+
+    set.remove(5);
+    QCOMPARE(set.ranges(), KItemRangeList() << KItemRange(0, 5) << KItemRange(6, 4));
+
+    set.remove(KItemRange(3, 5));
+    QCOMPARE(set.ranges(), KItemRangeList() << KItemRange(0, 3) << KItemRange(8, 2));
+    QCOMPARE(toList(set), QList<int>() << 0 << 1 << 2 << 8 << 9);
+
+    set.remove(42);
+    QCOMPARE(set.count(), 5);
+
+    set.clear();
+    QVERIFY(set.isEmpty());
+}
+
+void KItemSetTest::testOperators()
+{
+    const KItemSet a = KItemSet() << 1 << 2 << 3 << 7 << 8;
+    const KItemSet b = KItemSet() << 3 << 4 << 8 << 9;
+
+    QCOMPARE(toList(a + b), QList<int>() << 1 << 2 << 3 << 4 << 7 << 8 << 9);
+    QCOMPARE(toList(a - b), QList<int>() << 1 << 2 << 7);
+    QCOMPARE(toList(a ^ b), QList<int>() << 1 << 2 << 4 << 7 << 9);
+
+    QCOMPARE(a + KItemSet(), a);
+    QCOMPARE(a - a, KItemSet());
+    QCOMPARE(a ^ a, KItemSet());
+    QVERIFY(a != b);
+}
+
+void KItemSetTest::testItemsInserted()
+{
+    KItemSet set = KItemSet() << 2 << 3 << 4 << 8;
+
+    // Inserting items inside a range splits the range
+    set.itemsInserted(KItemRangeList() << KItemRange(0, 1) << KItemRange(3, 2) << KItemRange(8, 1));
+    QCOMPARE(toList(set), QList<int>() << 3 << 6 << 7 << 12);
+}
+
+void KItemSetTest::testItemsRemoved()
+{
+    KItemSet set = KItemSet() << 0 << 1 << 2 << 3 << 4 << 8 << 9;
+
+    // The ranges before and after the removed items get merged
+    set.itemsRemoved(KItemRangeList() << KItemRange(1, 1) << KItemRange(5, 3));
+    QCOMPARE(toList(set), QList<int>() << 0 << 1 << 2 << 3 << 4 << 5);
+    QCOMPARE(set.ranges().count(), 1);
+}
+
+void KItemSetTest::testItemsMoved()
+{
+    KItemSet set = KItemSet() << 1 << 2 << 5;
+
+    // Move the items 1, 2 and 3 to 3, 1 and 2
+    set.itemsMoved(KItemRange(1, 3), QList<int>() << 3 << 1 << 2);
+    QCOMPARE(toList(set), QList<int>() << 1 << 3 << 5);
+}
+
+void KItemSetTest::testRandomOperations()
+{
+    qsrand(42);
+
+    QSet<int> reference;
+    KItemSet set;
+    for (int i = 0; i < 2000; ++i) {
+        const int index = qrand() % 200;
+        const int count = qrand() % 10 + 1;
+
+        switch (qrand() % 6) {
+        case 0:
+            for (int j = index; j < index + count; ++j) {
+                reference.insert(j);
+            }
+            set.insert(KItemRange(index, count));
+            break;
+
+        case 1:
+            for (int j = index; j < index + count; ++j) {
+                reference.remove(j);
+            }
+            set.remove(KItemRange(index, count));
+            break;
+
+        case 2: {
+            QSet<int> other;
+            for (int j = index; j < index + count; ++j) {
+                other.insert(j * 2);
+            }
+            QSet<int> intersection = reference;
+            intersection.intersect(other);
+            reference.unite(other).subtract(intersection);
+            set = set ^ fromSet(other);
+            break;
+        }
+
+        case 3: {
+            QSet<int> shifted;
+            foreach (int j, reference) {
+                shifted.insert(j < index ? j : j + count);
+            }
+            reference = shifted;
+            set.itemsInserted(KItemRangeList() << KItemRange(index, count));
+            break;
+        }
+
+        case 4: {
+            QSet<int> shifted;
+            foreach (int j, reference) {
+                if (j < index) {
+                    shifted.insert(j);
+                } else if (j >= index + count) {
+                    shifted.insert(j - count);
+                }
+            }
+            reference = shifted;
+            set.itemsRemoved(KItemRangeList() << KItemRange(index, count));
+            break;
+        }
+
+        default:
+            QCOMPARE(set.contains(index), reference.contains(index));
+            break;
+        }
+
+        QCOMPARE(toList(set), sorted(reference));
+        QCOMPARE(set.count(), reference.count());
+        QCOMPARE(set, fromSet(reference));
+    }
+}
+
+QTEST_KDEMAIN(KItemSetTest, NoGUI)
+
+#include "kitemsettest.moc"
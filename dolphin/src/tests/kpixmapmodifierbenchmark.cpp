@@ -0,0 +1,133 @@
+/***************************************************************************
+ *   Copyright (C) 2014 by the Dolphin developers                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include <qtest_kde.h>
+
+#include "kitemviews/private/kpixmapmodifier.h"
+#include "kitemviews/private/kpreviewprocessor.h"
+
+#include <QImage>
+#include <QPainter>
+
+namespace {
+    QImage createPreview(const QSize& size)
+    {
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        QLinearGradient gradient(0, 0, size.width(), size.height());
+        gradient.setColorAt(0, Qt::red);
+        gradient.setColorAt(1, Qt::blue);
+        painter.fillRect(image.rect(), gradient);
+        return image;
+    }
+}
+
+class KPixmapModifierBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void blur_data();
+    void blur();
+    void applyFrame_data();
+    void applyFrame();
+    void processPreview_data();
+    void processPreview();
+};
+
+void KPixmapModifierBenchmark::blur_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("radius");
+
+    // The tile set of the frame is blurred with the radius 3
+    QTest::newRow("Tile set") << QSize(24, 24) << 3;
+    QTest::newRow("256x256, radius 3") << QSize(256, 256) << 3;
+    QTest::newRow("256x256, radius 10") << QSize(256, 256) << 10;
+    QTest::newRow("1024x768, radius 3") << QSize(1024, 768) << 3;
+}
+
+void KPixmapModifierBenchmark::blur()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, radius);
+
+    const QImage image = createPreview(size);
+
+    QBENCHMARK {
+        QImage blurredImage = image;
+        KPixmapModifier::blur(blurredImage, radius);
+    }
+}
+
+void KPixmapModifierBenchmark::applyFrame_data()
+{
+    QTest::addColumn<QSize>("previewSize");
+    QTest::addColumn<QSize>("iconSize");
+
+    QTest::newRow("128x128 preview, 128 px icons") << QSize(128, 128) << QSize(128, 128);
+    QTest::newRow("256x192 preview, 128 px icons") << QSize(256, 192) << QSize(128, 128);
+    QTest::newRow("256x192 preview, 256 px icons") << QSize(256, 192) << QSize(256, 256);
+    QTest::newRow("256x192 preview, 48 px icons") << QSize(256, 192) << QSize(48, 48);
+}
+
+void KPixmapModifierBenchmark::applyFrame()
+{
+    QFETCH(QSize, previewSize);
+    QFETCH(QSize, iconSize);
+
+    const QImage preview = createPreview(previewSize);
+
+    QBENCHMARK {
+        QImage framedPreview = preview;
+        KPixmapModifier::applyFrame(framedPreview, iconSize);
+    }
+}
+
+void KPixmapModifierBenchmark::processPreview_data()
+{
+    QTest::addColumn<QSize>("previewSize");
+    QTest::addColumn<QSize>("iconSize");
+    QTest::addColumn<bool>("applyFrame");
+    QTest::addColumn<bool>("enlargeSmallPreviews");
+
+    QTest::newRow("Framed, 256 px icons") << QSize(256, 192) << QSize(256, 256) << true << true;
+    QTest::newRow("Framed small preview, not enlarged") << QSize(64, 48) << QSize(256, 256) << true << false;
+    QTest::newRow("Not framed, 256 px icons") << QSize(256, 192) << QSize(256, 256) << false << true;
+    QTest::newRow("Not framed, 64 px icons") << QSize(256, 192) << QSize(64, 64) << false << true;
+}
+
+void KPixmapModifierBenchmark::processPreview()
+{
+    QFETCH(QSize, previewSize);
+    QFETCH(QSize, iconSize);
+    QFETCH(bool, applyFrame);
+    QFETCH(bool, enlargeSmallPreviews);
+
+    const QImage preview = createPreview(previewSize);
+
+    QBENCHMARK {
+        QImage processedPreview = preview;
+        KPreviewProcessor::processPreview(processedPreview, iconSize, applyFrame, enlargeSmallPreviews);
+    }
+}
+
+QTEST_KDEMAIN(KPixmapModifierBenchmark, GUI)
+
+#include "kpixmapmodifierbenchmark.moc"
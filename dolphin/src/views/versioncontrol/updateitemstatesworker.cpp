@@ -17,80 +17,59 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
  ***************************************************************************/
 
-#include "updateitemstatesthread.h"
+
+#include "updateitemstatesworker.h"
 
 #include <kversioncontrolplugin2.h>
 
+#include <QMutex>
 #include <QMutexLocker>
 
-UpdateItemStatesThread::UpdateItemStatesThread(KVersionControlPlugin* plugin,
-                                               const QMap<QString, QVector<VersionControlObserver::ItemState> >& itemStates) :
-    QThread(),
-    m_globalPluginMutex(0),
-    m_plugin(plugin),
-    m_retrievedItems(false),
-    m_itemStates(itemStates)
+UpdateItemStatesWorker::UpdateItemStatesWorker(QObject* parent) :
+    QObject(parent)
 {
-    // Several threads may share one instance of a plugin. A global
-    // mutex is required to serialize the retrieval of version control
-    // states inside run().
-    static QMutex globalMutex;
-    m_globalPluginMutex = &globalMutex;
+    qRegisterMetaType<KVersionControlPlugin*>();
+    qRegisterMetaType<VersionControlObserver::ItemStates>();
 }
 
-UpdateItemStatesThread::~UpdateItemStatesThread()
+void UpdateItemStatesWorker::updateItemStates(KVersionControlPlugin* plugin,
+                                              const VersionControlObserver::ItemStates& itemStates)
 {
-}
+    Q_ASSERT(!itemStates.isEmpty());
+    Q_ASSERT(plugin);
 
-void UpdateItemStatesThread::run()
-{
-    Q_ASSERT(!m_itemStates.isEmpty());
-    Q_ASSERT(m_plugin);
+    // Several views may share one instance of a plugin, each of them
+    // using its own worker. A global mutex is required to serialize the
+    // retrieval of version control states.
+    static QMutex globalPluginMutex;
+    QMutexLocker pluginLocker(&globalPluginMutex);
 
-    m_retrievedItems = false;
+    VersionControlObserver::ItemStates updatedItemStates = itemStates;
+    bool retrievedItems = false;
 
-    QMutexLocker pluginLocker(m_globalPluginMutex);
-    foreach (const QString& directory, m_itemStates.keys()) {
-        if (m_plugin->beginRetrieval(directory)) {
-            QVector<VersionControlObserver::ItemState>& items = m_itemStates[directory];
+    KVersionControlPlugin2* pluginV2 = qobject_cast<KVersionControlPlugin2*>(plugin);
+    foreach (const QString& directory, updatedItemStates.keys()) {
+        if (plugin->beginRetrieval(directory)) {
+            QVector<VersionControlObserver::ItemState>& items = updatedItemStates[directory];
             const int count = items.count();
 
-            KVersionControlPlugin2* pluginV2 = qobject_cast<KVersionControlPlugin2*>(m_plugin);
             if (pluginV2) {
                 for (int i = 0; i < count; ++i) {
                     items[i].version = pluginV2->itemVersion(items[i].item);
                 }
             } else {
                 for (int i = 0; i < count; ++i) {
-                    const KVersionControlPlugin::VersionState state = m_plugin->versionState(items[i].item);
+                    const KVersionControlPlugin::VersionState state = plugin->versionState(items[i].item);
                     items[i].version = static_cast<KVersionControlPlugin2::ItemVersion>(state);
                 }
             }
 
-            m_plugin->endRetrieval();
-            m_retrievedItems = true;
+            plugin->endRetrieval();
+            retrievedItems = true;
         }
     }
-}
-
-bool UpdateItemStatesThread::lockPlugin()
-{
-    return m_globalPluginMutex->tryLock(300);
-}
 
-void UpdateItemStatesThread::unlockPlugin()
-{
-    m_globalPluginMutex->unlock();
-}
-
-QMap<QString, QVector<VersionControlObserver::ItemState> > UpdateItemStatesThread::itemStates() const
-{
-    return m_itemStates;
-}
-
-bool UpdateItemStatesThread::retrievedItems() const
-{
-    return m_retrievedItems;
+    emit itemStatesUpdated(updatedItemStates, retrievedItems);
 }
 
-#include "updateitemstatesthread.moc"
+#include "updateitemstatesworker.moc"
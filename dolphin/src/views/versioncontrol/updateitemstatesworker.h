@@ -17,65 +17,50 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
  ***************************************************************************/
 
-#ifndef UPDATEITEMSTATESTHREAD_H
-#define UPDATEITEMSTATESTHREAD_H
+
+#ifndef UPDATEITEMSTATESWORKER_H
+#define UPDATEITEMSTATESWORKER_H
 
 #include <libdolphin_export.h>
 #include <views/versioncontrol/versioncontrolobserver.h>
 
-#include <QMutex>
-#include <QThread>
+#include <QMetaType>
+#include <QObject>
 
 class KVersionControlPlugin;
 
 /**
  * The performance of updating the version state of items depends
  * on the used plugin. To prevent that Dolphin gets blocked by a
- * slow plugin, the updating is delegated to a thread.
+ * slow plugin, the updating is delegated to a worker that lives
+ * in a separate thread during the whole lifetime of the
+ * VersionControlObserver.
  */
-class LIBDOLPHINPRIVATE_EXPORT UpdateItemStatesThread : public QThread
+class LIBDOLPHINPRIVATE_EXPORT UpdateItemStatesWorker : public QObject
 {
     Q_OBJECT
 
 public:
-    /**
-     * @param plugin     Version control plugin that is used to update the
-     *                   state of the items. Whenever the plugin is accessed
-     *                   from the thread creator after starting the thread,
-     *                   UpdateItemStatesThread::lockPlugin() and
-     *                   UpdateItemStatesThread::unlockPlugin() must be used.
-     * @param itemStates List of items, where the states get updated.
-     */
-    UpdateItemStatesThread(KVersionControlPlugin* plugin,
-                           const QMap<QString, QVector<VersionControlObserver::ItemState> >& itemStates);
-    virtual ~UpdateItemStatesThread();
+    explicit UpdateItemStatesWorker(QObject* parent = 0);
 
+signals:
     /**
-     * Whenever the plugin is accessed by the thread creator, lockPlugin() must
-     * be invoked. True is returned, if the plugin could be locked within 300
-     * milliseconds.
+     * Signals that the versions of the items of \a itemStates have been
+     * updated. \a retrievedItems is false if the plugin could not retrieve
+     * the versions of any directory.
      */
-    bool lockPlugin();
+    void itemStatesUpdated(const VersionControlObserver::ItemStates& itemStates, bool retrievedItems);
 
+public slots:
     /**
-     * Must be invoked if lockPlugin() returned true and plugin has been accessed
-     * by the thread creator.
+     * Updates the versions of the items of \a itemStates by using \a plugin.
+     * The result is announced via the signal \a itemStatesUpdated.
      */
-    void unlockPlugin();
-
-    QMap<QString, QVector<VersionControlObserver::ItemState> > itemStates() const;
-
-    bool retrievedItems() const;
-
-protected:
-    virtual void run();
-
-private:
-    QMutex* m_globalPluginMutex; // Protects the m_plugin globally
-    KVersionControlPlugin* m_plugin;
-
-    bool m_retrievedItems;
-    QMap<QString, QVector<VersionControlObserver::ItemState> > m_itemStates;
+    void updateItemStates(KVersionControlPlugin* plugin,
+                          const VersionControlObserver::ItemStates& itemStates);
 };
 
-#endif // UPDATEITEMSTATESTHREAD_H
+Q_DECLARE_METATYPE(KVersionControlPlugin*)
+Q_DECLARE_METATYPE(VersionControlObserver::ItemStates)
+
+#endif // UPDATEITEMSTATESWORKER_H
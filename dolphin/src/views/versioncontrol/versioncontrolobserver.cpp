@@ -27,12 +27,22 @@
 #include <kitemviews/kfileitemmodel.h>
 #include <kversioncontrolplugin2.h>
 
-#include "updateitemstatesthread.h"
+#include "updateitemstatesworker.h"
 
 #include <QFile>
-#include <QMutexLocker>
+#include <QThread>
 #include <QTimer>
 
+namespace {
+    // Maximum number of item versions kept by the cache
+    const int MaximumCachedVersions = 100000;
+
+    // Time in ms after which a cached version is not used anymore. Versions
+    // might change without modifying the file, e.g. if a file is committed
+    // with a tool that does not notify the plugin.
+    const qint64 CachedVersionTimeout = 60000;
+}
+
 VersionControlObserver::VersionControlObserver(QObject* parent) :
     QObject(parent),
     m_pendingItemStatesUpdate(false),
@@ -41,8 +51,17 @@ VersionControlObserver::VersionControlObserver(QObject* parent) :
     m_model(0),
     m_dirVerificationTimer(0),
     m_plugin(0),
-    m_updateItemStatesThread(0)
+    m_updateItemStatesThread(0),
+    m_updateItemStatesWorker(0),
+    m_updatingItemStates(false),
+    m_updateAllItems(true),
+    m_changedItems(),
+    m_versionCache(MaximumCachedVersions),
+    m_versionCacheClock(),
+    m_versionCacheCleared(false)
 {
+    m_versionCacheClock.start();
+
     // The verification timer specifies the timeout until the shown directory
     // is checked whether it is versioned. Per default it is assumed that users
     // don't iterate through versioned directories and a high timeout is used
@@ -61,24 +80,33 @@ VersionControlObserver::~VersionControlObserver()
         m_plugin->disconnect(this);
         m_plugin = 0;
     }
+
+    if (m_updateItemStatesThread) {
+        // Don't wait until a slow plugin has finished the current update.
+        // The thread and the worker delete themselves when the update is done.
+        m_updateItemStatesWorker->disconnect(this);
+        m_updateItemStatesThread->quit();
+    }
 }
 
 void VersionControlObserver::setModel(KFileItemModel* model)
 {
     if (m_model) {
         disconnect(m_model, SIGNAL(itemsInserted(KItemRangeList)),
-                   this, SLOT(delayedDirectoryVerification()));
+                   this, SLOT(slotItemsInserted(KItemRangeList)));
         disconnect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
-                   this, SLOT(delayedDirectoryVerification()));
+                   this, SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
     }
 
     m_model = model;
+    m_updateAllItems = true;
+    m_changedItems.clear();
 
     if (model) {
         connect(m_model, SIGNAL(itemsInserted(KItemRangeList)),
-                this, SLOT(delayedDirectoryVerification()));
+                this, SLOT(slotItemsInserted(KItemRangeList)));
         connect(m_model, SIGNAL(itemsChanged(KItemRangeList,QSet<QByteArray>)),
-                this, SLOT(delayedDirectoryVerification()));
+                this, SLOT(slotItemsChanged(KItemRangeList,QSet<QByteArray>)));
     }
 }
 
@@ -135,6 +163,12 @@ void VersionControlObserver::delayedDirectoryVerification()
 
 void VersionControlObserver::silentDirectoryVerification()
 {
+    // The plugin reports that versions have changed, which
+    // might affect any item.
+    m_updateAllItems = true;
+    m_changedItems.clear();
+    clearVersionCache();
+
     m_silentUpdate = true;
     m_dirVerificationTimer->start();
 }
@@ -147,6 +181,8 @@ void VersionControlObserver::verifyDirectory()
 
     const KFileItem rootItem = m_model->rootItem();
     if (rootItem.isNull() || !rootItem.url().isLocalFile()) {
+        m_updateAllItems = true;
+        m_changedItems.clear();
         return;
     }
 
@@ -154,7 +190,17 @@ void VersionControlObserver::verifyDirectory()
         m_plugin->disconnect(this);
     }
 
+    KVersionControlPlugin* previousPlugin = m_plugin;
     m_plugin = searchPlugin(rootItem.url());
+    if (m_plugin != previousPlugin) {
+        clearVersionCache();
+    }
+    if (!m_plugin || m_plugin != previousPlugin) {
+        // Update all items as soon as a plugin is available for the directory
+        m_updateAllItems = true;
+        m_changedItems.clear();
+    }
+
     if (m_plugin) {
         KVersionControlPlugin2* pluginV2 = qobject_cast<KVersionControlPlugin2*>(m_plugin);
         if (pluginV2) {
@@ -189,31 +235,95 @@ void VersionControlObserver::verifyDirectory()
     }
 }
 
-void VersionControlObserver::slotThreadFinished()
+void VersionControlObserver::slotItemsInserted(const KItemRangeList& itemRanges)
+{
+    if (!m_updateAllItems) {
+        if (itemRanges.count() == 1 && itemRanges.first().count == m_model->count()) {
+            // A directory has been loaded
+            m_updateAllItems = true;
+            m_changedItems.clear();
+        } else {
+            foreach (const KItemRange& range, itemRanges) {
+                for (int index = range.index; index < range.index + range.count; ++index) {
+                    m_changedItems.append(m_model->fileItem(index));
+                }
+            }
+        }
+    }
+
+    delayedDirectoryVerification();
+}
+
+void VersionControlObserver::slotItemsChanged(const KItemRangeList& itemRanges, const QSet<QByteArray>& roles)
+{
+    // Roles that are changed by KFileItemModel::slotRefreshItems() if a file
+    // has been modified or renamed. The "size" role is not part of it, as it
+    // also gets changed when counting the items of folders.
+    static QSet<QByteArray> fileRoles;
+    if (fileRoles.isEmpty()) {
+        fileRoles << "text" << "url" << "date" << "permissions";
+    }
+
+    bool isFileChange = roles.isEmpty();
+    foreach (const QByteArray& role, roles) {
+        if (fileRoles.contains(role)) {
+            isFileChange = true;
+            break;
+        }
+    }
+
+    if (!isFileChange) {
+        return;
+    }
+
+    if (!m_updateAllItems) {
+        foreach (const KItemRange& range, itemRanges) {
+            for (int index = range.index; index < range.index + range.count; ++index) {
+                m_changedItems.append(m_model->fileItem(index));
+            }
+        }
+    }
+
+    delayedDirectoryVerification();
+}
+
+void VersionControlObserver::slotItemStatesUpdated(const VersionControlObserver::ItemStates& itemStates,
+                                                   bool retrievedItems)
 {
-    UpdateItemStatesThread* thread = m_updateItemStatesThread;
-    m_updateItemStatesThread = 0; // The thread deletes itself automatically (see updateItemStates())
+    m_updatingItemStates = false;
 
-    if (!m_plugin || !thread) {
+    if (!m_plugin || !m_model) {
         return;
     }
 
-    if (!thread->retrievedItems()) {
+    if (!retrievedItems) {
         // Ignore m_silentUpdate for an error message
         emit errorMessage(i18nc("@info:status", "Update of version information failed."));
         return;
     }
 
-    const QMap<QString, QVector<ItemState> >& itemStates = thread->itemStates();
-    foreach (const QString& directory, itemStates.keys()) {
-        const QVector<ItemState>& items = itemStates.value(directory);
+    if (!m_versionCacheCleared) {
+        // Only cache the versions if they have not been invalidated
+        // while the worker has been busy.
+        cacheItemStates(itemStates);
+    }
 
-        foreach (const ItemState& item, items) {
-            QHash<QByteArray, QVariant> values;
-            values.insert("version", QVariant(item.version));
-            m_model->setData(item.index, values);
+    // The indexes might have been changed while the worker
+    // has been busy, so the items are looked up again.
+    QMap<int, QHash<QByteArray, QVariant> > itemsData;
+    foreach (const QVector<ItemState>& items, itemStates) {
+        foreach (const ItemState& itemState, items) {
+            const int index = m_model->index(itemState.item);
+            if (index >= 0) {
+                QHash<QByteArray, QVariant> values;
+                values.insert("version", QVariant(itemState.version));
+                itemsData.insert(index, values);
+            }
         }
     }
+    if (!itemsData.isEmpty()) {
+        m_model->setItemsData(itemsData);
+    }
 
     if (!m_silentUpdate) {
         // Using an empty message results in clearing the previously shown information message and showing
@@ -231,32 +341,51 @@ void VersionControlObserver::slotThreadFinished()
 void VersionControlObserver::updateItemStates()
 {
     Q_ASSERT(m_plugin);
-    if (m_updateItemStatesThread) {
-        // An update is currently ongoing. Wait until the thread has finished
-        // the update (see slotThreadFinished()).
+    if (m_updatingItemStates) {
+        // An update is currently ongoing. Wait until the worker has finished
+        // the update (see slotItemStatesUpdated()).
         m_pendingItemStatesUpdate = true;
         return;
     }
 
-    QMap<QString, QVector<ItemState> > itemStates;
-    createItemStatesList(itemStates);
+    ItemStates itemStates;
+    if (m_updateAllItems) {
+        createItemStatesList(itemStates);
+    } else {
+        createChangedItemStatesList(itemStates);
+    }
+    m_updateAllItems = false;
+    m_changedItems.clear();
+
+    applyCachedItemStates(itemStates);
 
     if (!itemStates.isEmpty()) {
         if (!m_silentUpdate) {
             emit infoMessage(i18nc("@info:status", "Updating version information..."));
         }
-        m_updateItemStatesThread = new UpdateItemStatesThread(m_plugin, itemStates);
-        connect(m_updateItemStatesThread, SIGNAL(finished()),
-                this, SLOT(slotThreadFinished()));
-        connect(m_updateItemStatesThread, SIGNAL(finished()),
-                m_updateItemStatesThread, SLOT(deleteLater()));
 
-        m_updateItemStatesThread->start(); // slotThreadFinished() is called when finished
+        if (!m_updateItemStatesThread) {
+            m_updateItemStatesThread = new QThread();
+            m_updateItemStatesWorker = new UpdateItemStatesWorker();
+            m_updateItemStatesWorker->moveToThread(m_updateItemStatesThread);
+            connect(m_updateItemStatesWorker, SIGNAL(itemStatesUpdated(VersionControlObserver::ItemStates,bool)),
+                    this, SLOT(slotItemStatesUpdated(VersionControlObserver::ItemStates,bool)));
+            connect(m_updateItemStatesThread, SIGNAL(finished()),
+                    m_updateItemStatesWorker, SLOT(deleteLater()));
+            connect(m_updateItemStatesThread, SIGNAL(finished()),
+                    m_updateItemStatesThread, SLOT(deleteLater()));
+            m_updateItemStatesThread->start();
+        }
+
+        m_updatingItemStates = true;
+        m_versionCacheCleared = false;
+        QMetaObject::invokeMethod(m_updateItemStatesWorker, "updateItemStates", Qt::QueuedConnection,
+                                  Q_ARG(KVersionControlPlugin*, m_plugin),
+                                  Q_ARG(VersionControlObserver::ItemStates, itemStates));
     }
 }
 
-int VersionControlObserver::createItemStatesList(QMap<QString, QVector<ItemState> >& itemStates,
-                                                 const int firstIndex)
+int VersionControlObserver::createItemStatesList(ItemStates& itemStates, const int firstIndex)
 {
     const int itemCount = m_model->count();
     const int currentExpansionLevel = m_model->expandedParentsCount(firstIndex);
@@ -270,7 +399,6 @@ int VersionControlObserver::createItemStatesList(QMap<QString, QVector<ItemState
 
         if (expansionLevel == currentExpansionLevel) {
             ItemState itemState;
-            itemState.index = index;
             itemState.item = m_model->fileItem(index);
             itemState.version = KVersionControlPlugin2::UnversionedVersion;
 
@@ -291,6 +419,122 @@ int VersionControlObserver::createItemStatesList(QMap<QString, QVector<ItemState
     return index - firstIndex; // number of processed items
 }
 
+void VersionControlObserver::createChangedItemStatesList(ItemStates& itemStates)
+{
+    QSet<int> indexes;
+    QSet<int> parentIndexes;
+    foreach (const KFileItem& item, m_changedItems) {
+        const int index = m_model->index(item);
+        if (index < 0) {
+            continue;
+        }
+        indexes.insert(index);
+
+        // The parent directories are only part of the model if they are expanded
+        // inside the view. The root of the view is not part of the model.
+        KUrl parentUrl = item.url().upUrl();
+        parentUrl.adjustPath(KUrl::RemoveTrailingSlash);
+        int parentIndex = m_model->index(parentUrl);
+        while (parentIndex >= 0 && !parentIndexes.contains(parentIndex)) {
+            parentIndexes.insert(parentIndex);
+            indexes.insert(parentIndex);
+
+            const KFileItem parentItem = m_model->fileItem(parentIndex);
+            CachedVersions* cachedVersions = m_versionCache.object(parentItem.url().directory(KUrl::AppendTrailingSlash));
+            if (cachedVersions) {
+                cachedVersions->remove(parentItem.name());
+            }
+
+            parentUrl = parentUrl.upUrl();
+            parentUrl.adjustPath(KUrl::RemoveTrailingSlash);
+            parentIndex = m_model->index(parentUrl);
+        }
+    }
+
+    foreach (int index, indexes) {
+        ItemState itemState;
+        itemState.item = m_model->fileItem(index);
+        itemState.version = KVersionControlPlugin2::UnversionedVersion;
+
+        const QString directory = itemState.item.url().directory(KUrl::AppendTrailingSlash);
+        itemStates[directory].append(itemState);
+    }
+}
+
+void VersionControlObserver::applyCachedItemStates(ItemStates& itemStates)
+{
+    const qint64 now = m_versionCacheClock.elapsed();
+    QMap<int, QHash<QByteArray, QVariant> > itemsData;
+
+    ItemStates::iterator it = itemStates.begin();
+    while (it != itemStates.end()) {
+        const CachedVersions* cachedVersions = m_versionCache.object(it.key());
+        if (!cachedVersions) {
+            ++it;
+            continue;
+        }
+
+        QVector<ItemState> uncachedItems;
+        foreach (const ItemState& itemState, it.value()) {
+            const KFileItem& item = itemState.item;
+            const CachedVersions::const_iterator cached = cachedVersions->constFind(item.name());
+            if (cached != cachedVersions->constEnd()
+                && now - cached->timestamp < CachedVersionTimeout
+                && cached->modificationTime == item.time(KFileItem::ModificationTime)) {
+                const int index = m_model->index(item);
+                QHash<QByteArray, QVariant> values;
+                values.insert("version", QVariant(cached->version));
+                itemsData.insert(index, values);
+            } else {
+                uncachedItems.append(itemState);
+            }
+        }
+
+        if (uncachedItems.isEmpty()) {
+            it = itemStates.erase(it);
+        } else {
+            it.value() = uncachedItems;
+            ++it;
+        }
+    }
+
+    if (!itemsData.isEmpty()) {
+        m_model->setItemsData(itemsData);
+    }
+}
+
+void VersionControlObserver::cacheItemStates(const ItemStates& itemStates)
+{
+    const qint64 now = m_versionCacheClock.elapsed();
+
+    ItemStates::const_iterator it = itemStates.constBegin();
+    for (; it != itemStates.constEnd(); ++it) {
+        // The cost of a directory is the number of cached versions, which
+        // changes when adding versions. So the versions are taken out of
+        // the cache and inserted again.
+        CachedVersions* cachedVersions = m_versionCache.take(it.key());
+        if (!cachedVersions) {
+            cachedVersions = new CachedVersions();
+        }
+
+        foreach (const ItemState& itemState, it.value()) {
+            CachedVersion cachedVersion;
+            cachedVersion.modificationTime = itemState.item.time(KFileItem::ModificationTime);
+            cachedVersion.timestamp = now;
+            cachedVersion.version = itemState.version;
+            cachedVersions->insert(itemState.item.name(), cachedVersion);
+        }
+
+        m_versionCache.insert(it.key(), cachedVersions, qMax(1, cachedVersions->count()));
+    }
+}
+
+void VersionControlObserver::clearVersionCache()
+{
+    m_versionCache.clear();
+    m_versionCacheCleared = true;
+}
+
 KVersionControlPlugin* VersionControlObserver::searchPlugin(const KUrl& directory) const
 {
     static bool pluginsAvailable = true;
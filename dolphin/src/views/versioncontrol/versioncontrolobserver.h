@@ -22,18 +22,26 @@
 
 #include <libdolphin_export.h>
 
+#include <KDateTime>
 #include <KFileItem>
+#include <KFileItemList>
+#include <kitemviews/kitemrange.h>
 #include <kversioncontrolplugin2.h>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QList>
-#include <QMutex>
+#include <QMap>
 #include <QObject>
+#include <QSet>
 #include <QString>
+#include <QVector>
 
-class KFileItemList;
 class KFileItemModel;
 class QAction;
+class QThread;
 class QTimer;
-class UpdateItemStatesThread;
+class UpdateItemStatesWorker;
 
 /**
  * @brief Observes all version control plugins.
@@ -48,6 +56,19 @@ class LIBDOLPHINPRIVATE_EXPORT VersionControlObserver : public QObject
     Q_OBJECT
 
 public:
+    struct ItemState
+    {
+        KFileItem item;
+        KVersionControlPlugin2::ItemVersion version;
+    };
+
+    /**
+     * Item states for each directory, where the "key" is the directory
+     * url and the "value" is a list of ItemStates of the items inside
+     * this directory.
+     */
+    typedef QMap<QString, QVector<ItemState> > ItemStates;
+
     explicit VersionControlObserver(QObject* parent = 0);
     virtual ~VersionControlObserver();
 
@@ -94,19 +115,44 @@ private slots:
     void verifyDirectory();
 
     /**
-     * Is invoked if the thread m_updateItemStatesThread has been finished
-     * and applys the item states.
+     * Remembers the inserted items, so that only their versions
+     * get updated by the next updateItemStates().
      */
-    void slotThreadFinished();
+    void slotItemsInserted(const KItemRangeList& itemRanges);
+
+    /**
+     * Remembers the changed items, so that only their versions get updated
+     * by the next updateItemStates(). Changes of roles that don't indicate
+     * a modification of the file, like the version or the preview, are ignored.
+     */
+    void slotItemsChanged(const KItemRangeList& itemRanges, const QSet<QByteArray>& roles);
+
+    /**
+     * Is invoked if the worker m_updateItemStatesWorker has updated
+     * the item states and applies them. Note that the full type name
+     * VersionControlObserver::ItemStates is needed, as just using
+     * 'ItemStates' confuses moc.
+     */
+    void slotItemStatesUpdated(const VersionControlObserver::ItemStates& itemStates, bool retrievedItems);
 
 private:
-    struct ItemState
+    /**
+     * Version of an item, which is remembered by m_versionCache.
+     */
+    struct CachedVersion
     {
-        int index;
-        KFileItem item;
+        KDateTime modificationTime;
+        qint64 timestamp; // Value of m_versionCacheClock when the version has been retrieved
         KVersionControlPlugin2::ItemVersion version;
     };
+    typedef QHash<QString, CachedVersion> CachedVersions; // Key is the name of the item
 
+    /**
+     * Updates the versions of all items if m_updateAllItems is true, otherwise
+     * only the versions of m_changedItems. Versions that are available in
+     * m_versionCache are applied directly, all other items are passed to
+     * the worker.
+     */
     void updateItemStates();
 
     /**
@@ -122,8 +168,33 @@ private:
      *
      * @return          The number of (recursive) processed items.
      */
-    int createItemStatesList(QMap<QString, QVector<ItemState> >& itemStates,
-                             const int firstIndex = 0);
+    int createItemStatesList(ItemStates& itemStates, const int firstIndex = 0);
+
+    /**
+     * Like createItemStatesList(), but only adds the items of m_changedItems
+     * that are still part of the model, and their parent directories up to
+     * the root of the view. The cached versions of the parent directories are
+     * removed, as their modification time does not change if a file inside
+     * gets modified.
+     */
+    void createChangedItemStatesList(ItemStates& itemStates);
+
+    /**
+     * Applies the versions from m_versionCache that are still valid to the model
+     * and removes the corresponding items from \a itemStates.
+     */
+    void applyCachedItemStates(ItemStates& itemStates);
+
+    /**
+     * Remembers the versions of \a itemStates in m_versionCache.
+     */
+    void cacheItemStates(const ItemStates& itemStates);
+
+    /**
+     * Removes all versions from m_versionCache. Is invoked if the plugin
+     * reports that versions have changed or if another plugin is used.
+     */
+    void clearVersionCache();
 
     /**
      * Returns a matching plugin for the given directory.
@@ -147,9 +218,21 @@ private:
     QTimer* m_dirVerificationTimer;
 
     KVersionControlPlugin* m_plugin;
-    UpdateItemStatesThread* m_updateItemStatesThread;
 
-    friend class UpdateItemStatesThread;
+    QThread* m_updateItemStatesThread;
+    UpdateItemStatesWorker* m_updateItemStatesWorker;
+    bool m_updatingItemStates;
+
+    // If true, the next updateItemStates() updates all items,
+    // otherwise only the items of m_changedItems.
+    bool m_updateAllItems;
+    KFileItemList m_changedItems;
+
+    // Versions of recently updated items for each directory, so that
+    // e.g. expanding a folder again does not require to ask the plugin
+    QCache<QString, CachedVersions> m_versionCache;
+    QElapsedTimer m_versionCacheClock;
+    bool m_versionCacheCleared; // True if the cache has been cleared during an update
 };
 
 #endif // REVISIONCONTROLOBSERVER_H
@@ -320,6 +320,7 @@ KfindTabWidget::KfindTabWidget(QWidget *parent)
     caseContextCb  =new QCheckBox(i18n("Case s&ensitive"), pages[2]);
     binaryContextCb  =new QCheckBox(i18n("Include &binary files"), pages[2]);
     regexpContentCb  =new QCheckBox(i18n("Regular e&xpression"), pages[2]);
+    contentIndexCb  =new QCheckBox(i18n("Use content in&dex"), pages[2]);
 
     const QString binaryTooltip
       = i18n("<qt>This lets you search in any type of file, "
@@ -327,6 +328,12 @@ KfindTabWidget::KfindTabWidget(QWidget *parent)
 	   "program files and images).</qt>");
     binaryContextCb->setToolTip(binaryTooltip);
 
+    const QString contentIndexTooltip
+      = i18n("<qt>Remember which text is contained in the searched files, "
+       "so that repeated searches can skip files that did not change "
+       "and cannot contain the text.</qt>");
+    contentIndexCb->setToolTip(contentIndexTooltip);
+
     QPushButton* editRegExp = 0;
     if ( !KServiceTypeTrader::self()->query("KRegExpEditor/KRegExpEditor").isEmpty() ) {
         // The editor is available, so lets use it.
@@ -389,6 +396,7 @@ KfindTabWidget::KfindTabWidget(QWidget *parent)
     grid2->addWidget( regexpContentCb, 2, 2);
     grid2->addWidget( caseContextCb, 2, 1 );
     grid2->addWidget( binaryContextCb, 3, 1);
+    grid2->addWidget( contentIndexCb, 3, 2);
 
     grid2->addWidget( textMetaKey, 4, 0 );
     grid2->addWidget( metainfokeyEdit, 4, 1 );
@@ -788,6 +796,7 @@ void KfindTabWidget::setQuery(KQuery *query)
   
   query->setContext(textEdit->text(), caseContextCb->isChecked(),
   	binaryContextCb->isChecked(), regexpContentCb->isChecked());
+  query->setUseContentIndex(contentIndexCb->isChecked());
 }
 
 QString KfindTabWidget::date2String(const QDate & date) {
@@ -129,6 +129,7 @@ private:
   QCheckBox *caseContextCb;
   QCheckBox *binaryContextCb;
   QCheckBox *regexpContentCb;
+  QCheckBox *contentIndexCb;
   KDialog *regExpDialog;
 
   KUrl m_url;
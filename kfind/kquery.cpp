@@ -17,6 +17,7 @@
 ******************************************************************/
 
 #include "kquery.h"
+#include "kqueryindex.h"
 
 #include <stdlib.h>
 
@@ -24,16 +25,186 @@
 #include <QtCore/QTextCodec>
 #include <QtCore/QTextStream>
 #include <QtCore/QList>
+#include <QtCore/QRunnable>
+#include <QtCore/QtConcurrentRun>
 #include <kdebug.h>
 #include <kmimetype.h>
 #include <kfileitem.h>
 #include <kfilemetainfo.h>
-#include <kapplication.h>
 #include <kmessagebox.h>
 #include <klocale.h>
 #include <kstandarddirs.h>
 #include <kzip.h>
 
+/* Runs method of the index in a worker thread after the previous
+ * loading or saving, so that the GUI thread never waits for them */
+static void runIndexMethod(QFuture<void> previous, void (KQueryIndex::*method)())
+{
+  previous.waitForFinished();
+  (KQueryIndex::self()->*method)();
+}
+
+/* Verifies the content of a file in a worker thread of KQuery */
+class KQueryContentSearch : public QRunnable
+{
+ public:
+  QObject *receiver;
+  int id;
+  QAtomicInt *canceled;
+
+  QString path;
+  bool isOpenOffice;
+  bool isKOffice;
+  bool checkBinary;
+
+  QString context;
+  QRegExp regexp;
+  bool casesensitive;
+  bool regexpForContent;
+
+  // set if the content index should be used
+  KQueryIndex *index;
+  KQueryIndex::Trigrams trigrams;
+
+  void run();
+
+ private:
+  bool search(QString &matchingLine);
+};
+
+void KQueryContentSearch::run()
+{
+  QString matchingLine;
+  const bool found = search(matchingLine);
+
+  QMetaObject::invokeMethod(receiver, "slotContentSearched", Qt::QueuedConnection,
+                            Q_ARG(int, id), Q_ARG(bool, found), Q_ARG(QString, matchingLine));
+}
+
+bool KQueryContentSearch::search(QString &matchingLine)
+{
+  if (*canceled)
+    return false;
+
+  // The file is checked before reading it, so that changes while
+  // reading make the index entry outdated
+  KQueryIndex::Stamp stamp;
+  if (index && !KQueryIndex::stamp(path, stamp))
+    index = 0;
+
+  KQueryIndex::Lookup lookup = KQueryIndex::Unknown;
+  if (index)
+  {
+    lookup = index->lookup(path, stamp, trigrams);
+    if (lookup == KQueryIndex::DoesNotContain)
+      return false;
+  }
+  // While the index is updated, the whole file must be read
+  const bool updateIndex = index && lookup == KQueryIndex::Unknown &&
+                           stamp.size <= KQueryIndex::MaximumFileSize;
+
+  bool found = false;
+  bool isZippedOfficeDocument=false;
+  int matchingLineNumber=0;
+
+  // FIXME: doesn't work with non local files
+
+  QTextStream* stream=0;
+  QFile qf;
+  QRegExp xmlTags;
+  QByteArray zippedXmlFileContent;
+
+  // KWord's and OpenOffice.org's files are zipped...
+  if( isOpenOffice || isKOffice )
+  {
+    KZip zipfile(path);
+    KZipFileEntry *zipfileEntry;
+
+    if(zipfile.open(QIODevice::ReadOnly))
+    {
+      const KArchiveDirectory *zipfileContent = zipfile.directory();
+
+      if( isKOffice )
+        zipfileEntry = (KZipFileEntry*)zipfileContent->entry("maindoc.xml");
+      else
+        zipfileEntry = (KZipFileEntry*)zipfileContent->entry("content.xml"); //for OpenOffice.org
+
+      if(!zipfileEntry) {
+        kWarning() << "Expected XML file not found in ZIP archive " << path ;
+        return false;
+      }
+
+      zippedXmlFileContent = zipfileEntry->data();
+      xmlTags.setPattern("<.*>");
+      xmlTags.setMinimal(true);
+      stream = new QTextStream(zippedXmlFileContent, QIODevice::ReadOnly);
+      stream->setCodec("UTF-8");
+      isZippedOfficeDocument = true;
+    } else {
+      kWarning() << "Cannot open supposed ZIP file " << path ;
+    }
+
+  } else if( checkBinary ) {
+    if ( KMimeType::isBinaryData(path) ) {
+      kDebug() << "ignoring, not a text file: " << path;
+      return false;
+    }
+  }
+
+  if(!isZippedOfficeDocument) //any other file or non-compressed KWord
+  {
+    if(path.startsWith(QString("/dev/")))
+      return false;
+    qf.setFileName(path);
+    if (!qf.open(QIODevice::ReadOnly))
+      return false;
+    stream=new QTextStream(&qf);
+    stream->setCodec(QTextCodec::codecForLocale());
+  }
+
+  QSet<quint32> fileTrigrams;
+  while ( ! stream->atEnd() )
+  {
+    if (*canceled)
+    {
+      delete stream;
+      return false;
+    }
+
+    QString str = stream->readLine();
+    matchingLineNumber++;
+
+    //If the stream ended (readLine().isNull() is true) the file was read completely
+    //Do *not* use isEmpty() because that will exit if there is an empty line in the file
+    if (str.isNull()) break;
+    if(isZippedOfficeDocument)
+      str.remove(xmlTags);
+
+    if (updateIndex)
+      KQueryIndex::addTrigrams(str, fileTrigrams);
+    if (found)
+      continue;
+
+    const bool matches = regexpForContent
+      ? regexp.indexIn(str) >= 0
+      : str.indexOf(context, 0, casesensitive ? Qt::CaseSensitive : Qt::CaseInsensitive) != -1;
+    if (matches)
+    {
+      matchingLine=QString::number(matchingLineNumber)+": "+str;
+      found = true;
+      if (!updateIndex)
+        break;
+    }
+  }
+
+  delete stream;
+
+  if (updateIndex)
+    index->insert(path, stamp, fileTrigrams);
+
+  return found;
+}
+
 KQuery::KQuery(QObject *parent)
   : QObject(parent),
     m_filetype(0), m_sizemode(0), m_sizeboundary1(0),
@@ -41,7 +212,9 @@ KQuery::KQuery(QObject *parent)
     m_recursive(false),m_casesensitive(false),
     m_search_binary(false), m_regexpForContent(false),
     m_useLocate(false), m_showHiddenFiles(false),
-    job(0), m_insideCheckEntries(false), m_result(0)
+    m_useContentIndex(false), m_searching(false),
+    job(0), m_insideCheckEntries(false), m_result(0),
+    m_nextContentSearchId(0), m_contentSearchCanceled(0)
 {
   processLocate = new KProcess(this);
   connect(processLocate,SIGNAL(readyReadStandardOutput()),this,SLOT(slotreadyReadStandardOutput()));
@@ -79,6 +252,10 @@ KQuery::KQuery(QObject *parent)
 
 KQuery::~KQuery()
 {
+  cancelContentSearches();
+  m_contentSearchPool.waitForDone();
+  m_indexFuture.waitForFinished();
+
   while (!m_regexps.isEmpty())
     delete m_regexps.takeFirst();
   m_fileItems.clear();
@@ -93,16 +270,56 @@ KQuery::~KQuery()
 
 void KQuery::kill()
 {
+  cancelContentSearches();
   if (job)
     job->kill(KJob::EmitResult);
   if (processLocate->state() == QProcess::Running)
     processLocate->kill();
   m_fileItems.clear();
+
+  // the listing might be done already, while contents were still searched
+  if (m_searching && !job)
+    m_result = KIO::ERR_USER_CANCELED;
+  emitResultIfFinished();
+}
+
+void KQuery::cancelContentSearches()
+{
+  // running searches stop at the next line, their results are ignored
+  m_contentSearchCanceled = 1;
+  m_contentSearches.clear();
+}
+
+void KQuery::emitResultIfFinished()
+{
+  if (!m_searching || job || m_insideCheckEntries || !m_contentSearches.isEmpty() ||
+      processLocate->state() != QProcess::NotRunning)
+    return;
+
+  m_searching = false;
+  if (m_useContentIndex)
+    m_indexFuture = QtConcurrent::run(&runIndexMethod, m_indexFuture, &KQueryIndex::save);
+
+  emit result(m_result);
 }
 
 void KQuery::start()
 {
   m_fileItems.clear();
+
+  // wait for the canceled content searches of the last query
+  m_contentSearchPool.waitForDone();
+  m_contentSearchCanceled = 0;
+  m_result = 0;
+  m_searching = true;
+
+  if (m_useContentIndex && !m_context.isEmpty())
+  {
+    // the loading is chained after the saving of the last query; lookups
+    // of the content searches before it has finished find no entries
+    m_indexFuture = QtConcurrent::run(&runIndexMethod, m_indexFuture, &KQueryIndex::load);
+  }
+
   if( m_useLocate ) //Use "locate" instead of the internal search method
   {
     bufferLocate.clear();
@@ -175,10 +392,8 @@ void KQuery::checkEntries()
     processQuery( m_fileItems.dequeue() );
     processingCount++;
     
-    /* This is a workaround. As the kapp->processEvents() call inside processQuery
-     * will bring more KIO entries, m_fileItems will increase even inside this loop
-     * and that will lead to a big loop, it will take time to report found items to the GUI
-     * so we are going to force emit results every 100 files processed */
+    /* Report found items to the GUI every 100 files processed, so that
+     * the results of large listings show up progressively */
     if( processingCount==100 )
     {
       processingCount = 0;
@@ -193,10 +408,9 @@ void KQuery::checkEntries()
   if( m_foundFilesList.size() > 0 )
     emit foundFileList( m_foundFilesList );
   
-  if (job==0)
-    emit result(m_result);
-      
   m_insideCheckEntries=false;
+
+  emitResultIfFinished();
 }
 
 /* List of files found using slocate */
@@ -340,7 +554,6 @@ void KQuery::processQuery( const KFileItem &file)
   }
 
   // match contents...
-  QString matchingLine;
   if (!m_context.isEmpty())
   {
     //Avoid sequential files (fifo,char devices)
@@ -352,107 +565,65 @@ void KQuery::processQuery( const KFileItem &file)
       return;
     }
 
-    bool found = false;
-    bool isZippedOfficeDocument=false;
-    int matchingLineNumber=0;
-
-    // FIXME: doesn't work with non local files
-
-    QString filename;
-    QTextStream* stream=0;
-    QFile qf;
-    QRegExp xmlTags;
-    QByteArray zippedXmlFileContent;
-
-    // KWord's and OpenOffice.org's files are zipped...
-    if( ooo_mimetypes.indexOf(file.mimetype()) != -1 ||
-        koffice_mimetypes.indexOf(file.mimetype()) != -1 )
-    {
-      KZip zipfile(file.url().path());
-      KZipFileEntry *zipfileEntry;
-
-      if(zipfile.open(QIODevice::ReadOnly))
-      {
-        const KArchiveDirectory *zipfileContent = zipfile.directory();
-
-        if( koffice_mimetypes.indexOf(file.mimetype()) != -1 )
-          zipfileEntry = (KZipFileEntry*)zipfileContent->entry("maindoc.xml");
-        else
-          zipfileEntry = (KZipFileEntry*)zipfileContent->entry("content.xml"); //for OpenOffice.org
-
-        if(!zipfileEntry) {
-          kWarning() << "Expected XML file not found in ZIP archive " << file.url() ;
-          return;
-        }
-
-        zippedXmlFileContent = zipfileEntry->data();
-        xmlTags.setPattern("<.*>");
-        xmlTags.setMinimal(true);
-        stream = new QTextStream(zippedXmlFileContent, QIODevice::ReadOnly);
-        stream->setCodec("UTF-8");
-        isZippedOfficeDocument = true;
-      } else {
-        kWarning() << "Cannot open supposed ZIP file " << file.url() ;
-      }
-      
-    } else if( !m_search_binary && !file.mimetype().startsWith( QString("text/") ) &&
-        file.url().isLocalFile() && !file.url().path().startsWith( QString("/dev") ) ) {
-      if ( KMimeType::isBinaryData(file.url().path()) ) {
-        kDebug() << "ignoring, not a text file: " << file.url();
-        return;
-      }
-    }
+    // the file is reported by slotContentSearched() if it matches
+    searchContent(file);
+    return;
+  }
+  
+  m_foundFilesList.append( QPair<KFileItem,QString>(file, QString()) );
+}
 
-    if(!isZippedOfficeDocument) //any other file or non-compressed KWord
-    {
-      filename = file.url().path();
-      if(filename.startsWith(QString("/dev/")))
-        return;
-      qf.setFileName(filename);
-      qf.open(QIODevice::ReadOnly);
-      stream=new QTextStream(&qf);
-      stream->setCodec(QTextCodec::codecForLocale());
-    }
+void KQuery::searchContent(const KFileItem &file)
+{
+  const QString mimetype = file.mimetype();
+  const QString path = file.url().path();
+
+  KQueryContentSearch *search = new KQueryContentSearch;
+  search->receiver = this;
+  search->id = m_nextContentSearchId++;
+  search->canceled = &m_contentSearchCanceled;
+
+  search->path = path;
+  search->isOpenOffice = ooo_mimetypes.indexOf(mimetype) != -1;
+  search->isKOffice = koffice_mimetypes.indexOf(mimetype) != -1;
+  search->checkBinary = !m_search_binary && !mimetype.startsWith( QString("text/") ) &&
+                        file.url().isLocalFile() && !path.startsWith( QString("/dev") );
+
+  search->context = m_context;
+  search->regexp = m_regexp;
+  search->casesensitive = m_casesensitive;
+  search->regexpForContent = m_regexpForContent;
+
+  search->index = 0;
+  if (m_useContentIndex && file.url().isLocalFile())
+  {
+    search->index = KQueryIndex::self();
+    // regular expressions can not be checked against the index
+    if (!m_regexpForContent)
+      search->trigrams = KQueryIndex::trigrams(m_context);
+  }
 
-    while ( ! stream->atEnd() )
-    {
-      QString str = stream->readLine();
-      matchingLineNumber++;
+  m_contentSearches.insert(search->id, file);
+  m_contentSearchPool.start(search);
+}
 
-      //If the stream ended (readLine().isNull() is true) the file was read completely
-      //Do *not* use isEmpty() because that will exit if there is an empty line in the file
-      if (str.isNull()) break;
-      if(isZippedOfficeDocument)
-        str.remove(xmlTags);
+void KQuery::slotContentSearched(int id, bool found, const QString &matchingLine)
+{
+  QHash<int, KFileItem>::iterator it = m_contentSearches.find(id);
+  if (it == m_contentSearches.end())
+    return; // canceled
 
-      if (m_regexpForContent)
-      {
-        if (m_regexp.indexIn(str)>=0)
-        {
-          matchingLine=QString::number(matchingLineNumber)+": "+str;
-          found = true;
-          break;
-        }
-      }
-      else
-      {
-        if (str.indexOf(m_context, 0, m_casesensitive?Qt::CaseSensitive:Qt::CaseInsensitive) != -1)
-        {
-          matchingLine=QString::number(matchingLineNumber)+": "+str;
-          found = true;
-          break;
-        }
-      }
-      kapp->processEvents();
-    }
-    
-    delete stream;
+  const KFileItem file = it.value();
+  m_contentSearches.erase(it);
 
-    if (!found)
-      return;
+  if (found)
+  {
+    QList< QPair<KFileItem,QString> > list;
+    list.append( QPair<KFileItem,QString>(file, matchingLine) );
+    emit foundFileList( list );
   }
-  
-  m_foundFilesList.append( QPair<KFileItem,QString>(file, matchingLine) );
+
+  emitResultIfFinished();
 }
 
 void KQuery::setContext(const QString & context, bool casesensitive,
@@ -545,6 +716,11 @@ void KQuery::setUseFileIndex(bool useLocate)
   m_useLocate=useLocate;
 }
 
+void KQuery::setUseContentIndex(bool useContentIndex)
+{
+  m_useContentIndex = useContentIndex;
+}
+
 void KQuery::setShowHiddenFiles(bool showHidden)
 {
   m_showHiddenFiles = showHidden;
@@ -571,7 +747,8 @@ void KQuery::slotendProcessLocate(int code, QProcess::ExitStatus)
       slotListEntries(str.split('\n', QString::SkipEmptyParts));
     }
   }
-  emit result(0);
+  m_result = 0;
+  emitResultIfFinished();
 }
 
 #include "kquery.moc"
@@ -28,6 +28,9 @@
 #include <QtCore/QDir>
 #include <QtCore/QPair>
 #include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QThreadPool>
+#include <QtCore/QFuture>
 
 #include <kio/job.h>
 #include <kurl.h>
@@ -57,6 +60,7 @@ class KQuery : public QObject
   void setGroupname( const QString &groupname );
   void setMetaInfo(const QString &metainfo, const QString &metainfokey);
   void setUseFileIndex(bool);
+  void setUseContentIndex(bool);
   void setShowHiddenFiles(bool);
 
   void start();
@@ -67,6 +71,9 @@ class KQuery : public QObject
   /* Check if file meets the find's requirements*/
   inline void processQuery(const KFileItem &);
 
+  /* Starts the verification of the content of file in a worker thread */
+  void searchContent(const KFileItem &file);
+
  public Q_SLOTS:
   /* List of files found using slocate */
   void slotListEntries(QStringList);
@@ -81,12 +88,17 @@ class KQuery : public QObject
   void slotreadyReadStandardError();
   void slotendProcessLocate(int, QProcess::ExitStatus);
 
+  /* Result of a content search started by searchContent() */
+  void slotContentSearched(int id, bool found, const QString &matchingLine);
+
  Q_SIGNALS:
     void foundFileList( QList< QPair<KFileItem,QString> >);
     void result(int);
 
  private:
   void checkEntries();
+  void cancelContentSearches();
+  void emitResultIfFinished();
 
   int m_filetype;
   int m_sizemode;
@@ -108,6 +120,8 @@ class KQuery : public QObject
   bool m_regexpForContent;
   bool m_useLocate;
   bool m_showHiddenFiles;
+  bool m_useContentIndex;
+  bool m_searching;
   QByteArray bufferLocate;
   QStringList locateList;
   KProcess *processLocate;
@@ -123,6 +137,13 @@ class KQuery : public QObject
   QStringList koffice_mimetypes;
   
   QList< QPair<KFileItem,QString> > m_foundFilesList;
+
+  // content searches running in m_contentSearchPool, by id
+  QThreadPool m_contentSearchPool;
+  QHash<int, KFileItem> m_contentSearches;
+  int m_nextContentSearchId;
+  QAtomicInt m_contentSearchCanceled;
+  QFuture<void> m_indexFuture;
 };
 
 #endif
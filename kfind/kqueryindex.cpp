@@ -0,0 +1,324 @@
+/*******************************************************************
+* kqueryindex.cpp
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************/
+
+#include "kqueryindex.h"
+
+#include <algorithm>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPair>
+#include <QtCore/QStringList>
+#include <kde_file.h>
+#include <kdebug.h>
+#include <kglobal.h>
+#include <ksavefile.h>
+#include <kstandarddirs.h>
+
+static const quint32 indexMagic = 0x4b46494e; // "KFIN"
+static const quint32 indexVersion = 3;
+
+// The index is rewritten if the journal has more entries than this
+// or more than a quarter of the index entries
+static const int minimumCompactionCount = 256;
+
+K_GLOBAL_STATIC(KQueryIndex, s_queryIndex)
+
+KQueryIndex* KQueryIndex::self()
+{
+  return s_queryIndex;
+}
+
+KQueryIndex::KQueryIndex()
+  : m_journalCount(0), m_useCounter(0), m_loaded(false)
+{
+}
+
+static inline quint32 trigramHash(ushort c0, ushort c1, ushort c2)
+{
+  // Collisions only let files pass that must be verified anyway
+  return (quint32(c0) * 0x9e3779b1u) ^ (quint32(c1) * 0x85ebca77u) ^ (quint32(c2) * 0xc2b2ae3du);
+}
+
+void KQueryIndex::addTrigrams(const QString &line, QSet<quint32> &set)
+{
+  if (line.length() < 3)
+    return;
+
+  // Folded like the case insensitive comparison of the search
+  const QString folded = line.toCaseFolded();
+  const ushort *data = folded.utf16();
+  const int count = folded.length() - 2;
+  for (int i = 0; i < count; ++i)
+    set.insert(trigramHash(data[i], data[i+1], data[i+2]));
+}
+
+KQueryIndex::Trigrams KQueryIndex::trigrams(const QString &text)
+{
+  QSet<quint32> set;
+  addTrigrams(text, set);
+
+  Trigrams result;
+  result.reserve(set.count());
+  foreach (quint32 trigram, set)
+    result.append(trigram);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+bool KQueryIndex::stamp(const QString &path, Stamp &stamp)
+{
+  KDE_struct_stat buff;
+  if (KDE_stat(QFile::encodeName(path), &buff) != 0)
+    return false;
+
+  // A file may be changed several times within a second without
+  // changing its size, so the nanoseconds must be compared too
+#if defined(Q_OS_MAC)
+  const qint64 nanoseconds = buff.st_mtimespec.tv_nsec;
+#elif defined(Q_OS_UNIX)
+  const qint64 nanoseconds = buff.st_mtim.tv_nsec;
+#else
+  const qint64 nanoseconds = 0;
+#endif
+  stamp.mtime = qint64(buff.st_mtime) * 1000000000 + nanoseconds;
+  stamp.inode = buff.st_ino;
+  stamp.size = buff.st_size;
+  return true;
+}
+
+KQueryIndex::Lookup KQueryIndex::lookup(const QString &path, const Stamp &stamp,
+                                        const Trigrams &trigrams)
+{
+  QMutexLocker locker(&m_mutex);
+
+  QHash<QString, Entry>::iterator it = m_entries.find(path);
+  if (it == m_entries.end() || it->stamp.mtime != stamp.mtime ||
+      it->stamp.inode != stamp.inode || it->stamp.size != stamp.size)
+    return Unknown;
+
+  it->lastUsed = ++m_useCounter;
+
+  // Both vectors are sorted
+  Trigrams::const_iterator entryIt = it->trigrams.constBegin();
+  const Trigrams::const_iterator entryEnd = it->trigrams.constEnd();
+  foreach (quint32 trigram, trigrams)
+  {
+    entryIt = std::lower_bound(entryIt, entryEnd, trigram);
+    if (entryIt == entryEnd || *entryIt != trigram)
+      return DoesNotContain;
+  }
+  return MayContain;
+}
+
+void KQueryIndex::insert(const QString &path, const Stamp &stamp,
+                         const QSet<quint32> &trigrams)
+{
+  Entry entry;
+  entry.stamp = stamp;
+  entry.trigrams.reserve(trigrams.count());
+  foreach (quint32 trigram, trigrams)
+    entry.trigrams.append(trigram);
+  std::sort(entry.trigrams.begin(), entry.trigrams.end());
+
+  QMutexLocker locker(&m_mutex);
+  entry.lastUsed = ++m_useCounter;
+  m_entries.insert(path, entry);
+  m_changedPaths.insert(path);
+}
+
+static bool lessRecentlyUsed(const QPair<quint64, QString> &a, const QPair<quint64, QString> &b)
+{
+  return a.first < b.first;
+}
+
+void KQueryIndex::prune(int maximumCount)
+{
+  QStringList paths;
+  {
+    QMutexLocker locker(&m_mutex);
+    paths = m_entries.keys();
+  }
+
+  // Check the files without locking, as searches might be running
+  QStringList removedPaths;
+  foreach (const QString &path, paths)
+  {
+    if (!QFile::exists(path))
+      removedPaths.append(path);
+  }
+
+  QMutexLocker locker(&m_mutex);
+  foreach (const QString &path, removedPaths)
+  {
+    m_entries.remove(path);
+    m_changedPaths.remove(path);
+  }
+
+  if (m_entries.count() <= maximumCount)
+    return;
+
+  QVector<QPair<quint64, QString> > usage;
+  usage.reserve(m_entries.count());
+  QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+  for (; it != m_entries.constEnd(); ++it)
+    usage.append(qMakePair(it->lastUsed, it.key()));
+
+  const int removedCount = m_entries.count() - maximumCount;
+  std::nth_element(usage.begin(), usage.begin() + removedCount, usage.end(), lessRecentlyUsed);
+  for (int i = 0; i < removedCount; ++i)
+  {
+    m_entries.remove(usage.at(i).second);
+    m_changedPaths.remove(usage.at(i).second);
+  }
+}
+
+QString KQueryIndex::fileName()
+{
+  return KStandardDirs::locateLocal("data", "kfind/contentindex");
+}
+
+QString KQueryIndex::journalFileName()
+{
+  return KStandardDirs::locateLocal("data", "kfind/contentindex.journal");
+}
+
+void KQueryIndex::writeEntry(QDataStream &stream, const QString &path, const Entry &entry)
+{
+  stream << path << entry.stamp.mtime << entry.stamp.inode << entry.stamp.size
+         << entry.lastUsed << entry.trigrams;
+}
+
+bool KQueryIndex::readEntry(QDataStream &stream, QString &path, Entry &entry)
+{
+  stream >> path >> entry.stamp.mtime >> entry.stamp.inode >> entry.stamp.size
+         >> entry.lastUsed >> entry.trigrams;
+  return stream.status() == QDataStream::Ok;
+}
+
+int KQueryIndex::readFile(const QString &fileName)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return 0;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic, version;
+  stream >> magic >> version;
+  if (magic != indexMagic || version != indexVersion) {
+    kDebug() << "ignoring content index with unknown format" << fileName;
+    return 0;
+  }
+
+  int count = 0;
+  QString path;
+  Entry entry;
+  while (!stream.atEnd() && readEntry(stream, path, entry))
+  {
+    // Entries inserted while loading are more recent
+    if (!m_changedPaths.contains(path))
+      m_entries.insert(path, entry);
+    m_useCounter = qMax(m_useCounter, entry.lastUsed);
+    ++count;
+  }
+
+  // An interrupted append to the journal only loses the last entry
+  if (stream.status() != QDataStream::Ok)
+    kDebug() << "content index is truncated" << fileName;
+  return count;
+}
+
+void KQueryIndex::load()
+{
+  QMutexLocker locker(&m_mutex);
+  if (m_loaded)
+    return;
+  m_loaded = true;
+
+  readFile(fileName());
+  m_journalCount = readFile(journalFileName());
+}
+
+void KQueryIndex::save()
+{
+  QMutexLocker saveLocker(&m_saveMutex);
+
+  bool compact;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (!m_loaded || m_changedPaths.isEmpty())
+      return;
+    compact = m_journalCount + m_changedPaths.count() >
+              qMax(minimumCompactionCount, m_entries.count() / 4);
+  }
+
+  if (!compact)
+  {
+    // Only append the changed entries to the journal
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    {
+      QMutexLocker locker(&m_mutex);
+      foreach (const QString &path, m_changedPaths)
+        writeEntry(stream, path, m_entries.value(path));
+      m_journalCount += m_changedPaths.count();
+      m_changedPaths.clear();
+    }
+
+    QFile file(journalFileName());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+      return;
+    if (file.size() == 0)
+    {
+      QDataStream header(&file);
+      header.setVersion(QDataStream::Qt_4_6);
+      header << indexMagic << indexVersion;
+    }
+    file.write(data);
+    return;
+  }
+
+  prune();
+
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_4_6);
+  stream << indexMagic << indexVersion;
+  {
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+    for (; it != m_entries.constEnd(); ++it)
+      writeEntry(stream, it.key(), *it);
+    m_changedPaths.clear();
+    m_journalCount = 0;
+  }
+
+  KSaveFile file(fileName());
+  if (!file.open())
+    return;
+  if (file.write(data) != data.size()) {
+    file.abort();
+    return;
+  }
+  if (file.finalize())
+    QFile::remove(journalFileName());
+}
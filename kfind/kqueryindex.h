@@ -0,0 +1,128 @@
+/*******************************************************************
+* kqueryindex.h
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************/
+
+#ifndef KQUERYINDEX_H
+#define KQUERYINDEX_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+/**
+ * Trigram index of the content of files, used by KQuery to skip
+ * files that cannot contain the searched text.
+ *
+ * For each indexed file, the set of all (case folded) three character
+ * sequences of its text is stored together with the modification time
+ * in nanoseconds, the inode and the size of the file. A file whose entry
+ * is up to date can only contain the searched text if it contains all
+ * trigrams of the text.
+ *
+ * The index is filled by KQuery while verifying the content of files
+ * and stored in the user's data directory. New entries are appended to
+ * a journal; the index file is only rewritten when the journal has grown
+ * large. Entries of removed files are pruned then, and at most
+ * MaximumEntryCount recently used entries are kept. All methods are
+ * thread-safe.
+ */
+class KQueryIndex
+{
+ public:
+  typedef QVector<quint32> Trigrams;
+
+  enum Lookup {
+    Unknown,        // the file is not indexed or has been changed
+    MayContain,     // the file contains all trigrams
+    DoesNotContain  // the file does not contain the text
+  };
+
+  /* Identifies the version of a file */
+  struct Stamp {
+    qint64 mtime;   // in nanoseconds
+    quint64 inode;
+    qint64 size;
+  };
+
+  /* Files larger than this are not indexed */
+  static const qint64 MaximumFileSize = 16 * 1024 * 1024;
+
+  /* Number of entries that are kept when the index is rewritten */
+  static const int MaximumEntryCount = 20000;
+
+  static KQueryIndex* self();
+
+  /* Adds the trigrams of the case folded version of line to set */
+  static void addTrigrams(const QString &line, QSet<quint32> &set);
+
+  /* Sorted trigrams of the case folded version of text */
+  static Trigrams trigrams(const QString &text);
+
+  /* Gets the stamp of the file path. Returns false if it does not exist */
+  static bool stamp(const QString &path, Stamp &stamp);
+
+  Lookup lookup(const QString &path, const Stamp &stamp,
+                const Trigrams &trigrams);
+  void insert(const QString &path, const Stamp &stamp,
+              const QSet<quint32> &trigrams);
+
+  /* Removes the entries of files that do not exist anymore, and the
+   * least recently used entries if more than maximumCount are left */
+  void prune(int maximumCount = MaximumEntryCount);
+
+  /* Loads the index from disk, if not done yet */
+  void load();
+
+  /* Stores the changes of the index on disk */
+  void save();
+
+  KQueryIndex();
+
+ private:
+  struct Entry {
+    Stamp stamp;
+    quint64 lastUsed;
+    Trigrams trigrams;
+  };
+
+  static QString fileName();
+  static QString journalFileName();
+
+  static void writeEntry(QDataStream &stream, const QString &path, const Entry &entry);
+  static bool readEntry(QDataStream &stream, QString &path, Entry &entry);
+
+  /* Reads the entries of the index or journal fileName,
+   * returns the number of entries read */
+  int readFile(const QString &fileName);
+
+  QMutex m_mutex;
+  QHash<QString, Entry> m_entries;
+  // paths inserted since the last save()
+  QSet<QString> m_changedPaths;
+  // number of entries in the journal file
+  int m_journalCount;
+  // increased on each use of an entry, to find the least recently used ones
+  quint64 m_useCounter;
+  bool m_loaded;
+
+  // Serializes writing the files, as save() may be invoked by several threads
+  QMutex m_saveMutex;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*******************************************************************
+* kqueryindextest.cpp
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+******************************************************************/
+
+#include "kqueryindex.h"
+
+#include <qtest_kde.h>
+#include <ktempdir.h>
+
+#include <QtCore/QFile>
+
+class KQueryIndexTest : public QObject
+{
+  Q_OBJECT
+
+ private Q_SLOTS:
+  void testLookup();
+  void testLookupAfterModification();
+  void testLookupCaseFolded();
+  void testPruneRemovedFiles();
+  void testPruneLeastRecentlyUsed();
+
+ private:
+  static QString createFile(const KTempDir &dir, const QString &name, const QByteArray &content);
+  static void insertFile(KQueryIndex &index, const QString &path, const QString &content);
+};
+
+QTEST_KDEMAIN_CORE(KQueryIndexTest)
+
+QString KQueryIndexTest::createFile(const KTempDir &dir, const QString &name, const QByteArray &content)
+{
+  const QString path = dir.name() + name;
+  QFile file(path);
+  file.open(QIODevice::WriteOnly);
+  file.write(content);
+  file.close();
+  return path;
+}
+
+void KQueryIndexTest::insertFile(KQueryIndex &index, const QString &path, const QString &content)
+{
+  KQueryIndex::Stamp stamp;
+  QVERIFY(KQueryIndex::stamp(path, stamp));
+
+  QSet<quint32> trigrams;
+  KQueryIndex::addTrigrams(content, trigrams);
+  index.insert(path, stamp, trigrams);
+}
+
+void KQueryIndexTest::testLookup()
+{
+  KTempDir dir;
+  const QString path = createFile(dir, "file.txt", "Hello World");
+
+  KQueryIndex index;
+  insertFile(index, path, "Hello World");
+
+  KQueryIndex::Stamp stamp;
+  QVERIFY(KQueryIndex::stamp(path, stamp));
+  QCOMPARE(index.lookup(path, stamp, KQueryIndex::trigrams("world")), KQueryIndex::MayContain);
+  QCOMPARE(index.lookup(path, stamp, KQueryIndex::trigrams("earth")), KQueryIndex::DoesNotContain);
+  QCOMPARE(index.lookup(dir.name() + "other.txt", stamp, KQueryIndex::trigrams("world")), KQueryIndex::Unknown);
+}
+
+void KQueryIndexTest::testLookupCaseFolded()
+{
+  KTempDir dir;
+  const QByteArray content = "\xce\x9f\xce\x94\xce\x9f\xce\xa3"; // "ODOS" in capital greek letters
+  const QString path = createFile(dir, "file.txt", content);
+
+  KQueryIndex index;
+  insertFile(index, path, QString::fromUtf8(content));
+
+  // The final sigma is only equal to the capital sigma when case folded
+  KQueryIndex::Stamp stamp;
+  QVERIFY(KQueryIndex::stamp(path, stamp));
+  QCOMPARE(index.lookup(path, stamp, KQueryIndex::trigrams(QString::fromUtf8("\xce\xbf\xce\xb4\xce\xbf\xcf\x82"))),
+           KQueryIndex::MayContain);
+}
+
+void KQueryIndexTest::testLookupAfterModification()
+{
+  KTempDir dir;
+  const QString path = createFile(dir, "file.txt", "Hello World");
+
+  KQueryIndex index;
+  insertFile(index, path, "Hello World");
+
+  KQueryIndex::Stamp stamp;
+  QVERIFY(KQueryIndex::stamp(path, stamp));
+  const KQueryIndex::Trigrams trigrams = KQueryIndex::trigrams("earth");
+  QCOMPARE(index.lookup(path, stamp, trigrams), KQueryIndex::DoesNotContain);
+
+  // A change within the same second, which does not change the size
+  KQueryIndex::Stamp modifiedStamp = stamp;
+  modifiedStamp.mtime += 1;
+  QCOMPARE(index.lookup(path, modifiedStamp, trigrams), KQueryIndex::Unknown);
+
+  // A file that has been replaced by another file of the same size
+  const QString newPath = createFile(dir, "new.txt", "Hello Earth");
+  QVERIFY(QFile::rename(newPath, path) || (QFile::remove(path) && QFile::rename(newPath, path)));
+  KQueryIndex::Stamp replacedStamp;
+  QVERIFY(KQueryIndex::stamp(path, replacedStamp));
+  QVERIFY(replacedStamp.inode != stamp.inode);
+  QCOMPARE(index.lookup(path, replacedStamp, trigrams), KQueryIndex::Unknown);
+
+  insertFile(index, path, "Hello Earth");
+  QCOMPARE(index.lookup(path, replacedStamp, trigrams), KQueryIndex::MayContain);
+}
+
+void KQueryIndexTest::testPruneRemovedFiles()
+{
+  KTempDir dir;
+  const QString keptPath = createFile(dir, "kept.txt", "Hello World");
+  const QString removedPath = createFile(dir, "removed.txt", "Hello World");
+
+  KQueryIndex index;
+  insertFile(index, keptPath, "Hello World");
+  insertFile(index, removedPath, "Hello World");
+
+  KQueryIndex::Stamp removedStamp;
+  QVERIFY(KQueryIndex::stamp(removedPath, removedStamp));
+  QVERIFY(QFile::remove(removedPath));
+
+  index.prune();
+
+  const KQueryIndex::Trigrams trigrams = KQueryIndex::trigrams("world");
+  KQueryIndex::Stamp keptStamp;
+  QVERIFY(KQueryIndex::stamp(keptPath, keptStamp));
+  QCOMPARE(index.lookup(keptPath, keptStamp, trigrams), KQueryIndex::MayContain);
+  QCOMPARE(index.lookup(removedPath, removedStamp, trigrams), KQueryIndex::Unknown);
+}
+
+void KQueryIndexTest::testPruneLeastRecentlyUsed()
+{
+  KTempDir dir;
+  QStringList paths;
+  QList<KQueryIndex::Stamp> stamps;
+  KQueryIndex index;
+  for (int i = 0; i < 3; ++i)
+  {
+    paths.append(createFile(dir, QString("file%1.txt").arg(i), "Hello World"));
+    insertFile(index, paths.last(), "Hello World");
+
+    KQueryIndex::Stamp stamp;
+    QVERIFY(KQueryIndex::stamp(paths.last(), stamp));
+    stamps.append(stamp);
+  }
+
+  // Use the first file, so that the second one is the least recently used
+  const KQueryIndex::Trigrams trigrams = KQueryIndex::trigrams("world");
+  QCOMPARE(index.lookup(paths.at(0), stamps.at(0), trigrams), KQueryIndex::MayContain);
+
+  index.prune(2);
+
+  QCOMPARE(index.lookup(paths.at(0), stamps.at(0), trigrams), KQueryIndex::MayContain);
+  QCOMPARE(index.lookup(paths.at(1), stamps.at(1), trigrams), KQueryIndex::Unknown);
+  QCOMPARE(index.lookup(paths.at(2), stamps.at(2), trigrams), KQueryIndex::MayContain);
+}
+
+#include "kqueryindextest.moc"
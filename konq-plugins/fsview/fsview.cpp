@@ -107,6 +107,9 @@ FSView::FSView(Inode* base, QWidget* parent)
   }
 
   _sm.setListener(this);
+  /* read directories in the background, so that interaction
+   * is not blocked while waiting for the file system */
+  _sm.setThreaded(true);
 }
 
 FSView::~FSView()
@@ -456,7 +459,7 @@ void FSView::doRedraw()
 
   if (_allowRefresh && ((redrawCounter%4)==0)) {
     if (0) kDebug(90100) << "doRedraw " << _sm.scanLength();
-    redraw();
+    redrawChanged();
   }
   else
     redo = true;
@@ -470,10 +473,13 @@ void FSView::doRedraw()
 
 void FSView::doUpdate()
 {
+  int newCount = 0;
   for(int i=0;i<5;i++) {
+    int count = 0;
     switch(_progressPhase) {
     case 1:
-      _chunkSize1 += _sm.scan(_chunkData1);
+      count = _sm.scan(_chunkData1);
+      _chunkSize1 += count;
       if (_chunkSize1 > 100) {
 	_progressPhase = 2;
 
@@ -486,7 +492,8 @@ void FSView::doUpdate()
 
     case 2:
       /* progress phase 2 */
-      _chunkSize2 += _sm.scan(_chunkData2);
+      count = _sm.scan(_chunkData2);
+      _chunkSize2 += count;
       /* switch to Phase 3 if we reach 80 % of Phase 2 */
       if (_progress * 3 > _progressSize * 8/10) {
 	_progressPhase = 3;
@@ -512,7 +519,8 @@ void FSView::doUpdate()
 
     case 3:
       /* progress phase 3 */
-      _chunkSize3 += _sm.scan(_chunkData3);
+      count = _sm.scan(_chunkData3);
+      _chunkSize3 += count;
       /* switch to Phase 4 if we reach 80 % of Phase 3 */
       if (_progress * 3/2 > _progressSize * 8/10) {
 	_progressPhase = 4;
@@ -530,13 +538,17 @@ void FSView::doUpdate()
       }
 
     default:
-      _sm.scan(-1);
+      count += _sm.scan(-1);
       break;
     }
+    newCount += count;
   }
 
+  /* In threaded mode, scan() does not wait for the worker threads.
+   * Check again a bit later if no results were available yet */
   if (_sm.scanRunning())
-    QTimer::singleShot(0, this, SLOT(doUpdate()));
+    QTimer::singleShot((newCount > 0 || !_sm.isThreaded()) ? 0 : 10,
+		       this, SLOT(doUpdate()));
   else
     emit completed(_dirsFinished);
 }
@@ -138,6 +138,8 @@ void Inode::sizeChanged(ScanDir* d)
 		   << d->name() << ": size " << d->size() << endl;
 
   _resortNeeded = true;
+  // the displayed size or file count can change without changing the value
+  invalidateDrawing();
 }
 
 void Inode::scanFinished(ScanDir* d)
@@ -151,6 +153,7 @@ void Inode::scanFinished(ScanDir* d)
   _sizeEstimation = 0.0;
   _fileCountEstimation = 0;
   _dirCountEstimation = 0;
+  invalidateDrawing();
 
   // cache metrics if "important" (for "/usr" is dd==3)
   int dd = ((FSView*)widget())->pathDepth() + depth();
@@ -209,8 +212,9 @@ TreeMapItemList* Inode::children()
     _resortNeeded = false;
   }
 
-  if (_resortNeeded) {    
-    resort();
+  if (_resortNeeded) {
+    // children with changed sizes resort themselves when drawn
+    resort(false);
     _resortNeeded = false;
   }
 
@@ -19,6 +19,12 @@
 #include <qdir.h>
 #include <qstringlist.h>
 #include <qset.h>
+#include <qmutex.h>
+#include <qqueue.h>
+#include <qrunnable.h>
+#include <qthread.h>
+#include <qthreadpool.h>
+#include <qwaitcondition.h>
 
 #include <kdebug.h>
 #include <kurl.h>
@@ -27,6 +33,129 @@
 #include "scan.h"
 #include "inode.h"
 
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// ScanWorkers
+
+/* maximal number of directories passed to the worker threads */
+static const int maxRunningScans = 256;
+
+/* maximal number of results applied by one call of ScanManager::scan() */
+static const int maxResultsPerScan = 32;
+
+struct ScanResult
+{
+  ScanItem* item;
+  int generation;
+  ScanFileVector files;
+  KIO::fileoffset_t fileSize;
+  QStringList dirs;
+};
+
+/**
+ * Thread pool and result queue for threaded scanning.
+ * The results are tagged with a generation, so that results
+ * of stopped scans can be dropped without touching their items.
+ */
+class ScanWorkers
+{
+ public:
+  ScanWorkers()
+  {
+    _generation = 0;
+    /* scanning is bound by the file system: use more threads
+     * than cores to keep the disk queue filled */
+    _pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() * 2, 16));
+  }
+
+  ~ScanWorkers()
+  {
+    _pool.waitForDone();
+    qDeleteAll(_results);
+  }
+
+  void start(ScanItem* si);
+  void addResult(ScanResult* r);
+
+  /* Returns next result of the current generation, or 0.
+   * Waits at most msecs if no result is available. */
+  ScanResult* takeResult(int msecs);
+
+  /* drop all pending and running scans */
+  void reset()
+  {
+    QMutexLocker locker(&_mutex);
+    _generation++;
+    qDeleteAll(_results);
+    _results.clear();
+  }
+
+ private:
+  QThreadPool _pool;
+  QMutex _mutex;
+  QWaitCondition _resultAvailable;
+  QQueue<ScanResult*> _results;
+  int _generation;
+};
+
+class ScanJob: public QRunnable
+{
+ public:
+  ScanJob(ScanWorkers* w, ScanResult* r, const QString& p)
+    : _workers(w), _result(r), _path(p) {}
+
+  void run()
+  {
+    _result->fileSize = ScanDir::readEntries(_path, _result->files,
+                                             _result->dirs);
+    _workers->addResult(_result);
+  }
+
+ private:
+  ScanWorkers* _workers;
+  ScanResult* _result;
+  QString _path;
+};
+
+void ScanWorkers::start(ScanItem* si)
+{
+  ScanResult* r = new ScanResult;
+  r->item = si;
+  r->fileSize = 0;
+  {
+    QMutexLocker locker(&_mutex);
+    r->generation = _generation;
+  }
+  _pool.start(new ScanJob(this, r, si->absPath));
+}
+
+void ScanWorkers::addResult(ScanResult* r)
+{
+  QMutexLocker locker(&_mutex);
+  if (r->generation != _generation) {
+    delete r;
+    return;
+  }
+  _results.enqueue(r);
+  _resultAvailable.wakeAll();
+}
+
+ScanResult* ScanWorkers::takeResult(int msecs)
+{
+  QMutexLocker locker(&_mutex);
+  if (_results.isEmpty() && msecs > 0)
+    _resultAvailable.wait(&_mutex, msecs);
+
+  if (_results.isEmpty()) return 0;
+  return _results.dequeue();
+}
+
 
 // ScanManager
 
@@ -34,21 +163,37 @@ ScanManager::ScanManager()
 {
   _topDir = 0;
   _listener = 0;
+  _workers = 0;
 }
 
 ScanManager::ScanManager(const QString& path)
 {
   _topDir = 0;
   _listener = 0;
+  _workers = 0;
   setTop(path);
 }
 
 ScanManager::~ScanManager()
 {
   stopScan();
+  delete _workers;
   delete _topDir;
 }
 
+void ScanManager::setThreaded(bool threaded)
+{
+  if (threaded == isThreaded()) return;
+
+  stopScan();
+  if (threaded)
+    _workers = new ScanWorkers;
+  else {
+    delete _workers;
+    _workers = 0;
+  }
+}
+
 void ScanManager::setListener(ScanListener* l)
 {
   _listener = l;
@@ -71,7 +216,8 @@ bool ScanManager::scanRunning()
 {
   if (!_topDir) return false;
 
-  return _topDir->scanRunning();
+  /* in threaded mode, the top directory might not be read yet */
+  return _topDir->scanRunning() || !_running.isEmpty();
 }
 
 void ScanManager::startScan(ScanDir* from)
@@ -95,6 +241,14 @@ void ScanManager::stopScan()
   if (0) kDebug(90100) << "ScanManager::stopScan, scanLength "
 		   << _list.count() << endl;
 
+  if (_workers) _workers->reset();
+
+  while( !_running.isEmpty() ) {
+    ScanItem* si = _running.takeFirst();
+    si->dir->finish();
+    delete si;
+  }
+
   while( !_list.isEmpty() ) {
     ScanItem* si = _list.takeFirst();
     si->dir->finish();
@@ -104,6 +258,8 @@ void ScanManager::stopScan()
 
 int ScanManager::scan(int data)
 {
+  if (_workers) return scanThreaded(data);
+
   if (_list.isEmpty()) return false;
   ScanItem* si = _list.takeFirst();
 
@@ -114,6 +270,40 @@ int ScanManager::scan(int data)
 }
 
 
+int ScanManager::scanThreaded(int data)
+{
+  /* pass todo list to worker threads */
+  while (!_list.isEmpty() && (_running.count() < maxRunningScans)) {
+    ScanItem* si = _list.takeFirst();
+    if (!si->dir->prepareScan(si)) {
+      delete si;
+      continue;
+    }
+    _running.append(si);
+    _workers->start(si);
+  }
+
+  if (_running.isEmpty()) return 0;
+
+  /* Apply results read in the meantime without blocking the caller.
+   * Results which are not available yet are taken on the next call */
+  int newCount = 0;
+  ScanResult* r = _workers->takeResult(0);
+  for (int i = 0; r && (i < maxResultsPerScan); i++) {
+    _running.removeOne(r->item);
+    newCount += r->item->dir->setEntries(r->item, _list, data,
+                                         r->files, r->fileSize, r->dirs);
+    delete r->item;
+    delete r;
+
+    if (i+1 < maxResultsPerScan)
+      r = _workers->takeResult(0);
+  }
+
+  return newCount;
+}
+
+
 // ScanFile
 
 ScanFile::ScanFile()
@@ -233,6 +423,17 @@ bool ScanDir::isForbiddenDir(QString& d)
 }
 
 int ScanDir::scan(ScanItem* si, ScanItemList& list, int data)
+{
+  if (!prepareScan(si)) return 0;
+
+  ScanFileVector files;
+  QStringList dirs;
+  KIO::fileoffset_t fileSize = readEntries(si->absPath, files, dirs);
+
+  return setEntries(si, list, data, files, fileSize, dirs);
+}
+
+bool ScanDir::prepareScan(ScanItem* si)
 {
   clear();
   _dirsFinished = 0;
@@ -242,7 +443,7 @@ int ScanDir::scan(ScanItem* si, ScanItemList& list, int data)
   if (isForbiddenDir(si->absPath)) {
       if (_parent)
           _parent->subScanFinished();
-      return 0;
+      return false;
   }
 
   KUrl u;
@@ -251,35 +452,99 @@ int ScanDir::scan(ScanItem* si, ScanItemList& list, int data)
     if (_parent)
       _parent->subScanFinished();
 
+    return false;
+  }
+
+  return true;
+}
+
+KIO::fileoffset_t ScanDir::readEntries(const QString& absPath,
+                                       ScanFileVector& files,
+                                       QStringList& dirs)
+{
+  KIO::fileoffset_t fileSize = 0;
+
+#ifdef Q_OS_UNIX
+  /* Read the directory entries directly: the entry type is mostly
+   * known without stat(), and files are stat'ed relative to the
+   * directory descriptor, avoiding path lookups */
+  int fd = ::open(QFile::encodeName(absPath).constData(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) return 0;
+
+  DIR* dir = ::fdopendir(fd);
+  if (!dir) {
+    ::close(fd);
     return 0;
   }
 
-  QDir d(si->absPath);
+  struct dirent* entry;
+  while ((entry = ::readdir(dir)) != 0) {
+    const char* name = entry->d_name;
+    if ((name[0] == '.') &&
+        ((name[1] == 0) || ((name[1] == '.') && (name[2] == 0))))
+      continue;
+
+    int type = DT_UNKNOWN;
+#ifdef _DIRENT_HAVE_D_TYPE
+    type = entry->d_type;
+#endif
+    if (type == DT_DIR) {
+      dirs.append(QFile::decodeName(name));
+      continue;
+    }
+    /* symbolic links and special files are skipped */
+    if ((type != DT_REG) && (type != DT_UNKNOWN)) continue;
+
+    struct stat buff;
+    if (::fstatat(fd, name, &buff, AT_SYMLINK_NOFOLLOW) != 0)
+      continue;
+
+    if (S_ISDIR(buff.st_mode))
+      dirs.append(QFile::decodeName(name));
+    else if (S_ISREG(buff.st_mode)) {
+      files.append( ScanFile(QFile::decodeName(name), buff.st_size) );
+      fileSize += buff.st_size;
+    }
+  }
+  ::closedir(dir);
+#else
+  QDir d(absPath);
   const QStringList fileList = d.entryList( QDir::Files |
 				      QDir::Hidden | QDir::NoSymLinks );
 
   if (fileList.count()>0) {
     KDE_struct_stat buff;
 
-    _files.reserve(fileList.count());
+    files.reserve(fileList.count());
 
     QStringList::ConstIterator it;
     for (it = fileList.constBegin(); it != fileList.constEnd(); ++it ) {
-      if (KDE::lstat( si->absPath + QLatin1Char('/') + (*it), &buff ) != 0)
+      if (KDE::lstat( absPath + QLatin1Char('/') + (*it), &buff ) != 0)
         continue;
-      _files.append( ScanFile(*it, buff.st_size) );
-      _fileSize += buff.st_size;
+      files.append( ScanFile(*it, buff.st_size) );
+      fileSize += buff.st_size;
     }
   }
 
-  const QStringList dirList = d.entryList( QDir::Dirs | 
-				     QDir::Hidden | QDir::NoSymLinks | QDir::NoDotAndDotDot );
+  dirs = d.entryList( QDir::Dirs |
+		      QDir::Hidden | QDir::NoSymLinks | QDir::NoDotAndDotDot );
+#endif
+
+  return fileSize;
+}
+
+int ScanDir::setEntries(ScanItem* si, ScanItemList& list, int data,
+                        const ScanFileVector& files, KIO::fileoffset_t fileSize,
+                        const QStringList& dirs)
+{
+  _files = files;
+  _fileSize = fileSize;
 
-  if (dirList.count()>0) {
-    _dirs.reserve(dirList.count());
+  if (dirs.count()>0) {
+    _dirs.reserve(dirs.count());
 
     QStringList::ConstIterator it;
-    for (it = dirList.constBegin(); it != dirList.constEnd(); ++it ) {
+    for (it = dirs.constBegin(); it != dirs.constEnd(); ++it ) {
       _dirs.append( ScanDir(*it, _manager, this, data) );
       QString newpath = si->absPath;
       if (!newpath.endsWith(QChar('/'))) newpath.append("/");
@@ -24,6 +24,8 @@
 #define KONQ_PLUGIN_SCAN_H
 
 #include <qfile.h>
+#include <qstringlist.h>
+#include <qvector.h>
 
 /* Use KDE_lstat and KIO::fileoffset_t for 64-bit sizes */
 #include <kde_file.h>
@@ -31,6 +33,7 @@
 
 class ScanDir;
 class ScanFile;
+class ScanWorkers;
 
 class ScanItem
 {
@@ -76,7 +79,11 @@ class ScanListener
  *
  *   ScanManager m("/opt");
  *   m.startScan();
- *   while(m.scan());
+ *   while(m.scanRunning()) m.scan(0);
+ *
+ * With setThreaded(true), the directories are read by worker
+ * threads, and scan() only applies the results that are available
+ * instead of blocking until a directory has been read.
  */
 class ScanManager
 {
@@ -92,7 +99,14 @@ class ScanManager
   ScanDir* top() { return _topDir; }
 
   bool scanRunning();
-  int scanLength() const { return _list.count(); }
+  int scanLength() const { return _list.count() + _running.count(); }
+
+  /**
+   * Read directories in worker threads. Listeners are still
+   * only called from the thread calling scan().
+   */
+  void setThreaded(bool threaded);
+  bool isThreaded() const { return _workers != 0; }
   
   /**
    * Starts the scan. Stop previous scan if running.
@@ -113,6 +127,9 @@ class ScanManager
    * Scan first directory from todo list.
    * Directories added to the todo list are attributed with data. 
    * Returns the number of new subdirectories created for scanning.
+   *
+   * In threaded mode, the todo list is passed to the worker threads,
+   * and the directories read in the meantime are added.
    */
   int scan(int data);
 
@@ -121,9 +138,13 @@ class ScanManager
   ScanListener* listener() { return _listener; }
 
  private:
+  int scanThreaded(int data);
+
   ScanItemList _list;
+  ScanItemList _running; /* passed to worker threads */
   ScanDir* _topDir;
   ScanListener* _listener;
+  ScanWorkers* _workers;
 };
 
 class ScanFile
@@ -170,6 +191,29 @@ class ScanDir
    */
   int scan(ScanItem* si, ScanItemList& list, int data);
 
+  /*
+   * First part of scan(): Returns false if the directory
+   * must not be read, which finishes the scan of it.
+   */
+  bool prepareScan(ScanItem* si);
+
+  /*
+   * Last part of scan(): Sets the items read by readEntries()
+   * and appends subdirectories to todo list.
+   */
+  int setEntries(ScanItem* si, ScanItemList& list, int data,
+                 const ScanFileVector& files, KIO::fileoffset_t fileSize,
+                 const QStringList& dirs);
+
+  /*
+   * Reads the files and subdirectories of absPath, without
+   * following symbolic links. Returns the size of all files.
+   * Can be called from any thread.
+   */
+  static KIO::fileoffset_t readEntries(const QString& absPath,
+                                       ScanFileVector& files,
+                                       QStringList& dirs);
+
   /* clear scan objects below */
   void clear();
 
@@ -16,11 +16,21 @@
    Boston, MA 02110-1301, USA.
 */
 
-/* Test Directory Scanning. Usually not build. */
+/* Test Directory Scanning. Usually not build.
+ *
+ * Usage: scantest [--benchmark] [path]
+ *
+ * With --benchmark, the path is scanned without and with worker
+ * threads, and the time needed by both backends is printed.
+ * Drop the file system caches before for comparable results.
+ */
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <qdatetime.h>
+
 #include "scan.h"
 
 class MyListener: public ScanListener
@@ -45,12 +55,50 @@ public:
   }
 };
 
+static void benchmark(const QString& path, bool threaded)
+{
+  ScanManager m(path);
+  m.setThreaded(threaded);
+
+  QTime t;
+  t.start();
+
+  m.startScan();
+  int scanCalls = 0;
+  while(m.scanLength() > 0) {
+    int count = m.scan(1);
+    scanCalls++;
+
+    // like FSView, don't poll the worker threads without a pause
+    if (threaded && count == 0)
+      usleep(10000);
+  }
+
+  ScanDir* d = m.top();
+  printf("%-8s: %6d ms, %d scan calls, Dirs %d, Files %d, Size %llu\n",
+	 threaded ? "threaded" : "serial", t.elapsed(), scanCalls,
+	 d->dirCount(), d->fileCount(), (unsigned long long int)d->size());
+}
+
 int main(int argc, char* argv[])
 {
-  ScanManager m("/opt");
-  if (argc>1) m.setTop(argv[1]);
+  bool doBenchmark = false;
+  QString path("/opt");
+  for (int i=1; i<argc; i++) {
+    if (strcmp(argv[i], "--benchmark") == 0)
+      doBenchmark = true;
+    else
+      path = QFile::decodeName(argv[i]);
+  }
+
+  if (doBenchmark) {
+    benchmark(path, false);
+    benchmark(path, true);
+    return 0;
+  }
 
+  ScanManager m(path);
   m.setListener(new MyListener());
   m.startScan();
-  while(m.scan(1));
+  while(m.scanLength() > 0) m.scan(1);
 }
@@ -846,6 +846,11 @@ TreeMapItem::TreeMapItem(TreeMapItem* parent, double value)
   _depth = -1; // not set
   _unused_self = 0;
 
+  _drawnValue = 0;
+  _drawnSum = 0;
+  _drawnPass = -1; // never drawn
+  _drawingDirty = true;
+
   if (_parent) {
     // take sorting from parent
     _sortTextNo = _parent->sorting(&_sortAscending);
@@ -878,6 +883,11 @@ TreeMapItem::TreeMapItem(TreeMapItem* parent, double value,
   _depth = -1; // not set
   _unused_self = 0;
 
+  _drawnValue = 0;
+  _drawnSum = 0;
+  _drawnPass = -1; // never drawn
+  _drawingDirty = true;
+
   if (_parent) _parent->addItem(this);
 }
 
@@ -934,6 +944,8 @@ void TreeMapItem::clear()
     qDeleteAll(*_children);
     delete _children;
     _children = 0;
+
+    invalidateDrawing();
   }
 }
 
@@ -988,6 +1000,7 @@ void TreeMapItem::addItem(TreeMapItem* i)
     _children = new TreeMapItemList;
 
   i->setParent(this);
+  invalidateDrawing();
 
   _children->append(i); // preserve insertion order
   if (sorting(0) != -1)
@@ -1095,6 +1108,12 @@ TreeMapItemList* TreeMapItem::children()
   return _children;
 }
 
+void TreeMapItem::invalidateDrawing()
+{
+  for(TreeMapItem* i = this; i; i = i->_parent)
+    i->_drawingDirty = true;
+}
+
 void TreeMapItem::clearItemRect()
 {
     _rect = QRect();
@@ -1192,6 +1211,9 @@ TreeMapWidget::TreeMapWidget(TreeMapItem* base,
   _pressed = 0;
   _lastOver = 0;
   _needsRefresh = _base;
+  _reuseDrawing = false;
+  _drawingPass = 0;
+  _parentPass = -1;
 
   setAttribute(Qt::WA_NoSystemBackground, true);
   setFocusPolicy(Qt::StrongFocus);
@@ -2182,15 +2204,22 @@ void TreeMapWidget::drawTreeMap()
   // no need to draw if hidden
   if (!isVisible()) return;
 
-  if (_pixmap.size() != size())
+  if (_pixmap.size() != size()) {
     _needsRefresh = _base;
+    _reuseDrawing = false;
+  }
 
   if (_needsRefresh) {
 
     if (DEBUG_DRAWING)
       kDebug(90100) << "Redrawing " << _needsRefresh->path(0).join("/");
 
+    _drawingPass++;
     if (_needsRefresh == _base) {
+      // keep last drawing for unchanged items, see drawItems()
+      if (_reuseDrawing)
+        _previousPixmap = _pixmap;
+
       // redraw whole widget
       _pixmap = QPixmap(size());
       _pixmap.fill(palette().color(backgroundRole()));
@@ -2212,6 +2241,8 @@ void TreeMapWidget::drawTreeMap()
 
     drawItems(&p, _needsRefresh);
     _needsRefresh = 0;
+    _reuseDrawing = false;
+    _previousPixmap = QPixmap();
   }
 
   QStylePainter p(this);
@@ -2232,6 +2263,10 @@ void TreeMapWidget::redraw(TreeMapItem* i)
 {
   if (!i) return;
 
+  // explicit redraws can change the look of unchanged items
+  // (e.g. selection), so the last drawing can not be reused
+  _reuseDrawing = false;
+
   if (!_needsRefresh)
     _needsRefresh = i;
   else {
@@ -2245,6 +2280,16 @@ void TreeMapWidget::redraw(TreeMapItem* i)
   }
 }
 
+void TreeMapWidget::redrawChanged()
+{
+  // a pending redraw of a subitem must not reuse the last drawing
+  bool reuse = !_needsRefresh ||
+               ((_needsRefresh == _base) && _reuseDrawing);
+
+  redraw(_base);
+  _reuseDrawing = reuse;
+}
+
 void TreeMapWidget::drawItem(QPainter* p,
                              TreeMapItem* item)
 {
@@ -2299,10 +2344,57 @@ bool TreeMapWidget::horizontal(TreeMapItem* i, const QRect& r)
 
 
 /**
- * Draw TreeMapItems recursive, starting from item
+ * Draw TreeMapItems recursive, starting from item.
+ *
+ * When redrawing all items with redrawChanged(), the area of
+ * an unchanged item, with the same rectangle, value, sum and
+ * field texts, is copied from the last drawing instead of
+ * doing the layout and drawing of its children again. This is
+ * only valid if the item was drawn in the same pass as its parent
+ * was drawn the last time; otherwise the area could have been
+ * overdrawn by the parent in a pass not including this item.
  */
 void TreeMapWidget::drawItems(QPainter* p,
                               TreeMapItem* item)
+{
+  int parentPass = _parentPass;
+
+  if (!_previousPixmap.isNull() &&
+      (item != _needsRefresh) &&
+      (parentPass > 0) && (item->_drawnPass == parentPass) &&
+      !item->_drawingDirty &&
+      (item->_drawnRect == item->itemRect()) &&
+      (item->_drawnValue == item->value()) &&
+      (item->_drawnSum == item->sum()) &&
+      (item->_drawnTexts == fieldTexts(item))) {
+
+    p->drawPixmap(item->itemRect(), _previousPixmap, item->itemRect());
+    item->_drawnPass = _drawingPass;
+    return;
+  }
+
+  _parentPass = item->_drawnPass;
+  drawItemsUncached(p, item);
+  _parentPass = parentPass;
+
+  item->_drawnRect = item->itemRect();
+  item->_drawnValue = item->value();
+  item->_drawnSum = item->sum();
+  item->_drawnTexts = fieldTexts(item);
+  item->_drawnPass = _drawingPass;
+  item->_drawingDirty = false;
+}
+
+QStringList TreeMapWidget::fieldTexts(TreeMapItem* item) const
+{
+  QStringList texts;
+  for (int no=0;no<_attr.size();no++)
+    texts << (fieldVisible(no) ? item->text(no) : QString());
+  return texts;
+}
+
+void TreeMapWidget::drawItemsUncached(QPainter* p,
+                                      TreeMapItem* item)
 {
     if (DEBUG_DRAWING)
 	kDebug(90100) << "+drawItems(" << item->path(0).join("/") << ", "
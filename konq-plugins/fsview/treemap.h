@@ -220,6 +220,8 @@ public:
  */
 class TreeMapItem: public StoredDrawParams
 {
+  friend class TreeMapWidget;
+
 public:
 
   /**
@@ -366,6 +368,9 @@ protected:
   TreeMapItemList* _children;
   double _sum, _value;
 
+  // marks this item and all parents as changed for drawing
+  void invalidateDrawing();
+
 private:
   TreeMapWidget* _widget;
   TreeMapItem* _parent;
@@ -383,6 +388,13 @@ private:
 
   // index of last active subitem
   int _index;
+
+  // state of the last drawing, see TreeMapWidget::drawItems()
+  QRect _drawnRect;
+  double _drawnValue, _drawnSum;
+  QStringList _drawnTexts;
+  int _drawnPass;
+  bool _drawingDirty;
 };
 
 
@@ -643,6 +655,14 @@ public:
   void redraw(TreeMapItem*);
   void redraw() { redraw(_base); }
 
+  /**
+   * Redraws all items like redraw(), but reuses the last drawing
+   * of items whose area, value() and sum() did not change and
+   * whose children were not changed.
+   * Use this for periodic updates while values are changing.
+   */
+  void redrawChanged();
+
   /**
    * Resort all TreeMapItems. See TreeMapItem::resort().
    */
@@ -703,6 +723,9 @@ private:
 
   void drawItem(QPainter* p, TreeMapItem*);
   void drawItems(QPainter* p, TreeMapItem*);
+  void drawItemsUncached(QPainter* p, TreeMapItem*);
+  // texts of the visible fields of an item, to detect changed items
+  QStringList fieldTexts(TreeMapItem*) const;
   bool horizontal(TreeMapItem* i, const QRect& r);
   void drawFill(TreeMapItem*,QPainter* p, const QRect& r);
   void drawFill(TreeMapItem*,QPainter* p, const QRect& r,
@@ -749,6 +772,11 @@ private:
 
   // back buffer pixmap
   QPixmap _pixmap;
+
+  // drawing of the last pass, to copy unchanged items from
+  QPixmap _previousPixmap;
+  bool _reuseDrawing;
+  int _drawingPass, _parentPass;
 };
 
 #endif
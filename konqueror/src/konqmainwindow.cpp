@@ -5724,6 +5724,9 @@ bool KonqMainWindow::event( QEvent* e )
             return true; // no deleting
         }
 
+    } else if ( e->type() == QEvent::WindowDeactivate ) {
+        // The window may have been changed while it was active
+        KonqSessionManager::self()->markDirty(this);
     } else if ( e->type() == QEvent::StatusTip) {
         if (m_currentView && m_currentView->frame()->statusbar()) {
             KonqFrameStatusBar *statusBar = m_currentView->frame()->statusbar();
@@ -48,12 +48,15 @@
 #include <QtCore/QDir>
 #include <QDBusArgument>
 #include <QFile>
+#include <QScopedPointer>
 #include <QSize>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTreeWidget>
 #include <QScrollArea>
 #include <QScrollBar>
+#include <QtCore/QtConcurrentRun>
+#include <ksavefile.h>
 
 
 class KonqSessionManagerPrivate
@@ -90,6 +93,137 @@ static const QList<KConfigGroup> windowConfigGroups(/*NOT const, we'll use write
     return groups;
 }
 
+/**
+ * The entries of a window's config group, or of one of its subgroups.
+ *
+ * Autosaved sessions are stored as a list of these per window instead of
+ * a KConfig file: the entries are collected from the window's config group
+ * in the GUI thread and written by a worker thread, without escaping the
+ * history buffers of the views.
+ */
+class KonqSessionManager::WindowGroup
+{
+public:
+    QStringList path; // relative to the window's config group
+    QMap<QString, QByteArray> entries;
+};
+
+static QDataStream& operator<<(QDataStream& stream, const KonqSessionManager::WindowGroup& group)
+{
+    return stream << group.path << group.entries;
+}
+
+static QDataStream& operator>>(QDataStream& stream, KonqSessionManager::WindowGroup& group)
+{
+    return stream >> group.path >> group.entries;
+}
+
+static const char s_sessionFileMagic[] = "KonqSession1";
+
+static void collectWindowGroups(const KConfigGroup& group, const QStringList& path,
+                                KonqSessionManager::WindowState& state)
+{
+    KonqSessionManager::WindowGroup windowGroup;
+    windowGroup.path = path;
+    // Raw values, so that they can be written back unchanged
+    Q_FOREACH(const QString& key, group.keyList()) {
+        windowGroup.entries.insert(key, group.readEntry(key, QByteArray()));
+    }
+    state.append(windowGroup);
+
+    Q_FOREACH(const QString& name, group.groupList()) {
+        collectWindowGroups(group.group(name), path + QStringList(name), state);
+    }
+}
+
+static KonqSessionManager::WindowState windowState(const KConfigGroup& group)
+{
+    KonqSessionManager::WindowState state;
+    collectWindowGroups(group, QStringList(), state);
+    return state;
+}
+
+static bool isBinarySessionFile(const QString& sessionFilePath)
+{
+    QFile file(sessionFilePath);
+    return file.open(QIODevice::ReadOnly) &&
+           file.read(sizeof(s_sessionFileMagic) - 1) == s_sessionFileMagic;
+}
+
+/**
+ * Writes a session in the binary format. Invoked in a worker thread
+ * by the autosave.
+ */
+static bool writeSessionFile(const QString& sessionFilePath, const QList<KonqSessionManager::WindowState>& windows)
+{
+    KSaveFile file(sessionFilePath);
+    if (!file.open()) {
+        kWarning() << "Can't open" << sessionFilePath;
+        return false;
+    }
+
+    file.write(s_sessionFileMagic, sizeof(s_sessionFileMagic) - 1);
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << windows;
+
+    return file.finalize();
+}
+
+/**
+ * Exports the session @p config to the binary format.
+ */
+static bool exportSessionFile(const QString& sessionFilePath, KConfig& config)
+{
+    QList<KonqSessionManager::WindowState> windows;
+    Q_FOREACH(const KConfigGroup& group, windowConfigGroups(config)) {
+        windows.append(windowState(group));
+    }
+    return writeSessionFile(sessionFilePath, windows);
+}
+
+/**
+ * Opens the session @p sessionFilePath. A session in the binary format is
+ * imported into a KConfig that only exists in memory.
+ */
+static KConfig* openSessionConfig(const QString& sessionFilePath)
+{
+    if (!isBinarySessionFile(sessionFilePath)) {
+        return new KConfig(sessionFilePath, KConfig::SimpleConfig);
+    }
+
+    QList<KonqSessionManager::WindowState> windows;
+    QFile file(sessionFilePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        file.seek(sizeof(s_sessionFileMagic) - 1);
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_6);
+        stream >> windows;
+        if (stream.status() != QDataStream::Ok) {
+            kWarning() << "The session" << sessionFilePath << "is damaged";
+            windows.clear();
+        }
+    }
+
+    KConfig* config = new KConfig(QString(), KConfig::SimpleConfig);
+    for (int i = 0; i < windows.count(); ++i) {
+        KConfigGroup windowGroup(config, "Window" + QString::number(i));
+        Q_FOREACH(const KonqSessionManager::WindowGroup& group, windows.at(i)) {
+            KConfigGroup configGroup = windowGroup;
+            Q_FOREACH(const QString& name, group.path) {
+                configGroup = configGroup.group(name);
+            }
+            QMap<QString, QByteArray>::const_iterator it = group.entries.constBegin();
+            for (; it != group.entries.constEnd(); ++it) {
+                configGroup.writeEntry(it.key(), it.value());
+            }
+        }
+    }
+    KConfigGroup generalGroup(config, "General");
+    generalGroup.writeEntry("Number of Windows", windows.count());
+    return config;
+}
+
 SessionRestoreDialog::SessionRestoreDialog(const QStringList& sessionFilePaths, QWidget* parent)
         : KDialog(parent, 0)
          ,m_sessionItemsCount(0)
@@ -154,8 +288,8 @@ SessionRestoreDialog::SessionRestoreDialog(const QStringList& sessionFilePaths,
         Q_FOREACH(const QString& sessionFile, sessionFilePaths) {
             kDebug() << sessionFile;
             QTreeWidgetItem* windowItem = 0;
-            KConfig config(sessionFile, KConfig::SimpleConfig);
-            const QList<KConfigGroup> groups = windowConfigGroups(config);
+            QScopedPointer<KConfig> config(openSessionConfig(sessionFile));
+            const QList<KConfigGroup> groups = windowConfigGroups(*config);
             Q_FOREACH(const KConfigGroup& group, groups) {
                 // To avoid a recursive search, let's do linear search on Foo_CurrentHistoryItem=1
                 Q_FOREACH(const QString& key, group.keyList()) {
@@ -360,7 +494,6 @@ KonqSessionManager::KonqSessionManager()
     : m_autosaveDir(KStandardDirs::locateLocal("appdata", "autosave"))
       , m_autosaveEnabled(false) // so that enableAutosave works
       , m_createdOwnedByDir(false)
-      , m_sessionConfig(0)
 {
     // Initialize dbus interfaces
     new KonqSessionManagerAdaptor ( this );
@@ -385,9 +518,9 @@ KonqSessionManager::KonqSessionManager()
 
 KonqSessionManager::~KonqSessionManager()
 {
-    if (m_sessionConfig)
-        QFile::remove(m_sessionConfig->name());
-    delete m_sessionConfig;
+    m_autosave.waitForFinished();
+    if (!m_autosaveFilePath.isEmpty())
+        QFile::remove(m_autosaveFilePath);
 }
 
 void KonqSessionManager::disableAutosave()
@@ -397,11 +530,12 @@ void KonqSessionManager::disableAutosave()
 
     m_autosaveEnabled = false;
     m_autoSaveTimer.stop();
-    if (m_sessionConfig) {
-        QFile::remove(m_sessionConfig->name());
-        delete m_sessionConfig;
-        m_sessionConfig = 0;
+    m_autosave.waitForFinished();
+    if (!m_autosaveFilePath.isEmpty()) {
+        QFile::remove(m_autosaveFilePath);
+        m_autosaveFilePath.clear();
     }
+    m_windowStates.clear();
 }
 
 void KonqSessionManager::enableAutosave()
@@ -409,13 +543,10 @@ void KonqSessionManager::enableAutosave()
     if(m_autosaveEnabled)
         return;
 
-    // Create the config file for autosaving current session
+    // The file for autosaving current session
     QString filename = QLatin1String("autosave/") + m_baseService;
-    const QString filePath = KStandardDirs::locateLocal("appdata", filename);
-
-    delete m_sessionConfig;
-    m_sessionConfig = new KConfig(filePath, KConfig::SimpleConfig, "appdata");
-    //kDebug() << "config filename:" << m_sessionConfig->name();
+    m_autosaveFilePath = KStandardDirs::locateLocal("appdata", filename);
+    //kDebug() << "autosave filename:" << m_autosaveFilePath;
 
     m_autosaveEnabled = true;
     m_autoSaveTimer.start();
@@ -445,13 +576,46 @@ void KonqSessionManager::autoSaveSession()
     if(isActive)
         m_autoSaveTimer.stop();
 
-    saveCurrentSessionToFile(m_sessionConfig);
-    m_sessionConfig->sync();
-    m_sessionConfig->markAsClean();
+    QList<WindowState> windows;
+    QList<KonqMainWindow*> *mainWindows = KonqMainWindow::mainWindowList();
+    if (mainWindows) {
+        foreach (KonqMainWindow* window, *mainWindows) {
+            // Changes in the active window (e.g. scrolling) are not tracked
+            if (window->isActiveWindow())
+                markDirty(window);
+
+            QHash<QObject*, WindowState>::const_iterator it = m_windowStates.constFind(window);
+            if (it != m_windowStates.constEnd()) {
+                windows.append(it.value());
+                continue;
+            }
+
+            KConfig config(QString(), KConfig::SimpleConfig); // only in memory
+            KConfigGroup configGroup(&config, "Window");
+            window->saveProperties(configGroup);
+            const WindowState state = windowState(configGroup);
+            windows.append(state);
+
+            // Nothing is saved for windows that are not fully constructed yet
+            if (!configGroup.keyList().isEmpty()) {
+                m_windowStates.insert(window, state);
+                connect(window, SIGNAL(destroyed(QObject*)),
+                        this, SLOT(slotWindowDestroyed(QObject*)), Qt::UniqueConnection);
+            }
+        }
+    }
+
+    // The windows are written by a worker thread, from the collected copy
+    // of their entries.
+    m_autosave.waitForFinished();
+    m_autosave = QtConcurrent::run(writeSessionFile, m_autosaveFilePath, windows);
 
-    // Now that we have saved current session it's safe to remove our owned_by
-    // directory
-    deleteOwnedSessions();
+    if (m_createdOwnedByDir) {
+        // Now that we have saved current session it's safe to remove our owned_by
+        // directory
+        m_autosave.waitForFinished();
+        deleteOwnedSessions();
+    }
 
     if(isActive)
         m_autoSaveTimer.start();
@@ -499,6 +663,16 @@ QString KonqSessionManager::autosaveDirectory() const
     return m_autosaveDir;
 }
 
+void KonqSessionManager::markDirty(KonqMainWindow* window)
+{
+    m_windowStates.remove(window);
+}
+
+void KonqSessionManager::slotWindowDestroyed(QObject* window)
+{
+    m_windowStates.remove(window);
+}
+
 QStringList KonqSessionManager::takeSessionsOwnership()
 {
     // Tell to other konqueror instances that we are the one dealing with
@@ -581,8 +755,8 @@ void KonqSessionManager::restoreSession(const QString &sessionFilePath, bool
     if (!QFile::exists(sessionFilePath))
         return;
 
-    KConfig config(sessionFilePath, KConfig::SimpleConfig);
-    const QList<KConfigGroup> groups = windowConfigGroups(config);
+    QScopedPointer<KConfig> config(openSessionConfig(sessionFilePath));
+    const QList<KConfigGroup> groups = windowConfigGroups(*config);
     Q_FOREACH(const KConfigGroup& configGroup, groups) {
         if(!openTabsInsideCurrentWindow)
             KonqViewManager::openSavedWindow(configGroup)->show();
@@ -598,8 +772,8 @@ static void removeDiscardedSessions(const QStringList& sessionFiles, const QStri
     }
 
     Q_FOREACH(const QString& sessionFile, sessionFiles) {
-        KConfig config(sessionFile, KConfig::SimpleConfig);
-        QList<KConfigGroup> groups = windowConfigGroups(config);
+        QScopedPointer<KConfig> config(openSessionConfig(sessionFile));
+        QList<KConfigGroup> groups = windowConfigGroups(*config);
         for (int i = 0, count = groups.count(); i < count; ++i) {
             KConfigGroup& group = groups[i];
             const QString rootItem = group.readEntry("RootItem", "empty");
@@ -613,6 +787,11 @@ static void removeDiscardedSessions(const QStringList& sessionFiles, const QStri
             }
             group.writeEntry(viewsKey, views);
         }
+
+        // Files in the binary format have been imported into memory
+        if (config->name().isEmpty()) {
+            exportSessionFile(sessionFile, *config);
+        }
     }
 }
 
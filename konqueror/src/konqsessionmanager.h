@@ -25,6 +25,8 @@
 #include <QTimer>
 #include <QStringList>
 #include <QString>
+#include <QHash>
+#include <QtCore/QFuture>
 
 #include <kconfig.h>
 #include <kdialog.h>
@@ -160,6 +162,18 @@ public:
      */
     QString autosaveDirectory() const;
 
+    /**
+     * Tells the session manager that the state of @p window has changed,
+     * e.g. because one of its views opened another url. Only such windows
+     * and the active window are serialized again by autoSaveSession(),
+     * the last state of all other windows is reused.
+     */
+    void markDirty(KonqMainWindow* window);
+
+    // The entries of a window, as stored by the autosave. @internal
+    class WindowGroup;
+    typedef QList<WindowGroup> WindowState;
+
 public Q_SLOTS:
     /**
      * Ask the user with a KPassivePopup ballon if session should be restored
@@ -170,6 +184,9 @@ public Q_SLOTS:
      * Saves current session.
      * This is function is called by the autosave timer, but you can call it too
      * if you want. It won't do anything if m_autosaveEnabled is false.
+     *
+     * The session is written by a worker thread in a binary format,
+     * which is converted to a KConfig when restoring it.
      */
     void autoSaveSession();
 
@@ -206,7 +223,11 @@ private:
     QString m_baseService;
     bool m_autosaveEnabled;
     bool m_createdOwnedByDir;
-    KConfig* m_sessionConfig;
+    QString m_autosaveFilePath;
+    QFuture<bool> m_autosave;
+
+    // Last saved state of the windows which didn't change since then
+    QHash<QObject*, WindowState> m_windowStates;
 
 Q_SIGNALS: // DBUS signals
     /**
@@ -216,6 +237,9 @@ Q_SIGNALS: // DBUS signals
     void saveCurrentSession( const QString& path );
 private Q_SLOTS:// connected to DBUS signals
     void slotSaveCurrentSession( const QString& path );
+
+private Q_SLOTS:
+    void slotWindowDestroyed(QObject* window);
 };
 
 #endif /* KONQSESSIONMANAGER_H */
@@ -31,6 +31,7 @@
 #include "konqbrowseriface.h"
 #include "konqhistorymanager.h"
 #include "konqpixmapprovider.h"
+#include "konqsessionmanager.h"
 
 #include <kparts/statusbarextension.h>
 #include <kparts/browserextension.h>
@@ -111,6 +112,7 @@ KonqView::KonqView( KonqViewFactory &viewFactory,
 #endif
 
   switchView( viewFactory );
+  sessionChanged();
 }
 
 KonqView::~KonqView()
@@ -133,6 +135,8 @@ KonqView::~KonqView()
   qDeleteAll( m_lstHistory );
   m_lstHistory.clear();
 
+  sessionChanged();
+
   setRun( 0L );
   //kDebug() << this << "done";
 }
@@ -635,6 +639,7 @@ void KonqView::setLocationBarURL( const QString & locationBarURL )
 {
     //kDebug() << locationBarURL << "this=" << this;
     m_sLocationBarURL = locationBarURL;
+    sessionChanged();
     if (m_pMainWindow->currentView() == this) {
         //kDebug() << "is current view" << this;
         m_pMainWindow->setLocationBarURL( m_sLocationBarURL );
@@ -688,9 +693,15 @@ void KonqView::setCaption( const QString & caption )
   }
 
   m_caption = adjustedCaption;
+  sessionChanged();
   if (!m_bPassiveMode) frame()->setTitle( adjustedCaption , 0L );
 }
 
+void KonqView::sessionChanged()
+{
+  KonqSessionManager::self()->markDirty( m_pMainWindow );
+}
+
 void KonqView::slotOpenURLNotify()
 {
 #ifdef DEBUG_HISTORY
@@ -720,6 +731,7 @@ void KonqView::createHistoryEntry()
 #endif
     appendHistoryEntry( new HistoryEntry );
     setHistoryIndex( m_lstHistory.count()-1 ); // made current
+    sessionChanged();
 #ifdef DEBUG_HISTORY
     kDebug() << "at=" << historyIndex() << "count=" << m_lstHistory.count();
 #endif
@@ -812,6 +824,7 @@ void KonqView::go( int steps )
   stop();
 
   setHistoryIndex( newPos ); // sets current item
+  sessionChanged();
 
 #ifdef DEBUG_HISTORY
   kDebug() << "New position" << historyIndex();
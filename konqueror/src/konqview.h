@@ -482,6 +482,12 @@ private:
    */
   void createHistoryEntry();
 
+  /**
+   * Tells the session manager that the autosaved state of the
+   * main window has to be updated.
+   */
+  void sessionChanged();
+
   /**
    * Appends a entry in the history.
    */
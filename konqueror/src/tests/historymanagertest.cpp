@@ -125,3 +125,44 @@ void HistoryManagerTest::testAddHistoryEntry()
     QCOMPARE( entry.title, title );
     QCOMPARE( int(entry.numberOfTimesVisited), 1 );
 }
+
+static bool containsEntry( const KonqHistoryManager& mgr, const KUrl& url )
+{
+    QListIterator<KonqHistoryEntry> it( mgr.entries() );
+    while ( it.hasNext() ) {
+        if ( it.next().url == url )
+            return true;
+    }
+    return false;
+}
+
+void HistoryManagerTest::testJournalReplayAndClear()
+{
+    KonqHistoryManager mgr(0);
+    const KUrl url( "http://journal.historymgrtest.org/" );
+
+    KonqHistoryEntry entry;
+    entry.url = url;
+    entry.numberOfTimesVisited = 1;
+    entry.firstVisited = QDateTime::currentDateTime();
+    entry.lastVisited = entry.firstVisited;
+    mgr.emitAddToHistory( entry );
+    waitForAddedSignal( &mgr );
+    QVERIFY( containsEntry( mgr, url ) );
+
+    // The new entry is read back from the journal (or a compacted snapshot)
+    QVERIFY( mgr.loadHistory() );
+    QVERIFY( containsEntry( mgr, url ) );
+
+    QEventLoop eventLoop;
+    QObject::connect( &mgr, SIGNAL(cleared()), &eventLoop, SLOT(quit()) );
+    mgr.emitClear();
+    eventLoop.exec( QEventLoop::ExcludeUserInputEvents );
+    QVERIFY( mgr.entries().isEmpty() );
+
+    // The clearing has been stored immediately, even if the
+    // compaction of the history is still running
+    mgr.loadHistory();
+    QVERIFY( !containsEntry( mgr, url ) );
+    QVERIFY( mgr.entries().isEmpty() );
+}
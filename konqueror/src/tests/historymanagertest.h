@@ -30,6 +30,7 @@ private Q_SLOTS:
     void testGetSetMaxCount();
     void testGetSetMaxAge();
     void testAddHistoryEntry();
+    void testJournalReplayAndClear();
 };
 
 
@@ -0,0 +1,78 @@
+/* This file is part of the KDE project
+   Copyright 2014 the Konqueror developers
+
+   This library is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Library General Public License as published
+   by the Free Software Foundation; either version 2 of the License or
+   ( at your option ) version 3 or, at the discretion of KDE e.V.
+   ( which shall act as a proxy as in section 14 of the GPLv3 ), any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+
+#include "konq_historyindex_p.h"
+
+#include <algorithm>
+
+KonqHistoryIndex::KonqHistoryIndex()
+    : m_nextSequence(0)
+{
+}
+
+void KonqHistoryIndex::reset(const KonqHistoryList& list)
+{
+    clear();
+    m_sequenceByUrl.reserve(list.count());
+    m_sequences.reserve(list.count());
+    // Later duplicates win, like in KonqHistoryList::findEntry()
+    KonqHistoryList::const_iterator it = list.constBegin();
+    for (; it != list.constEnd(); ++it)
+        append((*it).url);
+}
+
+void KonqHistoryIndex::clear()
+{
+    m_sequenceByUrl.clear();
+    m_sequences.clear();
+}
+
+void KonqHistoryIndex::append(const KUrl& url)
+{
+    const quint64 sequence = m_nextSequence++;
+    m_sequenceByUrl.insert(key(url), sequence);
+    m_sequences.append(sequence);
+}
+
+void KonqHistoryIndex::removeAt(int position, const KUrl& url)
+{
+    Q_ASSERT(position >= 0 && position < m_sequences.count());
+    const quint64 sequence = m_sequences.takeAt(position);
+
+    // Keep the key if it refers to a later duplicate of the url
+    QHash<QString, quint64>::iterator it = m_sequenceByUrl.find(key(url));
+    if (it != m_sequenceByUrl.end() && it.value() == sequence)
+        m_sequenceByUrl.erase(it);
+}
+
+int KonqHistoryIndex::indexOf(const KUrl& url) const
+{
+    QHash<QString, quint64>::const_iterator it = m_sequenceByUrl.constFind(key(url));
+    if (it == m_sequenceByUrl.constEnd())
+        return -1;
+
+    const QList<quint64>::const_iterator begin = m_sequences.constBegin();
+    const QList<quint64>::const_iterator end = m_sequences.constEnd();
+    const QList<quint64>::const_iterator pos = std::lower_bound(begin, end, it.value());
+    if (pos == end || *pos != it.value())
+        return -1;
+    return pos - begin;
+}
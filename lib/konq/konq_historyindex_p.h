@@ -0,0 +1,82 @@
+/* This file is part of the KDE project
+   Copyright 2014 the Konqueror developers
+
+   This library is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Library General Public License as published
+   by the Free Software Foundation; either version 2 of the License or
+   ( at your option ) version 3 or, at the discretion of KDE e.V.
+   ( which shall act as a proxy as in section 14 of the GPLv3 ), any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KONQ_HISTORYINDEX_P_H
+#define KONQ_HISTORYINDEX_P_H
+
+#include "konq_historyentry.h"
+#include <QtCore/QHash>
+#include <QtCore/QList>
+
+/**
+ * Maps the urls of a KonqHistoryList to the position of their entries,
+ * so that KonqHistoryProvider doesn't have to traverse the whole list
+ * for each visited url.
+ *
+ * Each entry gets an increasing sequence number when it is appended.
+ * The sequence numbers of the entries are kept in list order, so the
+ * position of an url is found by a hash lookup and a binary search,
+ * and removing the first (oldest) entries doesn't need to renumber
+ * anything.
+ *
+ * The index doesn't own the list; the caller has to tell it about every
+ * change of the list.
+ *
+ * Exported for the benchmark only.
+ */
+class LIBKONQ_EXPORT KonqHistoryIndex
+{
+public:
+    KonqHistoryIndex();
+
+    /**
+     * Rebuilds the index for all entries of @p list.
+     */
+    void reset(const KonqHistoryList& list);
+    void clear();
+
+    /**
+     * To be called after an entry for @p url has been appended to the list.
+     */
+    void append(const KUrl& url);
+
+    /**
+     * To be called when the entry at @p position, whose url is @p url,
+     * is removed from the list.
+     */
+    void removeAt(int position, const KUrl& url);
+
+    /**
+     * @return the position of the most recently appended entry for @p url,
+     * or -1 if there is none.
+     */
+    int indexOf(const KUrl& url) const;
+
+    int count() const { return m_sequences.count(); }
+
+private:
+    static QString key(const KUrl& url) { return url.url(); }
+
+    QHash<QString, quint64> m_sequenceByUrl;
+    QList<quint64> m_sequences;          // in list order, ascending
+    quint64 m_nextSequence;
+};
+
+#endif /* KONQ_HISTORYINDEX_P_H */
@@ -21,9 +21,13 @@
 #include "konq_historyloader.h"
 #include <kdebug.h>
 #include <QFile>
+#include <QHash>
 #include <kstandarddirs.h>
 #include "konq_historyentry.h"
 #include <zlib.h> // for crc32
+#ifndef Q_OS_WIN
+#include <sys/file.h> // for flock
+#endif
 
 class KonqHistoryLoaderPrivate
 {
@@ -54,7 +58,25 @@ bool KonqHistoryLoader::loadHistory()
 {
     d->m_history.clear();
 
-    const QString filename = KStandardDirs::locateLocal("data", QLatin1String("konqueror/konq_history"));
+    const bool snapshotLoaded = loadSnapshot();
+    if (!snapshotLoaded && !QFile::exists(journalFileName()))
+        return false;
+
+    replayJournal(journalFileName());
+
+    //kDebug(1202) << "loaded:" << m_history.count() << "entries.";
+
+    qSort(d->m_history.begin(), d->m_history.end(), lastVisitedOrder);
+
+    // Theoretically, we should emit update() here, but as we only ever
+    // load items on startup up to now, this doesn't make much sense.
+    // emit KParts::HistoryProvider::update(some list);
+    return true;
+}
+
+bool KonqHistoryLoader::loadSnapshot()
+{
+    const QString filename = historyFileName();
     QFile file(filename);
     if (!file.open(QIODevice::ReadOnly)) {
 	if (file.exists())
@@ -62,8 +84,18 @@ bool KonqHistoryLoader::loadHistory()
 	return false;
     }
 
-    QDataStream fileStream(&file);
-    QByteArray data; // only used for version == 2
+    // Map the file instead of reading it, so that the entries
+    // are parsed without copying the whole file first.
+    QByteArray fileData;
+    const qint64 size = file.size();
+    const uchar* map = size > 0 ? file.map(0, size) : 0;
+    if (map)
+        fileData = QByteArray::fromRawData(reinterpret_cast<const char *>(map), size);
+    else
+        fileData = file.readAll();
+
+    QDataStream fileStream(fileData);
+    QByteArray data; // only used for version >= 2
     // we construct the stream object now but fill in the data later.
     QDataStream crcStream(&data, QIODevice::ReadOnly);
     KonqHistoryEntry::Flags flags = KonqHistoryEntry::NoFlags;
@@ -78,10 +110,15 @@ bool KonqHistoryLoader::loadHistory()
         bool crcOk = false;
 
         if (version >= 2 && version <= 4) {
-            quint32 crc;
+            quint32 crc = 0;
+            quint32 length = 0xffffffff;
             crcChecked = true;
-            fileStream >> crc >> data;
-            crcOk = crc32(0, reinterpret_cast<unsigned char *>(data.data()), data.size()) == crc;
+            fileStream >> crc >> length;
+            // Like operator>>(QByteArray), but referring to the mapped file
+            const int offset = 3 * sizeof(quint32);
+            if (fileStream.status() == QDataStream::Ok && length <= quint32(fileData.size() - offset))
+                data = QByteArray::fromRawData(fileData.constData() + offset, length);
+            crcOk = crc32(0, reinterpret_cast<const unsigned char *>(data.constData()), data.size()) == crc;
             stream = &crcStream; // pick up the right stream
         }
 
@@ -113,7 +150,6 @@ bool KonqHistoryLoader::loadHistory()
 
         if (historyVersion() != (int)version || (crcChecked && !crcOk)) {
 	    kWarning() << "The history version doesn't match, aborting loading" ;
-	    file.close();
 	    return false;
 	}
 
@@ -123,16 +159,91 @@ bool KonqHistoryLoader::loadHistory()
 	    // kDebug(1202) << "loaded entry:" << entry.url << ", Title:" << entry.title;
 	    d->m_history.append(entry);
 	}
+    }
 
-	//kDebug(1202) << "loaded:" << m_history.count() << "entries.";
+    return true;
+}
+
+void KonqHistoryLoader::replayJournal(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
 
-	qSort(d->m_history.begin(), d->m_history.end(), lastVisitedOrder);
+    const QByteArray journal = file.readAll();
+    if (!journal.startsWith(journalHeader())) {
+        kWarning() << "Ignoring history journal with unknown format" << fileName;
+        return;
     }
 
-    // Theoretically, we should emit update() here, but as we only ever
-    // load items on startup up to now, this doesn't make much sense.
-    // emit KParts::HistoryProvider::update(some list);
-    return true;
+    QDataStream stream(journal);
+    stream.skipRawData(journalHeader().size());
+
+    QHash<QString, int> positions;
+    for (int i = 0; i < d->m_history.count(); ++i)
+        positions.insert(d->m_history.at(i).url.url(), i);
+    bool removed = false;
+
+    while (!stream.atEnd()) {
+        quint32 crc;
+        QByteArray record;
+        stream >> crc >> record;
+        if (stream.status() != QDataStream::Ok || record.isEmpty() ||
+            crc32(0, reinterpret_cast<const unsigned char *>(record.constData()), record.size()) != crc) {
+            // Most likely the last record was only partly written
+            kWarning() << "The history journal is damaged, ignoring the remaining records";
+            break;
+        }
+
+        QDataStream recordStream(record);
+        quint8 type;
+        recordStream >> type;
+        switch (type) {
+        case AddRecord: {
+            KonqHistoryEntry entry;
+            entry.load(recordStream, KonqHistoryEntry::NoFlags);
+            const QString urlString = entry.url.url();
+            const QHash<QString, int>::const_iterator it = positions.constFind(urlString);
+            if (it != positions.constEnd()) {
+                d->m_history[it.value()] = entry;
+            } else {
+                positions.insert(urlString, d->m_history.count());
+                d->m_history.append(entry);
+            }
+            break;
+        }
+        case RemoveRecord: {
+            QString urlString;
+            recordStream >> urlString;
+            const QHash<QString, int>::iterator it = positions.find(urlString);
+            if (it != positions.end()) {
+                // Erased below, to keep the positions valid
+                d->m_history[it.value()].url = KUrl();
+                positions.erase(it);
+                removed = true;
+            }
+            break;
+        }
+        case ClearRecord:
+            d->m_history.clear();
+            positions.clear();
+            removed = false;
+            break;
+        default:
+            kWarning() << "Unknown record in the history journal:" << type;
+            break;
+        }
+    }
+
+    if (removed) {
+        KonqHistoryList::iterator it = d->m_history.begin();
+        while (it != d->m_history.end()) {
+            if ((*it).url.isEmpty())
+                it = d->m_history.erase(it);
+            else
+                ++it;
+        }
+    }
 }
 
 const KonqHistoryList& KonqHistoryLoader::entries() const
@@ -144,3 +255,58 @@ int KonqHistoryLoader::historyVersion()
 {
     return 4;
 }
+
+QByteArray KonqHistoryLoader::journalRecord(JournalRecordType type, const QByteArray& data)
+{
+    QByteArray record;
+    record.reserve(data.size() + 1);
+    record.append(char(type));
+    record.append(data);
+
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    stream << quint32(crc32(0, reinterpret_cast<const unsigned char *>(record.constData()), record.size()));
+    stream << record;
+    return result;
+}
+
+QByteArray KonqHistoryLoader::journalHeader()
+{
+    return QByteArray("KHJ1");
+}
+
+QString KonqHistoryLoader::historyFileName()
+{
+    return KStandardDirs::locateLocal("data", QLatin1String("konqueror/konq_history"));
+}
+
+QString KonqHistoryLoader::journalFileName()
+{
+    return KStandardDirs::locateLocal("data", QLatin1String("konqueror/konq_history.journal"));
+}
+
+QString KonqHistoryLoader::lockFileName()
+{
+    return KStandardDirs::locateLocal("data", QLatin1String("konqueror/konq_history.lock"));
+}
+
+KonqHistoryLock::KonqHistoryLock()
+    : m_file(KonqHistoryLoader::lockFileName())
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        kWarning() << "Can't open" << m_file.fileName();
+        return;
+    }
+#ifndef Q_OS_WIN
+    // The lock is released by the system if the process dies
+    ::flock(m_file.handle(), LOCK_EX);
+#endif
+}
+
+KonqHistoryLock::~KonqHistoryLock()
+{
+#ifndef Q_OS_WIN
+    if (m_file.isOpen())
+        ::flock(m_file.handle(), LOCK_UN);
+#endif
+}
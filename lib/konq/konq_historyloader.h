@@ -23,6 +23,8 @@
 
 #include "libkonq_export.h"
 #include <QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
 
 class KonqHistoryList;
 class KonqHistoryLoaderPrivate;
@@ -30,6 +32,15 @@ class KonqHistoryLoaderPrivate;
 /**
  * @internal
  * This class loads the Konqueror history file.
+ *
+ * The history consists of a snapshot (the version 4 history file) and a
+ * journal of the changes made since the snapshot was written. Each record
+ * of the journal has its own checksum, so that a record which was only
+ * partly written doesn't invalidate the whole history.
+ *
+ * The journal is only modified while a KonqHistoryLock is held, so that
+ * the records are never lost while the journal is compacted into a new
+ * snapshot by another process.
  * @since 4.3
  */
 class KonqHistoryLoader : public QObject
@@ -53,8 +64,47 @@ public:
 
     static int historyVersion();
 
+    enum JournalRecordType {
+        AddRecord = 1,    // the complete entry
+        RemoveRecord = 2, // the url of the removed entry
+        ClearRecord = 3   // no data
+    };
+
+    /**
+     * @returns the data to append to the journal for a record,
+     * including its checksum
+     */
+    static QByteArray journalRecord(JournalRecordType type, const QByteArray& data = QByteArray());
+
+    /**
+     * @returns the data that starts a new journal file
+     */
+    static QByteArray journalHeader();
+
+    static QString historyFileName();
+    static QString journalFileName();
+    static QString lockFileName();
+
 private:
+    bool loadSnapshot();
+    void replayJournal(const QString& fileName);
+
     KonqHistoryLoaderPrivate* const d;
 };
 
+/**
+ * @internal
+ * Locks the history files against other processes and threads
+ * as long as the object exists.
+ */
+class KonqHistoryLock
+{
+public:
+    KonqHistoryLock();
+    ~KonqHistoryLock();
+
+private:
+    QFile m_file;
+};
+
 #endif /* KONQ_HISTORYLOADER_H */
@@ -26,15 +26,22 @@
 #include <kconfiggroup.h>
 #include <ksharedconfig.h>
 #include "konq_historyloader.h"
+#include "konq_historyindex_p.h"
 #include <zlib.h> // for crc32
+#include <QtCore/QFuture>
+#include <QtCore/QtConcurrentRun>
 #include <QtDBus/QtDBus>
 
+// The journal gets compacted into a new snapshot when it is larger
+static const qint64 s_maximumJournalSize = 256 * 1024;
+
 class KonqHistoryProviderPrivate : public QObject, QDBusContext
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.Konqueror.HistoryManager")
 public:
     KonqHistoryProviderPrivate(KonqHistoryProvider* qq);
+    ~KonqHistoryProviderPrivate();
 
     /**
      * Resizes the history list to contain less or equal than m_maxCount
@@ -43,9 +50,26 @@ public:
     void adjustSize();
 
     /**
-     * Saves the entire history.
+     * Appends @p records (see KonqHistoryLoader::journalRecord()) to the
+     * journal and compacts the journal if it got too large.
      */
-    bool saveHistory();
+    void appendToJournal(const QByteArray& records);
+
+    /**
+     * Compacts the snapshot and the journal into a new snapshot
+     * in a worker thread, see saveHistory().
+     */
+    void compactHistory();
+
+    /**
+     * Saves the history from the current snapshot and journal as a new
+     * snapshot without the entries exceeding @p maxCount or @p maxAgeDays,
+     * and removes the journal. Invoked in a worker thread.
+     *
+     * The files are read instead of using m_history, as other processes
+     * might have appended records which have not been received yet.
+     */
+    static bool saveHistory(int maxCount, int maxAgeDays);
 
 Q_SIGNALS: // DBUS methods/signals,  they have to match org.kde.Konqueror.HistoryManager.xml
     friend class KonqHistoryProvider;
@@ -105,8 +129,10 @@ public:
     }
 
     KonqHistoryList m_history;
+    KonqHistoryIndex m_index; // has to be updated on every change of m_history
     int m_maxCount;   // maximum of history entries
     int m_maxAgeDays; // maximum age of a history entry
+    QFuture<bool> m_compaction;
     KonqHistoryProvider* q;
 };
 
@@ -132,6 +158,11 @@ KonqHistoryProviderPrivate::KonqHistoryProviderPrivate(KonqHistoryProvider* qq)
     dbus.connect(QString(), dbusPath, dbusInterface, "notifyRemoveList", this, SLOT(slotNotifyRemoveList(QStringList)));
 }
 
+KonqHistoryProviderPrivate::~KonqHistoryProviderPrivate()
+{
+    m_compaction.waitForFinished();
+}
+
 ////
 
 KonqHistoryProvider::KonqHistoryProvider(QObject* parent)
@@ -151,12 +182,14 @@ const KonqHistoryList& KonqHistoryProvider::entries() const
 
 bool KonqHistoryProvider::loadHistory()
 {
+    KonqHistoryLock lock;
     KonqHistoryLoader loader;
     if (!loader.loadHistory()) {
         return false;
     }
 
     d->m_history = loader.entries();
+    d->m_index.reset(d->m_history);
 
     d->adjustSize();
 
@@ -280,9 +313,10 @@ void KonqHistoryProviderPrivate::slotNotifyHistoryEntry(const QByteArray& data)
     entry.numberOfTimesVisited += e.numberOfTimesVisited;
     entry.lastVisited = e.lastVisited;
 
-    if (newEntry)
+    if (newEntry) {
         m_history.append(entry);
-    else {
+        m_index.append(entry.url);
+    } else {
         *existingEntry = entry;
     }
 
@@ -303,7 +337,7 @@ void KonqHistoryProviderPrivate::slotNotifyMaxCount(int count)
     cs.writeEntry("Maximum of History entries", m_maxCount);
 
     if (isSenderOfSignal(message())) {
-	saveHistory();
+	compactHistory();
 	cs.sync();
     }
 }
@@ -318,7 +352,7 @@ void KonqHistoryProviderPrivate::slotNotifyMaxAge(int days)
     cs.writeEntry("Maximum age of History entries", m_maxAgeDays);
 
     if (isSenderOfSignal(message())) {
-	saveHistory();
+	compactHistory();
 	cs.sync();
     }
 }
@@ -326,9 +360,14 @@ void KonqHistoryProviderPrivate::slotNotifyMaxAge(int days)
 void KonqHistoryProviderPrivate::slotNotifyClear()
 {
     m_history.clear();
+    m_index.clear();
 
-    if (isSenderOfSignal(message()))
-	saveHistory();
+    if (isSenderOfSignal(message())) {
+        // Write the clearing synchronously, so that the old entries don't
+        // come back if the process dies before the compaction is done
+        appendToJournal(KonqHistoryLoader::journalRecord(KonqHistoryLoader::ClearRecord));
+	compactHistory();
+    }
 
     q->KParts::HistoryProvider::clear(); // also emits the cleared() signal
 }
@@ -341,26 +380,33 @@ void KonqHistoryProviderPrivate::slotNotifyRemove(const QString& urlStr)
     if (existingEntry != m_history.end()) {
         q->removeEntry(existingEntry);
 	if (isSenderOfSignal(message())) {
-	    saveHistory();
+            QByteArray data;
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream << url.url();
+	    appendToJournal(KonqHistoryLoader::journalRecord(KonqHistoryLoader::RemoveRecord, data));
         }
     }
 }
 
 void KonqHistoryProviderPrivate::slotNotifyRemoveList(const QStringList& urls)
 {
-    bool doSave = false;
+    QByteArray records;
     QStringList::const_iterator it = urls.begin();
     for (; it != urls.end(); ++it) {
         KUrl url(*it);
-        KonqHistoryList::iterator existingEntry = m_history.findEntry(url);
+        KonqHistoryList::iterator existingEntry = q->findEntry(url);
         if (existingEntry != m_history.end()) {
             q->removeEntry(existingEntry);
-            doSave = true;
+
+            QByteArray data;
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream << url.url();
+            records += KonqHistoryLoader::journalRecord(KonqHistoryLoader::RemoveRecord, data);
 	}
     }
 
-    if (doSave && isSenderOfSignal(message())) {
-        saveHistory();
+    if (!records.isEmpty() && isSenderOfSignal(message())) {
+        appendToJournal(records);
     }
 }
 
@@ -371,6 +417,7 @@ void KonqHistoryProvider::removeEntry(KonqHistoryList::iterator existingEntry)
 
     KParts::HistoryProvider::remove(urlString);
 
+    d->m_index.removeAt(existingEntry - d->m_history.begin(), entry.url);
     d->m_history.erase(existingEntry);
     emit entryRemoved(entry);
 }
@@ -385,10 +432,58 @@ int KonqHistoryProvider::maxAge() const
      return d->m_maxAgeDays;
 }
 
-bool KonqHistoryProviderPrivate::saveHistory()
+void KonqHistoryProviderPrivate::appendToJournal(const QByteArray& records)
+{
+    qint64 journalSize;
+    {
+        // Wait until a compaction of another process is done
+        KonqHistoryLock lock;
+
+        QFile file(KonqHistoryLoader::journalFileName());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            kWarning() << "Can't open " << file.fileName();
+            return;
+        }
+
+        // A single write, so that a record is either complete or at the end of the file
+        const QByteArray data = file.size() == 0 ? KonqHistoryLoader::journalHeader() + records : records;
+        if (file.write(data) != data.size()) {
+            kWarning() << "Can't write " << file.fileName();
+        }
+        journalSize = file.size();
+    }
+
+    // A running compaction is not waited for, the next entry compacts the journal then
+    if (journalSize > s_maximumJournalSize && !m_compaction.isRunning()) {
+        compactHistory();
+    }
+}
+
+void KonqHistoryProviderPrivate::compactHistory()
 {
-    const QString filename = KStandardDirs::locateLocal("data", QLatin1String("konqueror/konq_history"));
-    KSaveFile file(filename);
+    m_compaction.waitForFinished();
+    m_compaction = QtConcurrent::run(&KonqHistoryProviderPrivate::saveHistory, m_maxCount, m_maxAgeDays);
+}
+
+bool KonqHistoryProviderPrivate::saveHistory(int maxCount, int maxAgeDays)
+{
+    // Other processes neither append to the journal nor compact it meanwhile
+    KonqHistoryLock lock;
+
+    KonqHistoryLoader loader;
+    KonqHistoryList history = loader.entries();
+
+    // Like adjustSize(), the entries are sorted by date
+    const QDateTime expirationDate(QDate::currentDate().addDays(-maxAgeDays));
+    while (!history.isEmpty() &&
+           (history.count() > maxCount ||
+            (maxAgeDays > 0 && history.first().lastVisited.isValid() &&
+             history.first().lastVisited < expirationDate))) {
+        history.removeFirst();
+    }
+
+    const QString fileName = KonqHistoryLoader::historyFileName();
+    KSaveFile file(fileName);
     if (!file.open()) {
         kWarning() << "Can't open " << file.fileName() ;
         return false;
@@ -400,7 +495,7 @@ bool KonqHistoryProviderPrivate::saveHistory()
     QByteArray data;
     QDataStream stream(&data, QIODevice::WriteOnly);
 
-    QListIterator<KonqHistoryEntry> it(m_history);
+    QListIterator<KonqHistoryEntry> it(history);
     while (it.hasNext()) {
         //We use QUrl for marshalling URLs in entries in the V4
         //file format
@@ -410,33 +505,36 @@ bool KonqHistoryProviderPrivate::saveHistory()
     quint32 crc = crc32(0, reinterpret_cast<unsigned char *>(data.data()), data.size());
     fileStream << crc << data;
 
-    file.finalize(); //check for error here?
+    if (!file.finalize()) {
+        kWarning() << "Can't save " << fileName;
+        return false;
+    }
 
+    // The records of the journal are part of the snapshot now
+    QFile::remove(KonqHistoryLoader::journalFileName());
     return true;
 }
 
 KonqHistoryList::iterator KonqHistoryProvider::findEntry(const KUrl& url)
 {
-    // small optimization (dict lookup) for items _not_ in our history
-    if (!KParts::HistoryProvider::contains(url.url()))
-        return d->m_history.end();
-    return d->m_history.findEntry(url);
+    const int position = d->m_index.indexOf(url);
+    return position < 0 ? d->m_history.end() : d->m_history.begin() + position;
 }
 
 KonqHistoryList::const_iterator KonqHistoryProvider::constFindEntry(const KUrl& url) const
 {
-    // small optimization (dict lookup) for items _not_ in our history
-    if (!KParts::HistoryProvider::contains(url.url()))
-        return d->m_history.constEnd();
-    return d->m_history.constFindEntry(url);
+    const int position = d->m_index.indexOf(url);
+    return position < 0 ? d->m_history.constEnd() : d->m_history.constBegin() + position;
 }
 
 void KonqHistoryProvider::finishAddingEntry(const KonqHistoryEntry& entry, bool isSender)
 {
-    Q_UNUSED(entry); // this arg is used by konq's reimplementation
     if (isSender) {
 	// we are the sender of the broadcast, so we save
-	d->saveHistory();
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        entry.save(stream, KonqHistoryEntry::NoFlags);
+	d->appendToJournal(KonqHistoryLoader::journalRecord(KonqHistoryLoader::AddRecord, data));
     }
 }
 
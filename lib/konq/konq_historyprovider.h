@@ -138,10 +138,10 @@ protected: // only to be used by konqueror's KonqHistoryManager
     virtual void removeEntry(KonqHistoryList::iterator it);
 
     /**
-     * a little optimization for KonqHistoryList::findEntry(),
-     * checking the dict of KParts::HistoryProvider before traversing the list.
+     * Like KonqHistoryList::findEntry(), but looks up the url in an index
+     * instead of traversing the list.
      * Can't be used everywhere, because it always returns end() for "pending"
-     * entries, as those are not added to the dict, currently.
+     * entries, as those are not part of entries(), currently.
      */
     KonqHistoryList::iterator findEntry(const KUrl& url);
     KonqHistoryList::const_iterator constFindEntry(const KUrl& url) const;
@@ -0,0 +1,146 @@
+/* This file is part of the KDE project
+   Copyright 2014 the Konqueror developers
+
+   This library is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Library General Public License as published
+   by the Free Software Foundation; either version 2 of the License or
+   ( at your option ) version 3 or, at the discretion of KDE e.V.
+   ( which shall act as a proxy as in section 14 of the GPLv3 ), any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include <qtest_kde.h>
+
+#include <konq_historyentry.h>
+#include "konq_historyindex_p.h"
+
+static const int s_entryCount = 100000;
+
+class KonqHistoryIndexBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkAdd();
+    void benchmarkLookup();
+    void benchmarkLinearLookup();
+    void benchmarkExpire();
+    void testConsistency();
+
+private:
+    void fill(KonqHistoryList& list, KonqHistoryIndex& index) const;
+
+    KUrl::List m_urls;
+};
+
+QTEST_KDEMAIN_CORE(KonqHistoryIndexBenchmark)
+
+void KonqHistoryIndexBenchmark::initTestCase()
+{
+    m_urls.reserve(s_entryCount);
+    for (int i = 0; i < s_entryCount; ++i)
+        m_urls.append(KUrl(QString("http://www.kde%1.org/page/%2.html").arg(i % 1000).arg(i)));
+}
+
+void KonqHistoryIndexBenchmark::fill(KonqHistoryList& list, KonqHistoryIndex& index) const
+{
+    KonqHistoryEntry entry;
+    foreach (const KUrl& url, m_urls) {
+        entry.url = url;
+        list.append(entry);
+        index.append(url);
+    }
+}
+
+void KonqHistoryIndexBenchmark::benchmarkAdd()
+{
+    QBENCHMARK {
+        KonqHistoryList list;
+        KonqHistoryIndex index;
+        fill(list, index);
+    }
+}
+
+void KonqHistoryIndexBenchmark::benchmarkLookup()
+{
+    KonqHistoryList list;
+    KonqHistoryIndex index;
+    fill(list, index);
+
+    QBENCHMARK {
+        foreach (const KUrl& url, m_urls) {
+            const int position = index.indexOf(url);
+            QVERIFY(position >= 0);
+        }
+    }
+}
+
+void KonqHistoryIndexBenchmark::benchmarkLinearLookup()
+{
+    // For comparison: only every 100th url, the whole run would take minutes
+    KonqHistoryList list;
+    KonqHistoryIndex index;
+    fill(list, index);
+
+    QBENCHMARK {
+        for (int i = 0; i < s_entryCount; i += 100)
+            QVERIFY(list.constFindEntry(m_urls.at(i)) != list.constEnd());
+    }
+}
+
+void KonqHistoryIndexBenchmark::benchmarkExpire()
+{
+    QBENCHMARK {
+        KonqHistoryList list;
+        KonqHistoryIndex index;
+        fill(list, index);
+        // What KonqHistoryProvider does when all entries are expired
+        while (!list.isEmpty()) {
+            index.removeAt(0, list.first().url);
+            list.erase(list.begin());
+        }
+    }
+}
+
+void KonqHistoryIndexBenchmark::testConsistency()
+{
+    KonqHistoryList list;
+    KonqHistoryIndex index;
+    fill(list, index);
+
+    // Remove some entries in the middle and expire the oldest ones
+    for (int i = s_entryCount / 2; i < s_entryCount / 2 + 100; ++i) {
+        const int position = index.indexOf(m_urls.at(i));
+        QCOMPARE(position, s_entryCount / 2);
+        index.removeAt(position, m_urls.at(i));
+        list.removeAt(position);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        index.removeAt(0, list.first().url);
+        list.removeFirst();
+    }
+    QCOMPARE(index.count(), list.count());
+
+    for (int i = 0; i < list.count(); i += 97)
+        QCOMPARE(index.indexOf(list.at(i).url), i);
+    QCOMPARE(index.indexOf(m_urls.at(0)), -1);
+    QCOMPARE(index.indexOf(m_urls.at(s_entryCount / 2)), -1);
+
+    // A rebuilt index gives the same positions
+    KonqHistoryIndex rebuilt;
+    rebuilt.reset(list);
+    for (int i = 0; i < list.count(); i += 97)
+        QCOMPARE(rebuilt.indexOf(list.at(i).url), i);
+}
+
+#include "konqhistoryindexbenchmark.moc"
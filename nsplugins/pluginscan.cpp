@@ -30,6 +30,7 @@
 #include <sys/wait.h>
 
 #include <errno.h>
+#include <poll.h>
 #include <signal.h>
 #include <unistd.h>
 
@@ -38,6 +39,10 @@
 #include <QTextStream>
 #include <QRegExp>
 #include <QBuffer>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QVector>
 
 #include <QtDBus/QtDBus>
 
@@ -56,7 +61,9 @@
 #include <kaboutdata.h>
 #include <klocale.h>
 #include <kprocess.h>
+#include <ksavefile.h>
 #include <ksycoca.h>
+#include <kde_file.h>
 
 #include "sdk/npfunctions.h"
 
@@ -301,8 +308,94 @@ static int tryCheck(int write_fd, const QString &absFile)
     return 0;
 }
 
-void scanDirectory( const QString &dir, QStringList &mimeInfoList,
-                    QTextStream &cache )
+/**
+ * The result of loading a plugin library in a child process. Probes are
+ * cached, so that only new and changed libraries have to be loaded again.
+ */
+struct PluginProbe
+{
+    PluginProbe() : probed(false), valid(false), mtime(0), size(0), inode(0) {}
+
+    bool probed; // false if the library could not be loaded in a child process
+    bool valid; // false if the library is no plugin or crashed
+    QString name;
+    QString description;
+    QString mimeInfo;
+
+    // identify the version of the library that has been probed
+    qint64 mtime;
+    qint64 size;
+    quint64 inode;
+};
+
+static const quint32 s_probeCacheVersion = 1;
+
+static QString probeCacheFileName()
+{
+    return KGlobal::dirs()->saveLocation("data", "nsplugins") + "/probecache";
+}
+
+static QHash<QString, PluginProbe> loadProbeCache()
+{
+    QHash<QString, PluginProbe> probes;
+
+    QFile file(probeCacheFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return probes;
+
+    QDataStream stream(&file);
+    quint32 version, count;
+    stream >> version >> count;
+    if (version != s_probeCacheVersion)
+        return probes;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        PluginProbe probe;
+        stream >> path >> probe.valid >> probe.name >> probe.description >> probe.mimeInfo
+               >> probe.mtime >> probe.size >> probe.inode;
+        probe.probed = true;
+        probes.insert(path, probe);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        kDebug(1433) << "Ignoring damaged probe cache";
+        probes.clear();
+    }
+    return probes;
+}
+
+static void saveProbeCache(const QHash<QString, PluginProbe> &probes)
+{
+    KSaveFile file(probeCacheFileName());
+    if (!file.open())
+        return;
+
+    // Libraries that could not be probed, e.g. because fork() failed,
+    // are not stored, so that they are probed again on the next scan
+    quint32 count = 0;
+    QHash<QString, PluginProbe>::const_iterator it = probes.constBegin();
+    for (; it != probes.constEnd(); ++it) {
+        if (it->probed)
+            ++count;
+    }
+
+    QDataStream stream(&file);
+    stream << s_probeCacheVersion << count;
+    for (it = probes.constBegin(); it != probes.constEnd(); ++it) {
+        const PluginProbe &probe = it.value();
+        if (!probe.probed)
+            continue;
+        stream << it.key() << probe.valid << probe.name << probe.description << probe.mimeInfo
+               << probe.mtime << probe.size << probe.inode;
+    }
+    file.finalize();
+}
+
+/**
+ * Appends the libraries in @p dir and its sub directories to @p libraries.
+ */
+void scanDirectory( const QString &dir, QStringList &libraries )
 {
     kDebug(1433) << "-> scanDirectory dir=" << dir;
 
@@ -338,98 +431,7 @@ void scanDirectory( const QString &dir, QStringList &mimeInfoList,
             continue;
 
         // get absolute file path
-        QString absFile = files.absoluteFilePath( files[i] );
-        kDebug(1433) << "Checking library " << absFile;
-
-        // open the library and ask for the mimetype
-        kDebug(1433) << " - opening " << absFile;
-
-        cache.flush();
-        // fork, so that a crash in the plugin won't stop the scanning of other plugins
-        int pipes[2];
-        if (pipe(pipes) != 0) continue;
-
-        int loader_pid = fork();
-
-        if (loader_pid == -1) {
-            // unable to fork
-            continue;
-        } else if (loader_pid == 0) {
-           // inside the child
-           close(pipes[0]);
-           KCrash::setCrashHandler(segv_handler);
-           _exit(tryCheck(pipes[1], absFile));
-        } else {
-           close(pipes[1]);
-
-           QBuffer m_buffer;
-           m_buffer.open(QIODevice::WriteOnly);
-
-           QFile q_read_pipe;
-           q_read_pipe.open(pipes[0], QIODevice::ReadOnly);
-
-           char *data = (char *)malloc(4096);
-           if (!data) continue;
-           int size;
-
-           // when the child closes, we'll get an EOF (size == 0)
-           while ((size = q_read_pipe.read(data, 4096)) > 0)
-               m_buffer.write(data, size);
-           free(data);
-
-           q_read_pipe.close();
-           close(pipes[0]); // we no longer need the pipe's reading end
-
-           // close the buffer and open for reading (from the start)
-           m_buffer.close();
-           m_buffer.open(QIODevice::ReadOnly);
-
-           // create a QDataStream for our buffer
-           QDataStream stream(&m_buffer);
-
-           if (stream.atEnd()) continue;
-
-           QString name, description, mimeInfo;
-           stream >> name;
-           stream >> description;
-           stream >> mimeInfo;
-
-           bool actuallyUsing = false;
-
-           // get mime types from string
-           QStringList types = mimeInfo.split( ';' );
-           QStringList::const_iterator type;
-           for ( type=types.constBegin(); type!=types.constEnd(); ++type ) {
-
-              kDebug(1433) << " - type=" << *type;
-              name = name.replace( ':', "%3A" );
-
-              QString entry = name + ':' + (*type).trimmed();
-              if ( !mimeInfoList.contains( entry ) ) {
-                  if (!actuallyUsing) {
-                      // note the plugin name
-                      cache << "[" << absFile << "]" << endl;
-                      actuallyUsing = true;
-                  }
-
-                  // write into type cache
-                  QStringList tokens = (*type).split(':', QString::KeepEmptyParts);
-                  QStringList::const_iterator token;
-                  token = tokens.constBegin();
-                  cache << (*token).toLower();
-                  ++token;
-                  for ( ; token!=tokens.constEnd(); ++token )
-                      cache << ":" << *token;
-                  cache << endl;
-
-                  // append type to MIME type list
-                  mimeInfoList.append( entry );
-              }
-           }
-
-           // register plugin for javascript
-           registerPlugin( name, description, files[i], mimeInfo );
-        }
+        libraries.append( files.absoluteFilePath( files[i] ) );
     }
 
     // iterate over all sub directories
@@ -443,13 +445,218 @@ void scanDirectory( const QString &dir, QStringList &mimeInfoList,
     depth++;
     for ( unsigned int i=0; i<dirs.count(); i++ ) {
         if ( depth<8 && !dirs[i].contains(".") )
-            scanDirectory( dirs.absoluteFilePath(dirs[i]), mimeInfoList, cache );
+            scanDirectory( dirs.absoluteFilePath(dirs[i]), libraries );
     }
     depth--;
 
     kDebug() << "<- scanDirectory dir=" << dir;
 }
 
+/**
+ * Loads the libraries @p libraries in child processes, so that a crash in
+ * a plugin won't stop the scanning of other plugins. Several children are
+ * run at the same time, their results are stored in @p probes. Probes of
+ * libraries whose child could not be started or finished stay unprobed.
+ */
+static void probeLibraries( const QStringList &libraries, QHash<QString, PluginProbe> &probes )
+{
+    struct Child {
+        QString file;
+        int fd;
+        QByteArray data;
+    };
+
+    const int maxChildren = qBound(2, QThread::idealThreadCount(), 8);
+    QList<Child> children;
+    int next = 0;
+    int done = 0;
+
+    while ( next<libraries.count() || !children.isEmpty() ) {
+        // start as many children as allowed
+        while ( children.count()<maxChildren && next<libraries.count() ) {
+            const QString absFile = libraries[next++];
+            kDebug(1433) << " - opening " << absFile;
+
+            int pipes[2];
+            if (pipe(pipes) != 0) {
+                ++done;
+                continue;
+            }
+
+            int loader_pid = fork();
+
+            if (loader_pid == -1) {
+                // unable to fork
+                close(pipes[0]);
+                close(pipes[1]);
+                ++done;
+                continue;
+            } else if (loader_pid == 0) {
+                // inside the child
+                close(pipes[0]);
+                KCrash::setCrashHandler(segv_handler);
+                _exit(tryCheck(pipes[1], absFile));
+            }
+
+            close(pipes[1]);
+            Child child;
+            child.file = absFile;
+            child.fd = pipes[0];
+            children.append(child);
+        }
+
+        if ( children.isEmpty() )
+            continue;
+
+        // wait until one of the children sent data or closed its pipe
+        QVector<pollfd> fds(children.count());
+        for (int i = 0; i < children.count(); ++i) {
+            fds[i].fd = children[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        if (poll(fds.data(), fds.count(), -1) < 0) {
+            if (errno == EINTR) // SIGCHLD
+                continue;
+            kWarning() << "poll failed";
+            break;
+        }
+
+        for (int i = children.count() - 1; i >= 0; --i) {
+            if (!fds[i].revents)
+                continue;
+
+            char data[4096];
+            const ssize_t size = read(children[i].fd, data, sizeof(data));
+            if (size > 0) {
+                children[i].data.append(data, size);
+                continue;
+            }
+            if (size < 0 && errno == EINTR)
+                continue;
+
+            // when the child closes, we'll get an EOF (size == 0)
+            close(children[i].fd);
+
+            PluginProbe &probe = probes[children[i].file];
+            QDataStream stream(children[i].data);
+            probe.probed = true;
+            probe.valid = !stream.atEnd();
+            if (probe.valid) {
+                stream >> probe.name;
+                stream >> probe.description;
+                stream >> probe.mimeInfo;
+            }
+            children.removeAt(i);
+
+            ++done;
+            if (showProgress) {
+                printf("%d\n", 25 + (50*done) / libraries.count()); fflush(stdout);
+            }
+        }
+    }
+
+    foreach (const Child &child, children)
+        close(child.fd);
+}
+
+/**
+ * Adds the MIME types of the plugin @p absFile to @p mimeInfoList and @p cache.
+ */
+static void addPlugin( const QString &absFile, const PluginProbe &probe,
+                       QStringList &mimeInfoList, QTextStream &cache )
+{
+    QString name = probe.name;
+    bool actuallyUsing = false;
+
+    // get mime types from string
+    QStringList types = probe.mimeInfo.split( ';' );
+    QStringList::const_iterator type;
+    for ( type=types.constBegin(); type!=types.constEnd(); ++type ) {
+
+        kDebug(1433) << " - type=" << *type;
+        name = name.replace( ':', "%3A" );
+
+        QString entry = name + ':' + (*type).trimmed();
+        if ( !mimeInfoList.contains( entry ) ) {
+            if (!actuallyUsing) {
+                // note the plugin name
+                cache << "[" << absFile << "]" << endl;
+                actuallyUsing = true;
+            }
+
+            // write into type cache
+            QStringList tokens = (*type).split(':', QString::KeepEmptyParts);
+            QStringList::const_iterator token;
+            token = tokens.constBegin();
+            cache << (*token).toLower();
+            ++token;
+            for ( ; token!=tokens.constEnd(); ++token )
+                cache << ":" << *token;
+            cache << endl;
+
+            // append type to MIME type list
+            mimeInfoList.append( entry );
+        }
+    }
+
+    // register plugin for javascript
+    registerPlugin( name, probe.description, QFileInfo(absFile).fileName(), probe.mimeInfo );
+}
+
+/**
+ * Scans @p searchPaths for plugins. Only libraries which are new or have
+ * been changed since the last scan are loaded.
+ */
+void scanPlugins( const QStringList &searchPaths, QStringList &mimeInfoList, QTextStream &cache )
+{
+    QStringList libraries;
+    kDebug(1433) << "Scanning directories" << searchPaths;
+    for ( QStringList::const_iterator it = searchPaths.constBegin();
+          it != searchPaths.constEnd(); ++it)
+    {
+        if ((*it).isEmpty())
+            continue;
+        scanDirectory( *it, libraries );
+    }
+    libraries.removeDuplicates();
+
+    if (showProgress) {
+      printf("25\n"); fflush(stdout);
+    }
+
+    const QHash<QString, PluginProbe> cachedProbes = loadProbeCache();
+    QHash<QString, PluginProbe> probes;
+    QStringList changedLibraries;
+    foreach (const QString &absFile, libraries) {
+        KDE_struct_stat buff;
+        if (KDE_stat(QFile::encodeName(absFile).constData(), &buff) != 0)
+            continue;
+
+        PluginProbe probe = cachedProbes.value(absFile);
+        if (probe.mtime != buff.st_mtime || probe.size != buff.st_size || probe.inode != buff.st_ino) {
+            kDebug(1433) << "Checking library " << absFile;
+            probe = PluginProbe();
+            probe.mtime = buff.st_mtime;
+            probe.size = buff.st_size;
+            probe.inode = buff.st_ino;
+            changedLibraries.append(absFile);
+        }
+        probes.insert(absFile, probe);
+    }
+
+    probeLibraries( changedLibraries, probes );
+    if (!changedLibraries.isEmpty() || probes.count() != cachedProbes.count())
+        saveProbeCache( probes );
+
+    // merge the results in the order of the search paths
+    foreach (const QString &absFile, libraries) {
+        const QHash<QString, PluginProbe>::const_iterator it = probes.constFind(absFile);
+        if (it != probes.constEnd() && it->valid)
+            addPlugin( absFile, *it, mimeInfoList, cache );
+    }
+}
+
 
 void writeServicesFile( const QStringList &mimeTypes )
 {
@@ -508,7 +715,8 @@ void sigChildHandler(int)
    // (Richard Stevens, Advanced programming in the Unix Environment)
    int saved_errno = errno;
 
-   while (waitpid(-1, 0, WNOHANG) == 0)
+   // reap all exited children, without waiting for the ones still running
+   while (waitpid(-1, 0, WNOHANG) > 0)
    	;
 
    errno = saved_errno;
@@ -564,31 +772,17 @@ int main( int argc, char **argv )
                               "/pluginsinfo" );
     infoConfig->group("<default>").writeEntry( "number", 0 );
 
-    // open the cache file for the mime information
+    // the mime information is collected in memory and only written
+    // to the cache file if it changed
     QString cacheName = KGlobal::dirs()->saveLocation("data", "nsplugins")+"/cache";
-    kDebug(1433) << "Creating MIME cache file " << cacheName;
-    QFile cachef(cacheName);
-    if (!cachef.open(QIODevice::WriteOnly))
-        return -1;
-    QTextStream cache(&cachef);
+    QString cacheContent;
+    QTextStream cache(&cacheContent);
     if (showProgress) {
       printf("20\n"); fflush(stdout);
     }
 
     // read in the plugins mime information
-    kDebug(1433) << "Scanning directories" << searchPaths;
-    int count = searchPaths.count();
-    int i = 0;
-    for ( QStringList::const_iterator it = searchPaths.constBegin();
-          it != searchPaths.constEnd(); ++it, ++i)
-    {
-        if ((*it).isEmpty())
-            continue;
-        scanDirectory( *it, mimeInfoList, cache );
-        if (showProgress) {
-          printf("%d\n", 25 + (50*i) / count ); fflush(stdout);
-        }
-    }
+    scanPlugins( searchPaths, mimeInfoList, cache );
 
     if (showProgress) {
       printf("75\n"); fflush(stdout);
@@ -658,9 +852,16 @@ int main( int argc, char **argv )
       printf("85\n"); fflush(stdout);
     }
 
-    // close files
-    kDebug(1433) << "Closing cache file";
-    cachef.close();
+    // write the cache file, replacing the old one atomically
+    cache.flush();
+    QFile oldCache(cacheName);
+    const QByteArray cacheData = cacheContent.toLocal8Bit();
+    if (!oldCache.open(QIODevice::ReadOnly) || oldCache.readAll() != cacheData) {
+        kDebug(1433) << "Creating MIME cache file " << cacheName;
+        KSaveFile cachef(cacheName);
+        if (!cachef.open() || cachef.write(cacheData) != cacheData.size() || !cachef.finalize())
+            return -1;
+    }
 
     infoConfig->sync();
     delete infoConfig;
@@ -1583,9 +1583,14 @@ void NSPluginClass::destroyInstance( NSPluginInstance* inst )
 
 /****************************************************************************/
 
+// The KIO job is suspended while more data than this waits for the plugin,
+// and resumed when the plugin has consumed all but s_resumeQueuedBytes.
+static const qint64 s_maximumQueuedBytes = 512 * 1024;
+static const qint64 s_resumeQueuedBytes = 128 * 1024;
+
 NSPluginStreamBase::NSPluginStreamBase( NSPluginInstance *instance )
    : QObject( instance ), _instance(instance), _stream(0), _tempFile(0L),
-     _pos(0), _queuePos(0), _error(false)
+     _pos(0), _queuePos(0), _queuedBytes(0), _error(false)
 {
    _informed = false;
 }
@@ -1668,6 +1673,8 @@ bool NSPluginStreamBase::create( const QString& url, const QString& mimeType, vo
     _streamType = NP_NORMAL;
     _informed = false;
     _forceNotify = forceNotify;
+    _statistics = Statistics();
+    _clock.start();
 
     // create new stream
     _stream = new NPStream;
@@ -1735,9 +1742,9 @@ int NSPluginStreamBase::process( const QByteArray &data, int start )
 }
 
 
-bool NSPluginStreamBase::pump()
+bool NSPluginStreamBase::pump( bool retry )
 {
-    //kDebug(1431) << "queue pos " << _queuePos << ", size " << _queue.size();
+    //kDebug(1431) << "queue pos " << _queuePos << ", chunks " << _queue.count() << ", bytes " << _queuedBytes;
 
     inform();
 
@@ -1745,47 +1752,63 @@ bool NSPluginStreamBase::pump()
     if (_instance->hasPendingJSRequests())
        return false;
 
-    if ( _queuePos<_queue.size() ) {
+    bool progress = false;
+    while ( !_queue.isEmpty() && !_error ) {
+        const Chunk &chunk = _queue.head();
         int newPos;
 
         // handle AS_FILE_ONLY streams
         if ( _onlyAsFile ) {
             if (_tempFile) {
-                _tempFile->write( _queue, _queue.size() );
-	    }
-            newPos = _queuePos+_queue.size();
+                _tempFile->write( chunk.data.constData() + _queuePos, chunk.data.size() - _queuePos );
+            }
+            newPos = chunk.data.size();
         } else {
             // normal streams
-            newPos = process( _queue, _queuePos );
+            newPos = process( chunk.data, _queuePos );
         }
 
-        // count tries
-        if ( newPos==_queuePos )
-            _tries++;
-        else
-            _tries = 0;
-
+        _queuedBytes -= newPos - _queuePos;
+        _statistics.bytes += newPos - _queuePos;
+        progress = progress || newPos > _queuePos;
         _queuePos = newPos;
+
+        if ( _queuePos < chunk.data.size() ) // the plugin doesn't accept more data for now
+            break;
+
+        const qint64 latency = _clock.elapsed() - chunk.queuedAt;
+        _statistics.totalLatency += latency;
+        _statistics.maxLatency = qMax(_statistics.maxLatency, latency);
+        _queue.dequeue();
+        _queuePos = 0;
     }
 
+    // count tries, only the timer retries are limited
+    if ( progress || _queue.isEmpty() )
+        _tries = 0;
+    else if ( retry )
+        _tries++;
+
     // return true if queue finished
-    return _queuePos>=_queue.size();
+    return _queue.isEmpty();
 }
 
 
 void NSPluginStreamBase::queue( const QByteArray &data )
 {
-    _queue = data;
-    _queue.detach();
-    _queuePos = 0;
+    if ( data.isEmpty() )
+        return;
+
+    // The chunk is shared with the caller instead of copied; it is only read.
+    Chunk chunk;
+    chunk.data = data;
+    chunk.queuedAt = _clock.elapsed();
+    _queue.enqueue( chunk );
+    _queuedBytes += data.size();
     _tries = 0;
 
-/*
-    kDebug(1431) << "new queue size=" << data.size()
-                  << " data=" << (void*)data.data()
-                  << " queue=" << (void*)_queue.data() << " qsize="
-                  << _queue.size() << endl;
-*/
+    _statistics.chunks++;
+    _statistics.maxQueuedBytes = qMax(_statistics.maxQueuedBytes, _queuedBytes);
 }
 
 
@@ -1793,7 +1816,18 @@ void NSPluginStreamBase::finish( bool err )
 {
     kDebug(1431) << "finish error=" << err;
 
-    _queue.resize( 0 );
+    const qint64 elapsed = qMax(qint64(1), _clock.elapsed());
+    kDebug(1431) << "stream statistics:" << _url
+                 << "bytes=" << _statistics.bytes
+                 << "kB/s=" << _statistics.bytes * 1000 / 1024 / elapsed
+                 << "chunks=" << _statistics.chunks
+                 << "average latency=" << (_statistics.chunks ? _statistics.totalLatency / _statistics.chunks : 0)
+                 << "max latency=" << _statistics.maxLatency
+                 << "max queued=" << _statistics.maxQueuedBytes
+                 << "suspensions=" << _statistics.suspensions;
+
+    _queue.clear();
+    _queuedBytes = 0;
     _pos = 0;
     _queuePos = 0;
 
@@ -1870,7 +1904,7 @@ bool NSPluginBufStream::get( const QString& url, const QString& mimeType,
 
 void NSPluginBufStream::timer()
 {
-    bool finished = pump();
+    bool finished = pump( true );
     if ( _singleShot )
         finish( false );
     else {
@@ -1961,11 +1995,18 @@ bool NSPluginStream::post( const QString& url, const QByteArray& data,
 void NSPluginStream::data(KIO::Job*, const QByteArray &data)
 {
     //kDebug(1431) << "NSPluginStream::data - job=" << (void*)job << " data size=" << data.size();
+    // Keep accepting data while the plugin drains older chunks, and only
+    // hold back the job when too much data is waiting.
     queue( data );
     if ( !pump() ) {
-        _job->suspend();
-        _resumeTimer->setSingleShot( true );
-        _resumeTimer->start( 100 );
+        if ( queuedBytes() > s_maximumQueuedBytes && !_job->isSuspended() ) {
+            _job->suspend();
+            _statistics.suspensions++;
+        }
+        if ( !_resumeTimer->isActive() ) {
+            _resumeTimer->setSingleShot( true );
+            _resumeTimer->start( 100 );
+        }
     }
 }
 
@@ -1991,15 +2032,29 @@ void NSPluginStream::mimetype(KIO::Job * job, const QString &mimeType)
 void NSPluginStream::resume()
 {
    if ( error() || tries()>8 ) {
-       _job->kill( KJob::Quietly );
+       if ( _job )
+           _job->kill( KJob::Quietly );
        finish( true );
        return;
    }
 
-   if ( pump() ) {
+   const bool finished = pump( true );
+   if ( !_job ) {
+       // the job is done already, only the queued data was left
+       if ( finished || error() )
+           finish( error() );
+       else {
+           _resumeTimer->setSingleShot( true );
+           _resumeTimer->start( 100 );
+       }
+       return;
+   }
+
+   if ( queuedBytes() <= s_resumeQueuedBytes && _job->isSuspended() ) {
       kDebug(1431) << "resume job";
       _job->resume();
-   } else {
+   }
+   if ( !finished ) {
        kDebug(1431) << "restart timer";
        _resumeTimer->setSingleShot( true );
        _resumeTimer->start( 100 );
@@ -2011,6 +2066,17 @@ void NSPluginStream::result(KJob *job)
 {
    int err = job->error();
    _job = 0;
+
+   // The plugin may still be draining older chunks
+   if ( err==0 && !error() && queuedBytes()>0 ) {
+       if ( !_resumeTimer->isActive() ) {
+           _resumeTimer->setSingleShot( true );
+           _resumeTimer->start( 100 );
+       }
+       return;
+   }
+
+   _resumeTimer->stop();
    finish( err!=0 || error() );
 }
 
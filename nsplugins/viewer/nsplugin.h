@@ -32,6 +32,7 @@
 #include <QMap>
 #include <QPointer>
 #include <QQueue>
+#include <QElapsedTimer>
 #include <QList>
 
 #include <KDebug>
@@ -82,14 +83,29 @@ public:
   int pos() { return _pos; }
   void stop();
 
+  /**
+   * Counters for diagnosing slow streams, printed when the stream is finished
+   */
+  struct Statistics {
+    Statistics() : chunks(0), bytes(0), maxQueuedBytes(0), totalLatency(0), maxLatency(0), suspensions(0) {}
+    int chunks;             // chunks received from KIO
+    qint64 bytes;           // bytes passed to the plugin
+    qint64 maxQueuedBytes;  // maximum of bytes waiting for the plugin
+    qint64 totalLatency;    // sum of the ms each chunk waited until it was passed completely
+    qint64 maxLatency;      // ms
+    int suspensions;        // times the KIO job was suspended
+  };
+  const Statistics &statistics() const { return _statistics; }
+
 Q_SIGNALS:
   void finished( NSPluginStreamBase *strm );
 
 protected:
   void finish( bool err );
-  bool pump();
+  bool pump( bool retry = false );
   bool error() { return _error; }
   void queue( const QByteArray &data );
+  qint64 queuedBytes() const { return _queuedBytes; }
   bool create( const QString& url, const QString& mimeType, void *notify, bool forceNotify = false );
   int tries() { return _tries; }
   void inform( );
@@ -105,13 +121,21 @@ protected:
   QByteArray _headers;
   QByteArray _data;
   class KTemporaryFile *_tempFile;
+  Statistics _statistics;
 
 private:
   int process( const QByteArray &data, int start );
 
+  struct Chunk {
+    QByteArray data;  // shared with KIO, never modified
+    qint64 queuedAt;  // ms since the stream was created
+  };
+
   unsigned int _pos;
-  QByteArray _queue;
-  int _queuePos;
+  QQueue<Chunk> _queue;
+  int _queuePos;      // position in the first chunk
+  qint64 _queuedBytes;
+  QElapsedTimer _clock;
   int _tries;
   bool _onlyAsFile;
   bool _error;
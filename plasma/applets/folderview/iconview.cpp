@@ -64,6 +64,7 @@
 
 IconView::IconView(QGraphicsWidget *parent)
     : AbstractItemView(parent),
+      m_spatialIndexDirty(true),
       m_columns(0),
       m_rows(0),
       m_validRows(0),
@@ -410,6 +411,7 @@ void IconView::updateGridSize()
 
             doLayoutSanityCheck();
             m_regionCache.clear();
+            m_spatialIndexDirty = true;
             markAreaDirty(visibleArea());
         } else if (m_validRows > 0) {
             m_validRows = 0;
@@ -436,6 +438,7 @@ void IconView::rowsInserted(const QModelIndex &parent, int first, int last)
 {
     Q_UNUSED(parent)
     m_regionCache.clear();
+    m_spatialIndexDirty = true;
 
     if (!m_layoutBroken || !m_savedPositions.isEmpty()) {
         if (first < m_validRows) {
@@ -482,6 +485,7 @@ void IconView::rowsRemoved(const QModelIndex &parent, int first, int last)
     Q_UNUSED(parent)
 
     m_regionCache.clear();
+    m_spatialIndexDirty = true;
 
     if (!m_layoutBroken) {
         if (first < m_validRows) {
@@ -544,6 +548,7 @@ void IconView::dataChanged(const QModelIndex &topLeft, const QModelIndex &bottom
     const QStyleOptionViewItemV4 option = viewOptions();
     const QSize grid = gridSize();
     m_regionCache.clear();
+    m_spatialIndexDirty = true;
 
     // Update the size of the items and center them in the grid cell
     for (int i = topLeft.row(); i <= bottomRight.row() && i < m_items.size(); i++) {
@@ -723,6 +728,7 @@ void IconView::layoutItems()
     QStyleOptionViewItemV4 option = viewOptions();
     m_items.resize(m_model->rowCount());
     m_regionCache.clear();
+    m_spatialIndexDirty = true;
 
     const QRect visibleRect = mapToViewport(contentsRect()).toAlignedRect();
     const QRect rect = contentsRect().toRect();
@@ -909,6 +915,7 @@ void IconView::alignIconsToGrid()
         m_layoutBroken = true;
         m_savedPositions.clear();
         m_regionCache.clear();
+        m_spatialIndexDirty = true;
     }
 }
 
@@ -972,6 +979,7 @@ bool IconView::doLayoutSanityCheck()
         }
 
         m_regionCache.clear();
+        m_spatialIndexDirty = true;
         return true;
     }
 
@@ -1039,6 +1047,7 @@ void IconView::finishedScrolling()
             markAreaDirty(visibleArea());
             boundingRect.translate(0, -deltaY);
             m_regionCache.clear();
+            m_spatialIndexDirty = true;
         }
 
         // Remove any empty space below the visible area by adjusting the
@@ -1261,10 +1270,10 @@ void IconView::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
         p.fillRect(mapToViewport(cr).toAlignedRect(), Qt::transparent);
         p.setCompositionMode(QPainter::CompositionMode_SourceOver);
 
-        for (int i = 0; i < m_validRows; i++) {
+        foreach (int i, itemsIntersecting(m_dirtyRegion.boundingRect())) {
             opt.rect = m_items[i].rect;
 
-            if (!m_items[i].layouted || !m_dirtyRegion.intersects(opt.rect)) {
+            if (i >= m_validRows || !m_items[i].layouted || !m_dirtyRegion.intersects(opt.rect)) {
                 continue;
             }
 
@@ -1290,6 +1299,7 @@ void IconView::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                 const QSize size = itemSize(opt, index);
                 m_items[i].rect.setHeight(size.height());
                 m_items[i].needSizeAdjust = false;
+                m_spatialIndexDirty = true;
                 opt.rect = m_items[i].rect;
             }
 
@@ -1369,8 +1379,8 @@ QModelIndex IconView::indexAt(const QPointF &point) const
         }
     }
 
-    for (int i = 0; i < m_validRows; i++) {
-        if (!m_items[i].layouted || !m_items[i].rect.contains(pt)) {
+    foreach (int i, itemsIntersecting(QRect(pt, QSize(1, 1)))) {
+        if (i >= m_validRows || !m_items[i].layouted || !m_items[i].rect.contains(pt)) {
             continue;
         }
 
@@ -1384,6 +1394,22 @@ QModelIndex IconView::indexAt(const QPointF &point) const
     return QModelIndex();
 }
 
+// Returns the sorted rows of the items that may intersect rect.
+// The rows must still be checked against m_validRows and the item rects.
+QVector<int> IconView::itemsIntersecting(const QRect &rect) const
+{
+    if (m_spatialIndexDirty) {
+        QVector<QRect> rects(m_items.size());
+        for (int i = 0; i < m_items.size(); i++) {
+            rects[i] = m_items[i].rect;
+        }
+        m_spatialIndex.rebuild(rects, gridSize());
+        m_spatialIndexDirty = false;
+    }
+
+    return m_spatialIndex.intersecting(rect);
+}
+
 QRect IconView::visualRect(const QModelIndex &index) const
 {
     if (!index.isValid() || index.row() < 0 || index.row() >= m_validRows ||
@@ -1601,6 +1627,7 @@ void IconView::resizeEvent(QGraphicsSceneResizeEvent *e)
                     m_items[i].rect.translate(dx, 0);
                 }
                 m_regionCache.clear();
+                m_spatialIndexDirty = true;
                 markAreaDirty(visibleArea());
             }
         }
@@ -2457,6 +2484,7 @@ void IconView::dropEvent(QGraphicsSceneDragDropEvent *event)
     doLayoutSanityCheck();
     markAreaDirty(visibleArea());
     m_regionCache.clear();
+    m_spatialIndexDirty = true;
 
     m_layoutBroken = true;
     emit indexesMoved(indexes);
@@ -2545,6 +2573,7 @@ void IconView::changeEvent(QEvent *event)
                     }
                 }
                 m_regionCache.clear();
+                m_spatialIndexDirty = true;
                 markAreaDirty(mapToViewport(rect()).toAlignedRect());
                 updateScrollBar();
             }
@@ -2698,24 +2727,31 @@ void IconView::selectIconsInArea(const QRect &area, const QPoint &finalPos)
     QModelIndex m;
     QRect dirtyRect;
 
-    // Select the indexes inside the area
+    // Select the indexes inside the area, merging consecutive rows into ranges
     QItemSelection selection;
-    for (int i = 0; i < m_items.size(); i++) {
-        QModelIndex index = m_model->index(i, 0);
+    int start = -1;
+    int end = -1;
+    foreach (int i, itemsIntersecting(area)) {
+        const QModelIndex index = m_model->index(i, 0);
         if (!indexIntersectsRect(index, area))
             continue;
 
-        int start = i;
-
-        do {
-            dirtyRect |= m_items[i].rect;
-            if (m_items[i].rect.contains(finalPos) && visualRegion(index).contains(finalPos)) {
-               m_hoveredIndex = index;
-            }
-            index = m_model->index(++i, 0);
-        } while (i < m_items.size() && indexIntersectsRect(index, area));
+        dirtyRect |= m_items[i].rect;
+        if (m_items[i].rect.contains(finalPos) && visualRegion(index).contains(finalPos)) {
+           m_hoveredIndex = index;
+        }
 
-        selection.select(m_model->index(start, 0), m_model->index(i - 1, 0));
+        if (start != -1 && i == end + 1) {
+            end = i;
+            continue;
+        }
+        if (start != -1) {
+            selection.select(m_model->index(start, 0), m_model->index(end, 0));
+        }
+        start = end = i;
+    }
+    if (start != -1) {
+        selection.select(m_model->index(start, 0), m_model->index(end, 0));
     }
     m_selectionModel->select(selection, QItemSelectionModel::ToggleCurrent);
 
@@ -2867,6 +2903,7 @@ void IconView::timerEvent(QTimerEvent *event)
                 }
             }
             m_regionCache.clear();
+            m_spatialIndexDirty = true;
             markAreaDirty(visibleArea());
         } else {
             int maxWidth  = contentsRect().width();
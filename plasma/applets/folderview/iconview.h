@@ -25,6 +25,7 @@
 #include "popupview.h"
 #include "itemeditor.h"
 #include "actionoverlay.h"
+#include "spatialindex.h"
 
 #include <QAbstractItemDelegate>
 #include <QPointer>
@@ -236,11 +237,14 @@ private:
     void selectIconRange(const QModelIndex &begin, const QModelIndex &end);
     void repaintSelectedIcons();
     QRect selectedItemsBoundingRect() const;
+    QVector<int> itemsIntersecting(const QRect &rect) const;
 
 private:
     QVector<ViewItem> m_items;
     QHash<QString, QPoint> m_savedPositions;
     mutable QCache<quint64, QRegion> m_regionCache;
+    mutable SpatialIndex m_spatialIndex;
+    mutable bool m_spatialIndexDirty;
     qreal m_margins[4];
     int m_columns;
     int m_rows;
@@ -0,0 +1,133 @@
+/*
+ *   Copyright © 2014 the Folderview developers
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this library; see the file COPYING.LIB.  If not, write to
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *   Boston, MA 02110-1301, USA.
+ */
+
+#include "spatialindex.h"
+
+#include <algorithm>
+
+
+SpatialIndex::SpatialIndex()
+    : m_columns(0), m_rows(0)
+{
+}
+
+void SpatialIndex::clear()
+{
+    m_cells.clear();
+    m_columns = 0;
+    m_rows = 0;
+}
+
+void SpatialIndex::rebuild(const QVector<QRect> &rects, const QSize &cellSize)
+{
+    clear();
+
+    QRect bounds;
+    int count = 0;
+    foreach (const QRect &rect, rects) {
+        if (!rect.isEmpty()) {
+            bounds |= rect;
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    m_origin = bounds.topLeft();
+    m_cellSize = cellSize.expandedTo(QSize(16, 16));
+
+    // Items placed far apart, e.g. by a broken layout, must not make the grid
+    // grow without bounds; enlarge the cells instead.
+    const int maxCells = qMax(1024, count * 4);
+    forever {
+        m_columns = (bounds.width() + m_cellSize.width() - 1) / m_cellSize.width();
+        m_rows = (bounds.height() + m_cellSize.height() - 1) / m_cellSize.height();
+        if (qint64(m_columns) * m_rows <= maxCells) {
+            break;
+        }
+        m_cellSize *= 2;
+    }
+
+    m_cells.resize(m_columns * m_rows);
+
+    for (int i = 0; i < rects.count(); i++) {
+        int left, top, right, bottom;
+        if (!cellRange(rects[i], &left, &top, &right, &bottom)) {
+            continue;
+        }
+        for (int y = top; y <= bottom; y++) {
+            for (int x = left; x <= right; x++) {
+                m_cells[y * m_columns + x].append(i);
+            }
+        }
+    }
+}
+
+bool SpatialIndex::cellRange(const QRect &rect, int *left, int *top, int *right, int *bottom) const
+{
+    if (m_cells.isEmpty() || rect.isEmpty()) {
+        return false;
+    }
+
+    const QRect r = rect.normalized().translated(-m_origin);
+
+    // Integer division truncates towards zero, so rects left of or above
+    // the indexed area must be rejected before dividing.
+    if (r.right() < 0 || r.bottom() < 0) {
+        return false;
+    }
+
+    *left   = qMax(r.left() / m_cellSize.width(), 0);
+    *top    = qMax(r.top() / m_cellSize.height(), 0);
+    *right  = qMin(r.right() / m_cellSize.width(), m_columns - 1);
+    *bottom = qMin(r.bottom() / m_cellSize.height(), m_rows - 1);
+
+    return *left <= *right && *top <= *bottom;
+}
+
+QVector<int> SpatialIndex::intersecting(const QRect &rect) const
+{
+    int left, top, right, bottom;
+    if (!cellRange(rect, &left, &top, &right, &bottom)) {
+        return QVector<int>();
+    }
+
+    if (left == right && top == bottom) {
+        // The rows in a cell are already sorted
+        return m_cells[top * m_columns + left];
+    }
+
+    QVector<int> rows;
+    for (int y = top; y <= bottom; y++) {
+        for (int x = left; x <= right; x++) {
+            rows += m_cells[y * m_columns + x];
+        }
+    }
+
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    return rows;
+}
+
+QVector<int> SpatialIndex::containing(const QPoint &point) const
+{
+    return intersecting(QRect(point, QSize(1, 1)));
+}
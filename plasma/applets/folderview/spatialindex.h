@@ -0,0 +1,65 @@
+/*
+ *   Copyright © 2014 the Folderview developers
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Library General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Library General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this library; see the file COPYING.LIB.  If not, write to
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *   Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QRect>
+#include <QVector>
+
+
+/* A uniform grid of buckets that maps areas of the view to the rows of the
+ * items placed there, so hit-testing and painting don't have to walk all items.
+ *
+ * The icons are placed on a grid, so using the grid size as the cell size
+ * puts each item into at most four cells.
+ *
+ * The index only knows the rects it was built with. The caller must rebuild it
+ * after items have been moved, and check the rects of the returned rows.
+ */
+class SpatialIndex
+{
+public:
+    SpatialIndex();
+
+    void clear();
+
+    /* Indexes the rects, using the position in the vector as the row.
+     * Null rects are skipped.
+     */
+    void rebuild(const QVector<QRect> &rects, const QSize &cellSize);
+
+    /* Returns the sorted rows of all items whose rect may intersect the given rect */
+    QVector<int> intersecting(const QRect &rect) const;
+
+    /* Returns the sorted rows of all items whose rect may contain the given point */
+    QVector<int> containing(const QPoint &point) const;
+
+private:
+    bool cellRange(const QRect &rect, int *left, int *top, int *right, int *bottom) const;
+
+private:
+    QVector<QVector<int> > m_cells;
+    QPoint m_origin;
+    QSize m_cellSize;
+    int m_columns;
+    int m_rows;
+};
+
+#endif